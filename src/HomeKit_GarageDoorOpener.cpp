@@ -1959,28 +1959,20 @@ window.addEventListener('load', (event) =>
   StdevHD = document.getElementById('Stdev');
   NewTravelsHD = document.getElementById('NewTravels');
 
-  setInterval
-  (
-    function()
-      {
-        if(TargetStateHD)
-          ForVar('TARGET_STATE', responseText => WriteToTargetStateUI(responseText) );
-        if(CurrentStateHD)
-          ForVar('CURRENT_STATE', responseText => WriteToCurrentStateUI(responseText) );
-        if(ObstructionDetected)
-          ForVar('OBSTRUCTION_DETECTED', responseText => WriteToObstructionDetectedHD(responseText) );
-        if(DoorPositionHD)
-          ForVar('DOOR_POSITION', responseText => WriteToDoorPositionUI(responseText) );
-        if(DoorStateHD)
-          ForVar('DOOR_STATE', responseText => WriteToDoorStateUI(responseText) );
-        if(MotorStateHD || LastMotorStateHD)
-          ForVar('MOTOR_STATE', responseText => WriteToMotorStateUI(responseText) );
-        if(StdevHD)
-          ForSetVar('DOOR_POSITION_MARKERS', 'current-stdev', responseText => WriteToStdevUI(responseText) );
-
-      },
-      1000
-  );
+  if(TargetStateHD)
+    WatchVar('TARGET_STATE', 1000, responseText => WriteToTargetStateUI(responseText) );
+  if(CurrentStateHD)
+    WatchVar('CURRENT_STATE', 1000, responseText => WriteToCurrentStateUI(responseText) );
+  if(ObstructionDetected)
+    WatchVar('OBSTRUCTION_DETECTED', 1000, responseText => WriteToObstructionDetectedHD(responseText) );
+  if(DoorPositionHD)
+    WatchVar('DOOR_POSITION', 1000, responseText => WriteToDoorPositionUI(responseText) );
+  if(DoorStateHD)
+    WatchVar('DOOR_STATE', 1000, responseText => WriteToDoorStateUI(responseText) );
+  if(MotorStateHD || LastMotorStateHD)
+    WatchVar('MOTOR_STATE', 1000, responseText => WriteToMotorStateUI(responseText) );
+  if(StdevHD)
+    WatchVar('DOOR_POSITION_MARKERS:current-stdev', 1000, responseText => WriteToStdevUI(responseText) );
 
 
 });
@@ -1991,9 +1983,9 @@ window.addEventListener('load', (event) =>
 
 
 #pragma region MainPage_HtmlBody
-CTextEmitter MainPage_HtmlBody()
+const __FlashStringHelper* MainPage_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="PositionCanvas" width="360" height="200"></canvas>
 </div>
@@ -2052,15 +2044,15 @@ CTextEmitter MainPage_HtmlBody()
 
 
 <div id="Debug"> </div>
-)"));
+)");
 }
 
 #pragma endregion
 
 #pragma region ConfigPage_HtmlBody
-CTextEmitter ConfigPage_HtmlBody()
+const __FlashStringHelper* ConfigPage_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="PositionCanvas" width="360" height="200"></canvas>
 </div>
@@ -2117,15 +2109,15 @@ CTextEmitter ConfigPage_HtmlBody()
 </table>
 
 <div id="Debug"> </div>
-)"));
+)");
 }
 
 #pragma endregion
 
 #pragma region HomeKit_HtmlBody
-CTextEmitter HomeKit_HtmlBody()
+const __FlashStringHelper* HomeKit_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="PositionCanvas" width="360" height="150"></canvas>
 </div>
@@ -2189,7 +2181,7 @@ CTextEmitter HomeKit_HtmlBody()
 
 
 <div id="Debug"> </div>
-)"));
+)");
 }
 
 #pragma endregion
@@ -2221,10 +2213,7 @@ void AddMenuItems(CController& c)
           out << EventChart_JavaScript();
           out << Command_JavaScript();
         },
-        .Body = [](Stream& out)
-        {
-          out << MainPage_HtmlBody();
-        },
+        .BodyText = MainPage_HtmlBody(),
       }
     )
 
@@ -2244,10 +2233,7 @@ void AddMenuItems(CController& c)
           out << EventChart_JavaScript();
           out << Command_JavaScript();
         },
-        .Body = [](Stream& out)
-        {
-          out << ConfigPage_HtmlBody();
-        },
+        .BodyText = ConfigPage_HtmlBody(),
       }
     )
 
@@ -2267,10 +2253,7 @@ void AddMenuItems(CController& c)
           out << EventChart_JavaScript();
           out << Command_JavaScript();
         },
-        .Body = [](Stream& out)
-        {
-          out << HomeKit_HtmlBody();
-        },
+        .BodyText = HomeKit_HtmlBody(),
       }
     )
 
@@ -2649,6 +2632,7 @@ void InstallVarsAndCmds(CController& c, CGarageDoorOpenerService& door, CHost& h
         }
         return MakeTextEmitter();
       })
+    .HideVar("PRESS_BUTTON")
 
     #pragma endregion
 
@@ -2673,6 +2657,7 @@ void InstallVarsAndCmds(CController& c, CGarageDoorOpenerService& door, CHost& h
         }
         return MakeTextEmitter();
       })
+    .HideVar("CONTINUOUS_POSITION")
 
     #pragma endregion
 
@@ -1105,9 +1105,9 @@ CTextEmitter Command_JavaScript();
 #pragma endregion
 
 #pragma region HtmlBody - Functions
-CTextEmitter MainPage_HtmlBody();
-CTextEmitter ConfigPage_HtmlBody();
-CTextEmitter HomeKit_HtmlBody();
+const __FlashStringHelper* MainPage_HtmlBody();
+const __FlashStringHelper* ConfigPage_HtmlBody();
+const __FlashStringHelper* HomeKit_HtmlBody();
 
 #pragma endregion
 
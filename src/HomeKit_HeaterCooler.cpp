@@ -354,9 +354,10 @@ struct CContinuousEventRecorderUnit : CUnitBase
   #pragma endregion
 
   #pragma region Construction
-  CContinuousEventRecorderUnit(int intervalSec)
+  CContinuousEventRecorderUnit(int intervalSec, int historySectors = 0)
   {
     Record.RecordIntervalSec = std::max(1, intervalSec);
+    Record.History.Attach(historySectors);
   }
   #pragma endregion
 
@@ -364,7 +365,10 @@ struct CContinuousEventRecorderUnit : CUnitBase
   virtual void Start(CVoidArgs&) override
   {
     //Serial.printf("Size of CEvent = %d bytes\n", sizeof(CEvent));
-    Record.reserve(288/2);
+    if(Record.History)
+      Record.MaxEntries = 288/2; // in the flash, mEntries grows only until the clock is set
+    else
+      Record.reserve(288/2);
   }
 
   #pragma endregion
@@ -418,6 +422,11 @@ IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec)
   return std::make_shared<CContinuousEventRecorderUnit>(intervalSec);
 }
 
+IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec, int historySectors)
+{
+  return std::make_shared<CContinuousEventRecorderUnit>(intervalSec, historySectors);
+}
+
 //END
 #pragma endregion
 
@@ -795,32 +804,15 @@ function SetActive(value)
 
 
 
-function Update()
-{
-  ForVar('TEMPERATURE', responseText => UIUpdateTemperature(responseText) );
-  ForVar('HUMIDITY',    responseText => UIUpdateHumidity(responseText) );
-  ForVar('TARGET_STATE', responseText => UIUpdateTargetState(responseText) );
-  ForVar('CURRENT_STATE', responseText => UIUpdateCurrentState(responseText) );
-  ForVar('COOLING_THRESHOLD_TEMPERATURE', responseText => UIUpdateCoolingThresholdTemperature(responseText) );
-  ForVar('HEATING_THRESHOLD_TEMPERATURE', responseText => UIUpdateHeatingThresholdTemperature(responseText) );
-  ForVar('ACTIVE', responseText => UIUpdateActive(responseText) );
-
-}
-
-
-
 window.addEventListener('load', (event) =>
 {
-  Update();
-
-  setInterval
-  ( 
-    function() 
-      { 
-        Update(); 
-      },
-      2000
-    );
+  WatchVar('TEMPERATURE', 2000, responseText => UIUpdateTemperature(responseText) );
+  WatchVar('HUMIDITY',    2000, responseText => UIUpdateHumidity(responseText) );
+  WatchVar('TARGET_STATE', 2000, responseText => UIUpdateTargetState(responseText) );
+  WatchVar('CURRENT_STATE', 2000, responseText => UIUpdateCurrentState(responseText) );
+  WatchVar('COOLING_THRESHOLD_TEMPERATURE', 2000, responseText => UIUpdateCoolingThresholdTemperature(responseText) );
+  WatchVar('HEATING_THRESHOLD_TEMPERATURE', 2000, responseText => UIUpdateHeatingThresholdTemperature(responseText) );
+  WatchVar('ACTIVE', 2000, responseText => UIUpdateActive(responseText) );
 });
 
 )"));
@@ -828,9 +820,9 @@ window.addEventListener('load', (event) =>
 #pragma endregion
 
 #pragma region MainPage_HtmlBody
-CTextEmitter MainPage_HtmlBody()
+const __FlashStringHelper* MainPage_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="Canvas" width="360" height="200"></canvas>
 </div>
@@ -877,16 +869,20 @@ CTextEmitter MainPage_HtmlBody()
     <th>Total recording time</th>
     <td>{TOTAL_RECORD_TIME_STR}</td>
   </tr>
+  <tr>
+    <th>History</th>
+    <td>{HISTORY_INFO}</td>
+  </tr>
 </table>
 
-)"));
+)");
 }
 #pragma endregion
 
 #pragma region HomeKit_HtmlBody
-CTextEmitter HomeKit_HtmlBody()
+const __FlashStringHelper* HomeKit_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="Canvas" width="360" height="120"></canvas>
 </div>
@@ -949,7 +945,7 @@ CTextEmitter HomeKit_HtmlBody()
 
 
 <div id="Debug"> </div>
-)"));
+)");
 }
 
 #pragma endregion
@@ -1139,6 +1135,7 @@ void InstallVarsAndCmds(CController& c, CHeaterCoolerService& svr, CHost& host)
 
         return Args.Value->EntriesEmitter();
       })
+    .HideVar("ENTRIES")
 
     #pragma endregion
 
@@ -1207,6 +1204,16 @@ void InstallVarsAndCmds(CController& c, CHeaterCoolerService& svr, CHost& host)
 
     #pragma endregion
 
+    #pragma region HISTORY_INFO
+    .SetVar("HISTORY_INFO", [&host](auto p)
+      {
+        IUnit::CEventRecorderArgs Args;
+        host.QueryEventRecorder(Args);
+        return Args.Value ? Args.Value->History.InfoEmitter() : MakeHistoryInfoEmitter(nullptr);
+      })
+
+    #pragma endregion
+
   ;
 }
 #pragma endregion
@@ -1230,7 +1237,7 @@ void AddMenuItems(CController& c)
           out << Command_JavaScript();
           out << EventChart_JavaScript();
         },
-        .Body = MainPage_HtmlBody(),
+        .BodyText = MainPage_HtmlBody(),
       }
     )
 
@@ -1251,10 +1258,7 @@ void AddMenuItems(CController& c)
           out << EventChart_JavaScript();
           out << Command_JavaScript();
         },
-        .Body = [](Stream& out)
-        {
-          out << HomeKit_HtmlBody();
-        },
+        .BodyText = HomeKit_HtmlBody(),
       }
     )
 
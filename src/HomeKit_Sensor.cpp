@@ -249,9 +249,10 @@ struct CContinuousEventRecorderUnit : CUnitBase
   #pragma endregion
 
   #pragma region Construction
-  CContinuousEventRecorderUnit(int intervalSec)
+  CContinuousEventRecorderUnit(int intervalSec, int historySectors = 0)
   {
     Record.RecordIntervalSec = std::max(1, intervalSec);
+    Record.History.Attach(historySectors);
   }
   #pragma endregion
 
@@ -259,7 +260,10 @@ struct CContinuousEventRecorderUnit : CUnitBase
   virtual void Start(CVoidArgs&) override
   {
     //Serial.printf("Size of CEvent = %d bytes\n", sizeof(CEvent));
-    Record.reserve(288/2);
+    if(Record.History)
+      Record.MaxEntries = 288/2; // in the flash, mEntries grows only until the clock is set
+    else
+      Record.reserve(288/2);
   }
 
   #pragma endregion
@@ -313,6 +317,11 @@ IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec)
   return std::make_shared<CContinuousEventRecorderUnit>(intervalSec);
 }
 
+IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec, int historySectors)
+{
+  return std::make_shared<CContinuousEventRecorderUnit>(intervalSec, historySectors);
+}
+
 //END
 #pragma endregion
 
@@ -648,25 +657,10 @@ function SetTemperature(value)
 
 
 
-function Update()
-{
-  ForVar('TEMPERATURE', responseText => UIUpdateTemperature(responseText) );
-  ForVar('HUMIDITY',    responseText => UIUpdateHumidity(responseText) );
-}
-
-
 window.addEventListener('load', (event) =>
 {
-  Update();
-
-  setInterval
-  ( 
-    function() 
-      { 
-        Update(); 
-      },
-      5000
-    );
+  WatchVar('TEMPERATURE', 5000, responseText => UIUpdateTemperature(responseText) );
+  WatchVar('HUMIDITY',    5000, responseText => UIUpdateHumidity(responseText) );
 });
 
 )"));
@@ -674,9 +668,9 @@ window.addEventListener('load', (event) =>
 #pragma endregion
 
 #pragma region MainPage_HtmlBody
-CTextEmitter MainPage_HtmlBody()
+const __FlashStringHelper* MainPage_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="Canvas" width="360" height="200"></canvas>
 </div>
@@ -723,9 +717,13 @@ CTextEmitter MainPage_HtmlBody()
     <th>Total recording time</th>
     <td>{TOTAL_RECORD_TIME_STR}</td>
   </tr>
+  <tr>
+    <th>History</th>
+    <td>{HISTORY_INFO}</td>
+  </tr>
 </table>
 
-)"));
+)");
 }
 #pragma endregion
 
@@ -768,6 +766,7 @@ void InstallVarsAndCmds(CController& c, CHost& host)
 
         return Args.Value->EntriesEmitter();
       })
+    .HideVar("ENTRIES")
 
     #pragma endregion
 
@@ -836,6 +835,16 @@ void InstallVarsAndCmds(CController& c, CHost& host)
 
     #pragma endregion
 
+    #pragma region HISTORY_INFO
+    .SetVar("HISTORY_INFO", [&host](auto p)
+      {
+        IUnit::CEventRecorderArgs Args;
+        host.QueryEventRecorder(Args);
+        return Args.Value ? Args.Value->History.InfoEmitter() : MakeHistoryInfoEmitter(nullptr);
+      })
+
+    #pragma endregion
+
     ;
 }
 #pragma endregion
@@ -858,7 +867,7 @@ void AddMenuItems(CController& c)
           out << Command_JavaScript();
           out << EventChart_JavaScript();
         },
-        .Body = MainPage_HtmlBody(),
+        .BodyText = MainPage_HtmlBody(),
       }
     )
     ;
@@ -210,10 +210,17 @@ struct CEventRecorder
 
     #pragma region ToString
     void ToString(char* pBuf, size_t bufLen) const
+    {
+      ToString(pBuf, bufLen, Time);
+    }
+
+    /* @param time Replaces Time, e.g. of a record of the History.
+    */
+    void ToString(char* pBuf, size_t bufLen, time_t time) const
     {
       size_t Len;
       tm TM;
-      smart_gmtime(&TM, Time);
+      smart_gmtime(&TM, time);
       strftime(pBuf, bufLen, "%Y-%m-%dT%H:%M:%SZ;", &TM);
       pBuf[bufLen-1] = 0;
       Len = strlen(pBuf);
@@ -253,6 +260,11 @@ struct CEventRecorder
   size_t MaxEntries{ 288 }; // 24h by 5min steps | sizeof(CEvent) * 288 = 2304 bytes
   int RecordIntervalSec{ 60 }; // 1 minute
 
+  /* Optional persistent history: if attached, the events are stored in the
+  * flash instead of mEntries, which only takes the events before the clock is set.
+  */
+  CEventHistory<CEvent> History;
+
   #pragma endregion
 
   #pragma region clear
@@ -274,9 +286,13 @@ struct CEventRecorder
   #pragma region push_back
   void push_back(const CSensorInfo& info)
   {
+    CEvent Event(info);
+    if(History.Append(Event))
+      return;
+
     while(mEntries.size() >= MaxEntries)
       mEntries.erase(mEntries.begin());
-    mEntries.push_back(CEvent(info));
+    mEntries.push_back(Event);
   }
 
   #pragma endregion
@@ -287,10 +303,12 @@ struct CEventRecorder
   */
   CTextEmitter EntriesEmitter() const
   {
-    return [&Entries = mEntries](Stream& out)
+    return [this](Stream& out)
       {
         char Buf[64];
-        for(const auto& e : Entries)
+        // the recorded period
+        History.Emit(out, static_cast<time_t>(MaxEntries) * RecordIntervalSec);
+        for(const auto& e : mEntries)
         {
           e.ToString(Buf, sizeof(Buf));
           out << Buf << F("\n");
@@ -990,6 +1008,14 @@ IUnit_Ptr MakeOnSensorChangedUnit(std::function<void(const CSensorInfo&)> func);
 * a continuous event recorder.
 */
 IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec);
+
+/*
+* @brief As above, the events are kept in a CTimeSeriesStore, so the
+* history survives a reboot or update.
+* @param historySectors Number of flash sectors (4 KB, at least 2) at the end
+*   of the file system area; the sketch must not use LittleFS there.
+*/
+IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec, int historySectors);
 #
 #pragma endregion
 
@@ -1034,7 +1060,7 @@ CTextEmitter EventChart_JavaScript();
 #pragma endregion
 
 #pragma region HtmlBody - Functions
-CTextEmitter MainPage_HtmlBody();
+const __FlashStringHelper* MainPage_HtmlBody();
 
 #pragma endregion
 
@@ -227,11 +227,11 @@ AddUIElement = function(name, type, state)
 #pragma endregion
 
 #pragma region Switch_BodyHtml
-CTextEmitter Switch_BodyHtml()
+const __FlashStringHelper* Switch_BodyHtml()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <table id='SwitchTable'></table>
-)"));
+)");
 }
 #pragma endregion
 
@@ -375,7 +375,7 @@ void AddMenuItems(CController& c)
           out << Switch_JavaScript();
           out << Switch_CreateUI_JavaScript();
         },
-        .Body = Switch_BodyHtml()
+        .BodyText = Switch_BodyHtml()
       }
     )
     ;
@@ -590,7 +590,7 @@ CTextEmitter Switch_CreateUI_JavaScript();
 * <table id='SwitchTable'></table>
 * @see Switch_CreateUI_JavaScript
 */
-CTextEmitter Switch_BodyHtml();
+const __FlashStringHelper* Switch_BodyHtml();
 
 #pragma endregion
 
@@ -413,9 +413,10 @@ struct CContinuousEventRecorderUnit : CUnitBase
   #pragma endregion
 
   #pragma region Construction
-  CContinuousEventRecorderUnit(int intervalSec)
+  CContinuousEventRecorderUnit(int intervalSec, int historySectors = 0)
   {
     Record.RecordIntervalSec = std::max(1, intervalSec);
+    Record.History.Attach(historySectors);
   }
   #pragma endregion
 
@@ -423,7 +424,10 @@ struct CContinuousEventRecorderUnit : CUnitBase
   virtual void Start(CVoidArgs&) override
   {
     //Serial.printf("Size of CEvent = %d bytes\n", sizeof(CEvent));
-    Record.reserve(288/2);
+    if(Record.History)
+      Record.MaxEntries = 288/2; // in the flash, mEntries grows only until the clock is set
+    else
+      Record.reserve(288/2);
   }
 
   #pragma endregion
@@ -477,6 +481,11 @@ IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec)
   return std::make_shared<CContinuousEventRecorderUnit>(intervalSec);
 }
 
+IUnit_Ptr MakeContinuousEventRecorderUnit(int intervalSec, int historySectors)
+{
+  return std::make_shared<CContinuousEventRecorderUnit>(intervalSec, historySectors);
+}
+
 //END
 #pragma endregion
 
@@ -865,38 +874,20 @@ function SetHeatingThresholdTemperature(value)
 
 
 
-function Update()
-{
-  ForVar('TEMPERATURE', responseText => UIUpdateTemperature(responseText) );
-  ForVar('HUMIDITY',    responseText => UIUpdateHumidity(responseText) );
-  ForVar('TARGET_STATE', responseText => UIUpdateTargetState(responseText) );
-  ForVar('CURRENT_STATE', responseText => UIUpdateCurrentState(responseText) );
-  ForVar('TARGET_TEMPERATURE', responseText => UIUpdateTargetTemperature(responseText) );
-  ForVar('TARGET_HUMIDITY', responseText => UIUpdateTargetHumidity(responseText) );
-  ForVar('COOLING_THRESHOLD_TEMPERATURE', responseText => UIUpdateCoolingThresholdTemperature(responseText) );
-  ForVar('HEATING_THRESHOLD_TEMPERATURE', responseText => UIUpdateHeatingThresholdTemperature(responseText) );
-
-
-}
-
-
-
 window.addEventListener('load', (event) =>
 {
-  Update();
+  WatchVar('TEMPERATURE', 2000, responseText => UIUpdateTemperature(responseText) );
+  WatchVar('HUMIDITY',    2000, responseText => UIUpdateHumidity(responseText) );
+  WatchVar('TARGET_STATE', 2000, responseText => UIUpdateTargetState(responseText) );
+  WatchVar('CURRENT_STATE', 2000, responseText => UIUpdateCurrentState(responseText) );
+  WatchVar('TARGET_TEMPERATURE', 2000, responseText => UIUpdateTargetTemperature(responseText) );
+  WatchVar('TARGET_HUMIDITY', 2000, responseText => UIUpdateTargetHumidity(responseText) );
+  WatchVar('COOLING_THRESHOLD_TEMPERATURE', 2000, responseText => UIUpdateCoolingThresholdTemperature(responseText) );
+  WatchVar('HEATING_THRESHOLD_TEMPERATURE', 2000, responseText => UIUpdateHeatingThresholdTemperature(responseText) );
 
   ForVar('SUPPORTS_HEATING_THRESHOLD',  responseText => VisibleElement('HeatingThresholdTemperatureButtons', responseText) );
   ForVar('SUPPORTS_COOLING_THRESHOLD',  responseText => VisibleElement('CoolingThresholdTemperatureButtons', responseText) );
   ForVar('SUPPORTS_HUMIDITY_ACTOR',     responseText => VisibleElement('TargetHumidityButtons', responseText) );
-
-  setInterval
-  ( 
-    function() 
-      { 
-        Update(); 
-      },
-      2000
-    );
 });
 
 )"));
@@ -904,9 +895,9 @@ window.addEventListener('load', (event) =>
 #pragma endregion
 
 #pragma region MainPage_HtmlBody
-CTextEmitter MainPage_HtmlBody()
+const __FlashStringHelper* MainPage_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="Canvas" width="360" height="200"></canvas>
 </div>
@@ -953,16 +944,20 @@ CTextEmitter MainPage_HtmlBody()
     <th>Total recording time</th>
     <td>{TOTAL_RECORD_TIME_STR}</td>
   </tr>
+  <tr>
+    <th>History</th>
+    <td>{HISTORY_INFO}</td>
+  </tr>
 </table>
 
-)"));
+)");
 }
 #pragma endregion
 
 #pragma region HomeKit_HtmlBody
-CTextEmitter HomeKit_HtmlBody()
+const __FlashStringHelper* HomeKit_HtmlBody()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
 <div>
   <canvas id="Canvas" width="360" height="120"></canvas>
 </div>
@@ -1034,7 +1029,7 @@ CTextEmitter HomeKit_HtmlBody()
 
 
 <div id="Debug"> </div>
-)"));
+)");
 }
 
 #pragma endregion
@@ -1218,6 +1213,7 @@ void InstallVarsAndCmds(CController& c, CThermostatService& svr, CHost& host)
 
         return Args.Value->EntriesEmitter();
       })
+    .HideVar("ENTRIES")
 
     #pragma endregion
 
@@ -1286,6 +1282,16 @@ void InstallVarsAndCmds(CController& c, CThermostatService& svr, CHost& host)
 
     #pragma endregion
 
+    #pragma region HISTORY_INFO
+    .SetVar("HISTORY_INFO", [&host](auto p)
+      {
+        IUnit::CEventRecorderArgs Args;
+        host.QueryEventRecorder(Args);
+        return Args.Value ? Args.Value->History.InfoEmitter() : MakeHistoryInfoEmitter(nullptr);
+      })
+
+    #pragma endregion
+
     #pragma region SUPPORTS_HUMIDITY_ACTOR
     .SetVar("SUPPORTS_HUMIDITY_ACTOR", [&svr](auto p)
       {
@@ -1337,7 +1343,7 @@ void AddMenuItems(CController& c)
           out << Command_JavaScript();
           out << EventChart_JavaScript();
         },
-        .Body = MainPage_HtmlBody(),
+        .BodyText = MainPage_HtmlBody(),
       }
     )
 
@@ -1358,10 +1364,7 @@ void AddMenuItems(CController& c)
           out << EventChart_JavaScript();
           out << Command_JavaScript();
         },
-        .Body = [](Stream& out)
-        {
-          out << HomeKit_HtmlBody();
-        },
+        .BodyText = HomeKit_HtmlBody(),
       }
     )
 
@@ -20,6 +20,7 @@ $DAT >>arduino_homekit_server.cpp<< 08 Okt 2024  09:39:31 - (c) proDAD
 #include <WiFiClient.h>
 #include <ESP8266mDNS.h>
 #include <LEAmDNS.h>
+#include <algorithm>
 
 #include <wolfssl/wolfcrypt/settings.h>
 #include <homekit/homekit.h>
@@ -85,6 +86,12 @@ $DAT >>arduino_homekit_server.cpp<< 08 Okt 2024  09:39:31 - (c) proDAD
 // max(encrypted_chunk) = 512 + 8(chunk_info) + 18(chacha_info). See client_send_encrypted
 #define HOMEKIT_JSONBUFFER_SIZE  512
 
+// Room around a payload passed to client_send, its frames are encrypted in
+// place: the 2 byte length in front (4 to keep malloc'd data word aligned
+// for chacha) and the 16 byte tag behind.
+#define CLIENT_SEND_HEADROOM     4
+#define CLIENT_SEND_TAILROOM     16
+
 #ifdef HOMEKIT_DEBUG
 #define TLV_DEBUG(values) //tlv_debug(values)
 #else
@@ -1281,10 +1288,16 @@ bool write(client_context_t* context, byte* data, int data_size)
 #pragma endregion
 
 #pragma region client_send_encrypted_
+/* Encrypts payload[0..size) in place into HAP frames and sends them, one
+ * write per frame. The caller provides CLIENT_SEND_HEADROOM bytes in front of
+ * the payload and CLIENT_SEND_TAILROOM bytes behind it (see client_send):
+ * the length (AAD) of a frame goes in front of its data, for the following
+ * frames over the end of the frame sent before, and the tag behind it, where
+ * the start of the next frame is saved and restored.
+ */
 int client_send_encrypted_(client_context_t* context, byte* payload, size_t size)
 {
   CLIENT_DEBUG(context, "Send encrypted of size %d", size);
-  // max(size) = HOMEKIT_JSONBUFFER_SIZE + chunk_info(8) = 512 + 8 = 520
   if(!context || !context->encrypted)
     return -1;
 
@@ -1301,8 +1314,7 @@ int client_send_encrypted_(client_context_t* context, byte* payload, size_t size
   byte nonce[12];
   memset(nonce, 0, sizeof(nonce));
 
-  byte encrypted[1024 + 18];
-  int payload_offset = 0;
+  size_t payload_offset = 0;
 
   while(payload_offset < size)
   {
@@ -1310,9 +1322,12 @@ int client_send_encrypted_(client_context_t* context, byte* payload, size_t size
     if(chunk_size > 1024)
       chunk_size = 1024;
 
-    byte aead[2] = { chunk_size % 256, chunk_size / 256 };
+    byte* data = payload + payload_offset;
+    byte* frame = data - 2;
+    byte* tag = data + chunk_size;
 
-    memcpy(encrypted, aead, 2);
+    frame[0] = chunk_size % 256;
+    frame[1] = chunk_size / 256;
 
     byte i = 4;
     int x = context->count_reads++;
@@ -1322,19 +1337,26 @@ int client_send_encrypted_(client_context_t* context, byte* payload, size_t size
       x /= 256;
     }
 
-    size_t available = sizeof(encrypted) - 2;
-    int r = crypto_chacha20poly1305_encrypt(context->read_key, nonce, aead, 2,
-      payload + payload_offset, chunk_size, encrypted + 2, &available);
+    // start of the next frame, still plaintext
+    byte next[16];
+    const bool more = payload_offset + chunk_size < size;
+    if(more)
+      memcpy(next, tag, sizeof(next));
+
+    int r = crypto_chacha20poly1305_encrypt_inplace(context->read_key, nonce, frame, 2,
+      data, chunk_size, tag);
     if(r)
     {
       ERROR("Failed to chacha encrypt payload (code %d)", r);
       return -1;
     }
 
-    payload_offset += chunk_size;
-
-    if(!write(context, encrypted, available + 2))
+    if(!write(context, frame, chunk_size + 18))
       return -1;
+
+    if(more)
+      memcpy(tag, next, sizeof(next));
+    payload_offset += chunk_size;
   }
 
   return 0;
@@ -1343,33 +1365,31 @@ int client_send_encrypted_(client_context_t* context, byte* payload, size_t size
 #pragma endregion
 
 #pragma region client_decrypt_
-int client_decrypt_(client_context_t* context, byte* payload, size_t payload_size, byte* decrypted, size_t* decrypted_size)
+/* Decrypts the complete frames of payload[0..payload_size) in place. The
+ * plaintext of all frames is moved together behind the AAD of the first
+ * frame, *decrypted points to it.
+ * @return bytes of payload used by complete frames, -1 on an invalid frame
+ */
+int client_decrypt_(client_context_t* context, byte* payload, size_t payload_size, byte** decrypted, size_t* decrypted_size)
 {
   if(!context || !context->encrypted)
     return -1;
 
-  const size_t block_size = 1024 + 16 + 2;
-  size_t required_decrypted_size = payload_size / block_size * 1024;
-  if(payload_size % block_size > 0)
-    required_decrypted_size += payload_size % block_size - 16 - 2;
-
-  if(*decrypted_size < required_decrypted_size)
-  {
-    *decrypted_size = required_decrypted_size;
-    return -2;
-  }
-
-  *decrypted_size = required_decrypted_size;
-
   byte nonce[12];
   memset(nonce, 0, sizeof(nonce));
 
-  int payload_offset = 0;
-  int decrypted_offset = 0;
+  size_t payload_offset = 0;
+  *decrypted = payload + 2;
+  *decrypted_size = 0;
 
-  while(payload_offset < payload_size)
+  while(payload_offset + 2 <= payload_size)
   {
     size_t chunk_size = payload[payload_offset] + payload[payload_offset + 1] * 256;
+    if(chunk_size > 1024)
+    {
+      ERROR("Invalid frame size %d", chunk_size);
+      return -1;
+    }
     if(chunk_size + 18 > payload_size - payload_offset)
     {
       // Unfinished chunk
@@ -1384,16 +1404,19 @@ int client_decrypt_(client_context_t* context, byte* payload, size_t payload_siz
       x /= 256;
     }
 
-    size_t decrypted_len = *decrypted_size - decrypted_offset;
-    int r = crypto_chacha20poly1305_decrypt(context->write_key, nonce, payload + payload_offset,
-      2, payload + payload_offset + 2, chunk_size + 16, decrypted, &decrypted_len);
+    byte* data = payload + payload_offset + 2;
+    int r = crypto_chacha20poly1305_decrypt_inplace(context->write_key, nonce, payload + payload_offset,
+      2, data, chunk_size, data + chunk_size);
     if(r)
     {
       ERROR("Failed to chacha decrypt payload (code %d)", r);
       return -1;
     }
 
-    decrypted_offset += decrypted_len;
+    byte* out = *decrypted + *decrypted_size;
+    if(out != data)
+      memmove(out, data, chunk_size);
+    *decrypted_size += chunk_size;
     payload_offset += chunk_size + 18;
   }
 
@@ -1439,6 +1462,10 @@ void client_notify_characteristic(homekit_characteristic_t* ch, homekit_value_t
 #pragma endregion
 
 #pragma region client_send
+/* data_size bytes at data, with CLIENT_SEND_HEADROOM bytes in front and
+ * CLIENT_SEND_TAILROOM bytes behind them the frames are encrypted in (the
+ * whole buffer is overwritten).
+ */
 bool client_send(client_context_t* context, byte* data, size_t data_size)
 {
   CLIENT_DEBUG(context, "send data size=%d, encrypted=%s",
@@ -1465,8 +1492,11 @@ bool client_send(client_context_t* context, byte* data, size_t data_size)
 #pragma region client_send_P
 bool client_send_P(client_context_t* context, PGM_P pgm)
 {
-  XPGM_BUFFCPY_STRING(char, buff, pgm);
-  return client_send(context, (byte*)buff, sizeof(buff) - 1);
+  size_t size = strlen_P(pgm);
+  uint32_t buff[(CLIENT_SEND_HEADROOM + size + CLIENT_SEND_TAILROOM + 3) / 4];
+  byte* data = (byte*)buff + CLIENT_SEND_HEADROOM;
+  memcpy_P(data, pgm, size);
+  return client_send(context, data, size);
 }
 
 #pragma endregion
@@ -1477,12 +1507,13 @@ void client_send_chunk(byte* data, size_t size, void* arg)
   client_context_t* context = (client_context_t*)arg;
 
   size_t payload_size = size + 8;
-  byte* payload = (byte*)malloc(payload_size);
-  if(!payload)
+  byte* buffer = (byte*)malloc(CLIENT_SEND_HEADROOM + payload_size + CLIENT_SEND_TAILROOM);
+  if(!buffer)
   {
     ERROR("Error malloc payload!! payload_size->%d", payload_size);
     return;
   }
+  byte* payload = buffer + CLIENT_SEND_HEADROOM;
 
   int offset = snprintf((char*)payload, payload_size, "%x\r\n", size);
   bool Ret;
@@ -1491,7 +1522,7 @@ void client_send_chunk(byte* data, size_t size, void* arg)
   payload[offset + size + 1] = '\n';
   CLIENT_DEBUG(context, "client_send_chunk, size=%d, offset=%d", size, offset);
   Ret = client_send(context, payload, offset + size + 2);
-  free(payload);
+  free(buffer);
 }
 
 #pragma endregion
@@ -1592,14 +1623,21 @@ void send_tlv_response(client_context_t* context, tlv_values_t* values)
   XPGM_BUFFCPY_STRING(char, http_headers, http_headers_pgm);
 
   int response_size = strlen(http_headers) + payload_size + 32;
-  char* response = (char*)malloc(response_size);
+  char* buffer = (char*)malloc(CLIENT_SEND_HEADROOM + response_size + CLIENT_SEND_TAILROOM);
+  if(!buffer)
+  {
+    CLIENT_ERROR(context, "Failed to allocate response buffer of size %d", response_size);
+    free(payload);
+    return;
+  }
+  char* response = buffer + CLIENT_SEND_HEADROOM;
   int response_len = snprintf(response, response_size, http_headers, payload_size);
 
   if(response_size - response_len < payload_size + 1)
   {
     CLIENT_ERROR(context, "Incorrect response buffer size %d: headers took %d, payload size %d",
       response_size, response_len, payload_size);
-    free(response);
+    free(buffer);
     free(payload);
     return;
   }
@@ -1610,7 +1648,7 @@ void send_tlv_response(client_context_t* context, tlv_values_t* values)
 
   client_send(context, (byte*)response, response_len);
 
-  free(response);
+  free(buffer);
 }
 
 #pragma endregion
@@ -1659,8 +1697,9 @@ void send_json_response(client_context_t* context, int status_code, byte* payloa
   }
 
   int response_size = strlen(http_headers) + payload_size + strlen(status_text) + 32;
-  char* response = (char*)malloc(response_size);
-  if(!response)
+  char* buffer = (char*)malloc(CLIENT_SEND_HEADROOM + response_size + CLIENT_SEND_TAILROOM);
+  char* response = buffer + CLIENT_SEND_HEADROOM;
+  if(!buffer)
   {
     CLIENT_ERROR(context, "Failed to allocate response buffer of size %d", response_size);
     return;
@@ -1672,7 +1711,7 @@ void send_json_response(client_context_t* context, int status_code, byte* payloa
   {
     CLIENT_ERROR(context, "Incorrect response buffer size %d: headers took %d, payload size %d",
       response_size, response_len, payload_size);
-    free(response);
+    free(buffer);
     return;
   }
   memcpy(response + response_len, payload, payload_size);
@@ -1683,7 +1722,7 @@ void send_json_response(client_context_t* context, int status_code, byte* payloa
 
   client_send(context, (byte*)response, response_len);
 
-  free(response);
+  free(buffer);
 }
 
 #pragma endregion
@@ -1723,7 +1762,13 @@ int homekit_client_send(unsigned char* data, size_t size)
 {
   if(!current_client_context)
     return -1;
-  client_send(current_client_context, data, size);
+  // a copy with the room client_send encrypts in, data is not changed
+  byte* buffer = (byte*)malloc(CLIENT_SEND_HEADROOM + size + CLIENT_SEND_TAILROOM);
+  if(!buffer)
+    return -1;
+  memcpy(buffer + CLIENT_SEND_HEADROOM, data, size);
+  client_send(current_client_context, buffer + CLIENT_SEND_HEADROOM, size);
+  free(buffer);
   return 0;
 }
 
@@ -2585,8 +2630,15 @@ void homekit_server_on_pair_verify(client_context_t* context, const byte* data,
           context->verify_context->accessory_public_key_size);
 
         CLIENT_DEBUG(context, "Verifying device signature");
-        r = crypto_ed25519_verify(&pairing.device_key, device_info, device_info_size,
-          tlv_device_signature->value, tlv_device_signature->size);
+        watchdog_check_begin();
+        ed25519_verify_cache* verify_cache = homekit_storage_pairing_verify_cache(&pairing);
+        if(verify_cache)
+          r = crypto_ed25519_verify_cached(verify_cache, device_info, device_info_size,
+            tlv_device_signature->value, tlv_device_signature->size);
+        else
+          r = crypto_ed25519_verify(&pairing.device_key, device_info, device_info_size,
+            tlv_device_signature->value, tlv_device_signature->size);
+        watchdog_check_end("crypto_ed25519_verify_cached");
         free(device_info);
         tlv_free(decrypted_message);
 
@@ -4026,35 +4078,33 @@ void homekit_client_process(client_context_t* context)
   byte* payload = (byte*)context->data;
   size_t payload_size = (size_t)data_len;
 
-  byte* decrypted = NULL;
-  size_t decrypted_size = 0;
-
   if(context->encrypted)
   {
     CLIENT_DEBUG(context, "Decrypting data");
 
-    client_decrypt_(context, context->data, data_len, NULL, &decrypted_size);
-
-    decrypted = (byte*)malloc(decrypted_size);
-    int r = client_decrypt_(context, context->data, data_len, decrypted, &decrypted_size);
-
+    size_t data_available = context->data_available + data_len;
+    int r = client_decrypt_(context, context->data, data_available, &payload, &payload_size);
     if(r < 0)
     {
       CLIENT_ERROR(context, "Invalid client data");
-      free(decrypted);
       return;
     }
-    context->data_available = data_len - r;
+    context->data_available = data_available - r;
     if(r && context->data_available)
     {
-      memmove(context->data, &context->data[r], context->data_available);
+      // The unfinished frame goes to the front for the next read, the
+      // plaintext right behind it (parsed below, the next read overwrites it).
+      byte* end = context->data + r;
+      memmove(end - payload_size, payload, payload_size);
+      std::rotate(end - payload_size, end, end + context->data_available);
+      memmove(context->data, end - payload_size, context->data_available + payload_size);
+      payload = context->data + context->data_available;
     }
-    CLIENT_DEBUG(context, "Decrypted %d bytes, available %d", decrypted_size, context->data_available);
+    CLIENT_DEBUG(context, "Decrypted %d bytes, available %d", payload_size, context->data_available);
 
-    payload = decrypted;
-    payload_size = decrypted_size;
-    if(payload_size)
-      print_binary("Decrypted data", payload, payload_size);
+    if(!payload_size)
+      return;
+    print_binary("Decrypted data", payload, payload_size);
   }
   else
   {
@@ -4065,13 +4115,6 @@ void homekit_client_process(client_context_t* context)
   http_parser_execute(&context->parser, &homekit_http_parser_settings,
     (char*)payload, payload_size);
   current_client_context = NULL;
-
-  CLIENT_DEBUG(context, "Finished processing");
-
-  if(decrypted)
-  {
-    free(decrypted);
-  }
 }
 
 #pragma endregion
@@ -11,7 +11,12 @@
 
 #include "homekit_debug.h"
 #include "port.h"
+#include "crypto.h"
+#ifdef HOMEKIT_FLASH_SIM
+#include "host_shim.h"
+#else
 #include <pgmspace.h>
+#endif
 
 // 3072-bit group N (per RFC5054, Appendix A)
 // ~384-byte
@@ -356,6 +361,35 @@ int crypto_chacha20poly1305_encrypt(
 }
 
 
+int crypto_chacha20poly1305_encrypt_inplace(
+  const byte* key, const byte* nonce, const byte* aad, size_t aad_size,
+  byte* data, size_t data_size, byte* tag)
+{
+  if(data == NULL || tag == NULL)
+    return -1;
+
+  return wc_ChaCha20Poly1305_Encrypt(
+    key, nonce, aad, aad_size,
+    data, data_size,
+    data, tag
+  );
+}
+
+int crypto_chacha20poly1305_decrypt_inplace(
+  const byte* key, const byte* nonce, const byte* aad, size_t aad_size,
+  byte* data, size_t data_size, const byte* tag)
+{
+  if(data == NULL || tag == NULL)
+    return -1;
+
+  return wc_ChaCha20Poly1305_Decrypt(
+    key, nonce, aad, aad_size,
+    data, data_size, tag,
+    data
+  );
+}
+
+
 int crypto_ed25519_init(ed25519_key* key)
 {
   int r = wc_ed25519_init(key);
@@ -406,6 +440,7 @@ int crypto_ed25519_generate(ed25519_key* key)
 
 int crypto_ed25519_import_key(ed25519_key* key, const byte* data, size_t size)
 {
+  (void)size;
   return wc_ed25519_import_private_key(
     data, ED25519_KEY_SIZE,
     data + ED25519_KEY_SIZE, ED25519_PUB_KEY_SIZE,
@@ -483,6 +518,142 @@ int crypto_ed25519_sign(
 }
 
 
+/*
+* Ed25519 verify engines, chosen per call (not with ED25519_SMALL):
+*  - table on the heap  : fast, ~1 KB stack + 1280 bytes heap
+*  - table on the stack : fast, ~2.3 KB stack
+*  - low-mem            : ge_double_scalarmult_vartime_lowmem, slow
+* ECDH and signing have one engine per build: CURVE25519_SMALL and
+* ED25519_SMALL (ARDUINO_HOMEKIT_LOWROM) replace the fast field arithmetic
+* at compile time, both variants share the same symbols.
+*/
+
+/*
+* The precomputed table of a cached key is only kept if at least this much
+* heap remains free after its allocation.
+*/
+#ifndef CRYPTO_ED25519_TABLE_MIN_FREE_HEAP
+#define CRYPTO_ED25519_TABLE_MIN_FREE_HEAP 12000
+#endif
+
+/*
+* At most this many cached keys keep a table (first come, first served),
+* so the caches of all pairings together stay below ~2.5 KB of heap.
+*/
+#ifndef CRYPTO_ED25519_MAX_CACHED_TABLES
+#define CRYPTO_ED25519_MAX_CACHED_TABLES 2
+#endif
+
+/*
+* A table that is released right after the verify needs less headroom.
+*/
+#ifndef CRYPTO_ED25519_TRANSIENT_MIN_FREE_HEAP
+#define CRYPTO_ED25519_TRANSIENT_MIN_FREE_HEAP 4096
+#endif
+
+/*
+* Free stack required to put the table on the stack.
+*/
+#ifndef CRYPTO_ED25519_TABLE_MIN_FREE_STACK
+#define CRYPTO_ED25519_TABLE_MIN_FREE_STACK 3072
+#endif
+
+static crypto_ed25519_verify_engine_t gbVerifyEngine = CRYPTO_ED25519_VERIFY_AUTO;
+
+/*
+* Forces one verify engine (benchmarks, tests); CRYPTO_ED25519_VERIFY_AUTO
+* restores the choice by free memory. No effect with ED25519_SMALL.
+*/
+void crypto_ed25519_set_verify_engine(crypto_ed25519_verify_engine_t engine)
+{
+  gbVerifyEngine = engine;
+}
+
+#ifndef ED25519_SMALL
+#define ED25519_TABLE_SIZE (sizeof(ge_cached) * GE_DOUBLE_SCALARMULT_TABLE_SIZE)
+
+static int __attribute__((noinline)) crypto_ed25519_verify_stack_table(
+  ed25519_key* key, const ge_p3* A,
+  const byte* message, size_t message_size,
+  const byte* signature, size_t signature_size)
+{
+  ge_cached table[GE_DOUBLE_SCALARMULT_TABLE_SIZE];
+  int verified;
+
+  ge_double_scalarmult_precompute(table, A);
+  int r = wc_ed25519_verify_msg_table(
+    signature, signature_size,
+    message, message_size,
+    &verified, key, table
+  );
+  return (r == 0 && verified == 1) ? 0 : -1;
+}
+
+/*
+* Verify with the public key -A already uncompressed.
+* @param table  precomputed table of A or NULL
+*/
+static int crypto_ed25519_verify_point(
+  ed25519_key* key, const ge_p3* A, const ge_cached* table,
+  const byte* message, size_t message_size,
+  const byte* signature, size_t signature_size)
+{
+  const crypto_ed25519_verify_engine_t engine = gbVerifyEngine;
+  int verified;
+  int r;
+
+  if(table && (engine == CRYPTO_ED25519_VERIFY_AUTO || engine == CRYPTO_ED25519_VERIFY_HEAP_TABLE))
+  {
+    DEBUG("ed25519 verify: cached table");
+    r = wc_ed25519_verify_msg_table(
+      signature, signature_size,
+      message, message_size,
+      &verified, key, table
+    );
+    return (r == 0 && verified == 1) ? 0 : -1;
+  }
+
+  if(engine == CRYPTO_ED25519_VERIFY_HEAP_TABLE
+    || (engine == CRYPTO_ED25519_VERIFY_AUTO
+      && system_get_free_heap_size() >= CRYPTO_ED25519_TRANSIENT_MIN_FREE_HEAP + ED25519_TABLE_SIZE))
+  {
+    ge_cached* heap_table = malloc(ED25519_TABLE_SIZE);
+    if(heap_table)
+    {
+      DEBUG("ed25519 verify: heap table");
+      ge_double_scalarmult_precompute(heap_table, A);
+      r = wc_ed25519_verify_msg_table(
+        signature, signature_size,
+        message, message_size,
+        &verified, key, heap_table
+      );
+      free(heap_table);
+      return (r == 0 && verified == 1) ? 0 : -1;
+    }
+    if(engine == CRYPTO_ED25519_VERIFY_HEAP_TABLE)
+      return -1;
+  }
+
+  if(engine == CRYPTO_ED25519_VERIFY_STACK_TABLE
+    || (engine == CRYPTO_ED25519_VERIFY_AUTO
+      && homekit_free_stack() >= CRYPTO_ED25519_TABLE_MIN_FREE_STACK))
+  {
+    DEBUG("ed25519 verify: stack table");
+    return crypto_ed25519_verify_stack_table(key, A,
+      message, message_size, signature, signature_size);
+  }
+
+  DEBUG("ed25519 verify: low-mem");
+  r = wc_ed25519_verify_msg_point(
+    signature, signature_size,
+    message, message_size,
+    &verified, key, A
+  );
+  return (r == 0 && verified == 1) ? 0 : -1;
+}
+#endif
+
+
 int crypto_ed25519_verify(
   const ed25519_key* key,
   const byte* message, size_t message_size,
@@ -490,6 +661,12 @@ int crypto_ed25519_verify(
 {
   #if defined(ARDUINO_HOMEKIT_SKIP_ED25519_VERIFY)
   return 0;
+  #elif !defined(ED25519_SMALL)
+  ge_p3 A;
+  if(ge_frombytes_negate_vartime(&A, key->p) != 0)
+    return -1;
+  return crypto_ed25519_verify_point((ed25519_key*)key, &A, NULL,
+    message, message_size, signature, signature_size);
   #else
   int verified;
   int r = wc_ed25519_verify_msg(
@@ -497,8 +674,103 @@ int crypto_ed25519_verify(
     message, message_size,
     &verified, (ed25519_key*)key
   );
-  //return (r == 0) && (verified == 1);
-  return !r && !verified;
+  return (r == 0 && verified == 1) ? 0 : -1;
+  #endif
+}
+
+
+struct _ed25519_verify_cache
+{
+  ed25519_key key;   // public part only
+  ge_p3 A;           // -A, see ge_frombytes_negate_vartime
+  #ifndef ED25519_SMALL
+  ge_cached* table;  // -A,-3A,...,-15A or NULL
+  #endif
+};
+
+#ifndef ED25519_SMALL
+static int gbCachedTables = 0;
+
+/*
+* Called on each verify, so the table is only built for keys in use and
+* once memory allows it.
+*/
+static void crypto_ed25519_verify_cache_precompute(ed25519_verify_cache* cache)
+{
+  if(cache->table
+    || gbCachedTables >= CRYPTO_ED25519_MAX_CACHED_TABLES
+    || system_get_free_heap_size() < CRYPTO_ED25519_TABLE_MIN_FREE_HEAP + ED25519_TABLE_SIZE)
+  {
+    return;
+  }
+
+  cache->table = malloc(ED25519_TABLE_SIZE);
+  if(cache->table)
+  {
+    ge_double_scalarmult_precompute(cache->table, &cache->A);
+    ++gbCachedTables;
+  }
+}
+#endif
+
+
+ed25519_verify_cache* crypto_ed25519_verify_cache_new(const ed25519_key* key)
+{
+  if(key == NULL)
+    return NULL;
+
+  ed25519_verify_cache* cache = malloc(sizeof(ed25519_verify_cache));
+  if(cache == NULL)
+    return NULL;
+
+  memset(cache, 0, sizeof(*cache));
+  wc_ed25519_init(&cache->key);
+  memcpy(cache->key.p, key->p, ED25519_PUB_KEY_SIZE);
+
+  if(ge_frombytes_negate_vartime(&cache->A, cache->key.p) != 0)
+  {
+    DEBUG("Invalid ed25519 public key");
+    free(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+
+void crypto_ed25519_verify_cache_free(ed25519_verify_cache* cache)
+{
+  if(!cache)
+    return;
+  #ifndef ED25519_SMALL
+  if(cache->table)
+  {
+    free(cache->table);
+    --gbCachedTables;
+  }
+  #endif
+  free(cache);
+}
+
+
+int crypto_ed25519_verify_cached(
+  ed25519_verify_cache* cache,
+  const byte* message, size_t message_size,
+  const byte* signature, size_t signature_size)
+{
+  #if defined(ARDUINO_HOMEKIT_SKIP_ED25519_VERIFY)
+  return 0;
+  #elif !defined(ED25519_SMALL)
+  crypto_ed25519_verify_cache_precompute(cache);
+  return crypto_ed25519_verify_point(&cache->key, &cache->A, cache->table,
+    message, message_size, signature, signature_size);
+  #else
+  int verified;
+  int r = wc_ed25519_verify_msg_point(
+    signature, signature_size,
+    message, message_size,
+    &verified, &cache->key, &cache->A
+  );
+  return (r == 0 && verified == 1) ? 0 : -1;
   #endif
 }
 
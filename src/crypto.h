@@ -33,8 +33,10 @@ extern "C" {
   );
 
   // SRP
+  #ifndef WOLFCRYPT_SRP_H  // crypto.c: wolfcrypt/srp.h
   struct _Srp;
   typedef struct _Srp Srp;
+  #endif
 
 
   Srp* crypto_srp_new();
@@ -71,6 +73,17 @@ extern "C" {
     byte* decrypted, size_t* descrypted_size
   );
 
+  // AEAD with separate AAD, data and tag (16 bytes) spans.
+  // 'data' is encrypted/decrypted in place, word aligned data is faster.
+  int crypto_chacha20poly1305_encrypt_inplace(
+    const byte* key, const byte* nonce, const byte* aad, size_t aad_size,
+    byte* data, size_t data_size, byte* tag
+  );
+  int crypto_chacha20poly1305_decrypt_inplace(
+    const byte* key, const byte* nonce, const byte* aad, size_t aad_size,
+    byte* data, size_t data_size, const byte* tag
+  );
+
   // ED25519
   int crypto_ed25519_init(ed25519_key* key);
   ed25519_key* crypto_ed25519_new();
@@ -106,10 +119,36 @@ extern "C" {
     const byte* signature, size_t signature_size
   );
 
+  // ED25519 verify engine, see crypto.c
+  typedef enum
+  {
+    CRYPTO_ED25519_VERIFY_AUTO = 0,     // by free heap/stack
+    CRYPTO_ED25519_VERIFY_HEAP_TABLE,   // cached or transient heap table
+    CRYPTO_ED25519_VERIFY_STACK_TABLE,
+    CRYPTO_ED25519_VERIFY_LOWMEM,
+  } crypto_ed25519_verify_engine_t;
+
+  void crypto_ed25519_set_verify_engine(crypto_ed25519_verify_engine_t engine);
+
+  // ED25519 verify cache
+  // Public key of a controller kept uncompressed in RAM (~260 bytes). The
+  // precomputed table (1280 bytes) is added on the first verify if the free
+  // heap allows it, for at most CRYPTO_ED25519_MAX_CACHED_TABLES keys.
+  struct _ed25519_verify_cache;
+  typedef struct _ed25519_verify_cache ed25519_verify_cache;
+
+  ed25519_verify_cache* crypto_ed25519_verify_cache_new(const ed25519_key* key);
+  void crypto_ed25519_verify_cache_free(ed25519_verify_cache* cache);
+  int crypto_ed25519_verify_cached(
+    ed25519_verify_cache* cache,
+    const byte* message, size_t message_size,
+    const byte* signature, size_t signature_size
+  );
+
 
   // CURVE25519
   int crypto_curve25519_init(curve25519_key* key);
-  int crypto_curve25519_done(curve25519_key* key);
+  void crypto_curve25519_done(curve25519_key* key);
   int crypto_curve25519_generate(curve25519_key* key);
   int crypto_curve25519_import_public(
     curve25519_key* key,
@@ -0,0 +1,573 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>crypto_benchmark.c<< 19 Okt 2026  11:02:15 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include "port.h"
+#include "user_settings.h"
+#include <wolfssl/wolfcrypt/srp.h>
+#include "crypto.h"
+#include "crypto_benchmark.h"
+#include "watchdog.h"
+#include "homekit_debug.h"
+#include <wolfssl/wolfcrypt/hash.h>
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include <cont.h>
+#include <user_interface.h>
+#ifdef UMM_STATS_FULL
+#include <umm_malloc/umm_malloc.h>
+#endif
+extern cont_t* g_pcont;
+#endif
+
+#pragma endregion
+
+#pragma region Info
+/*
+* Each case runs its operation repeatedly for about BENCH_MIN_TIME_US
+* (at least once) and reports the average time.
+*
+* Peak stack: the free part of the cont stack below the caller is filled
+* with STACK_MARK before the case and scanned afterwards.
+* Peak heap: needs UMM_STATS_FULL (umm_free_heap_size_min); otherwise -1.
+* Code size is not measured per case; compare ESP.getSketchSize() of builds
+* with different user_settings.h (see crypto_benchmark_config), on a host
+* the test crypto_code_size (test/host).
+*
+* Ed25519 verify is measured with each engine forced
+* (crypto_ed25519_set_verify_engine). Signing and Curve25519 have one engine
+* per build: run the benchmark once in a default and once in an
+* ARDUINO_HOMEKIT_LOWROM build (ED25519_SMALL, CURVE25519_SMALL) and compare.
+*/
+#pragma endregion
+
+#pragma region Definitions
+#define BENCH_MIN_TIME_US 200000
+#define BENCH_MAX_OPS     1000
+#define STACK_MARK        0xfeefeffe
+
+typedef struct
+{
+  byte key[32];
+  byte nonce[12];
+  byte message[1024];
+  byte encrypted[1024 + 16];
+  size_t encrypted_size;
+  byte tag[16];
+
+  ed25519_key ed_key;
+  bool ed_key_valid;
+  byte signature[64];
+  ed25519_verify_cache* verify_cache;
+
+  curve25519_key curve_key;
+  curve25519_key curve_peer;
+  bool curve_valid;
+
+  Srp* srp;
+  byte srp_public_key[384];
+  size_t srp_public_key_size;
+  byte srp_proof[64];               // of the client, see setup_srp_verify
+  SrpHash srp_client_proof;         // state of the proof hashes before verify
+  SrpHash srp_server_proof;
+} bench_state_t;
+
+static bench_state_t* gbState = NULL;
+
+typedef struct
+{
+  const char* name;
+  bool (*setup)(bench_state_t*);  // unmeasured, optional
+  int (*op)(bench_state_t*);
+  bool once;                      // slow: measure a single operation
+  uint16_t bytes;                 // payload per operation (throughput)
+} bench_case_t;
+
+#pragma endregion
+
+#pragma region Setup functions
+static bool setup_ed25519(bench_state_t* s)
+{
+  if(!s->ed_key_valid)
+  {
+    if(crypto_ed25519_generate(&s->ed_key))
+      return false;
+    s->ed_key_valid = true;
+  }
+  size_t size = sizeof(s->signature);
+  return !crypto_ed25519_sign(&s->ed_key, s->message, 64, s->signature, &size);
+}
+
+static bool setup_ed25519_cached(bench_state_t* s)
+{
+  if(!setup_ed25519(s))
+    return false;
+  if(!s->verify_cache)
+    s->verify_cache = crypto_ed25519_verify_cache_new(&s->ed_key);
+  return s->verify_cache != NULL;
+}
+
+#ifndef ED25519_SMALL
+// the engine is reset to auto after each case (crypto_benchmark_run)
+static bool setup_ed25519_heap_table(bench_state_t* s)
+{
+  crypto_ed25519_set_verify_engine(CRYPTO_ED25519_VERIFY_HEAP_TABLE);
+  return setup_ed25519(s);
+}
+
+static bool setup_ed25519_stack_table(bench_state_t* s)
+{
+  crypto_ed25519_set_verify_engine(CRYPTO_ED25519_VERIFY_STACK_TABLE);
+  return setup_ed25519(s);
+}
+
+static bool setup_ed25519_lowmem(bench_state_t* s)
+{
+  crypto_ed25519_set_verify_engine(CRYPTO_ED25519_VERIFY_LOWMEM);
+  return setup_ed25519(s);
+}
+#endif
+
+static bool setup_curve25519(bench_state_t* s)
+{
+  if(!s->curve_valid)
+  {
+    if(crypto_curve25519_generate(&s->curve_key) || crypto_curve25519_generate(&s->curve_peer))
+      return false;
+    s->curve_valid = true;
+  }
+  return true;
+}
+
+static bool setup_srp_new(bench_state_t* s)
+{
+  if(s->srp)
+    crypto_srp_free(s->srp);
+  s->srp = crypto_srp_new();
+  return s->srp != NULL;
+}
+
+static bool setup_srp(bench_state_t* s)
+{
+  if(s->srp && s->srp_public_key_size)
+    return true;
+
+  watchdog_disable_all();
+  bool Ok = setup_srp_new(s)
+    && !crypto_srp_init(s->srp, "Pair-Setup", "111-11-111");
+  if(Ok)
+  {
+    s->srp_public_key_size = sizeof(s->srp_public_key);
+    Ok = !crypto_srp_get_public_key(s->srp, s->srp_public_key, &s->srp_public_key_size);
+  }
+  watchdog_enable_all();
+  return Ok;
+}
+
+/* A fresh server session and a client with the same username, password
+* and salt. The client proof is valid, so op_srp_verify measures a
+* successful verify.
+*/
+static bool setup_srp_verify(bench_state_t* s)
+{
+  s->srp_public_key_size = 0;
+  if(!setup_srp(s))
+    return false;
+
+  watchdog_disable_all();
+  Srp* client = crypto_srp_new();
+  byte N_ram[384], g_ram[4], client_key[384];
+  word32 N_size = (word32)mp_unsigned_bin_size(&s->srp->N);
+  word32 g_size = (word32)mp_unsigned_bin_size(&s->srp->g);
+  word32 client_key_size = sizeof(client_key);
+  word32 proof_size = sizeof(s->srp_proof);
+  bool Ok = client != NULL
+    && N_size <= sizeof(N_ram) && g_size <= sizeof(g_ram)
+    && !mp_to_unsigned_bin(&s->srp->N, N_ram)
+    && !mp_to_unsigned_bin(&s->srp->g, g_ram)
+    && !wc_SrpSetUsername(client, (const byte*)"Pair-Setup", 10)
+    && !wc_SrpSetParams(client, N_ram, N_size, g_ram, g_size, s->srp->salt, s->srp->saltSz)
+    && !wc_SrpSetPassword(client, (const byte*)"111-11-111", 10)
+    && !wc_SrpGetPublic(client, client_key, &client_key_size)
+    && !wc_SrpComputeKey(client, client_key, client_key_size, s->srp_public_key, (word32)s->srp_public_key_size)
+    && !wc_SrpGetProof(client, s->srp_proof, &proof_size)
+    && !crypto_srp_compute_key(s->srp, client_key, client_key_size, s->srp_public_key, s->srp_public_key_size);
+  if(client)
+    crypto_srp_free(client);
+  watchdog_enable_all();
+
+  s->srp_client_proof = s->srp->client_proof;
+  s->srp_server_proof = s->srp->server_proof;
+  return Ok;
+}
+
+static bool setup_chacha_decrypt(bench_state_t* s, size_t size)
+{
+  s->encrypted_size = sizeof(s->encrypted);
+  return !crypto_chacha20poly1305_encrypt(s->key, s->nonce, s->key, 2,
+    s->message, size, s->encrypted, &s->encrypted_size);
+}
+static bool setup_chacha_decrypt_64(bench_state_t* s) { return setup_chacha_decrypt(s, 64); }
+static bool setup_chacha_decrypt_512(bench_state_t* s) { return setup_chacha_decrypt(s, 512); }
+static bool setup_chacha_decrypt_1024(bench_state_t* s) { return setup_chacha_decrypt(s, 1024); }
+
+#pragma endregion
+
+#pragma region Operations
+static int op_sha512(bench_state_t* s)
+{
+  byte digest[WC_SHA512_DIGEST_SIZE];
+  return wc_Sha512Hash(s->message, 1024, digest);
+}
+
+static int op_hkdf(bench_state_t* s)
+{
+  const byte salt[] = "Control-Salt";
+  const byte info[] = "Control-Read-Encryption-Key";
+  byte output[HKDF_HASH_SIZE];
+  size_t size = sizeof(output);
+  return crypto_hkdf(s->key, sizeof(s->key), salt, sizeof(salt) - 1,
+    info, sizeof(info) - 1, output, &size);
+}
+
+static int op_chacha_encrypt(bench_state_t* s, size_t size)
+{
+  s->encrypted_size = sizeof(s->encrypted);
+  return crypto_chacha20poly1305_encrypt(s->key, s->nonce, s->key, 2,
+    s->message, size, s->encrypted, &s->encrypted_size);
+}
+static int op_chacha_encrypt_64(bench_state_t* s) { return op_chacha_encrypt(s, 64); }
+static int op_chacha_encrypt_512(bench_state_t* s) { return op_chacha_encrypt(s, 512); }
+static int op_chacha_encrypt_1024(bench_state_t* s) { return op_chacha_encrypt(s, 1024); }
+
+static int op_chacha_inplace_1024(bench_state_t* s)
+{
+  // 'encrypted' is word aligned; keeps encrypting its previous output
+  return crypto_chacha20poly1305_encrypt_inplace(s->key, s->nonce, s->key, 2,
+    s->encrypted, 1024, s->tag);
+}
+
+static int op_chacha_decrypt(bench_state_t* s)
+{
+  size_t size = sizeof(s->message);
+  return crypto_chacha20poly1305_decrypt(s->key, s->nonce, s->key, 2,
+    s->encrypted, s->encrypted_size, s->message, &size);
+}
+
+static int op_ed25519_generate(bench_state_t* s)
+{
+  int r = crypto_ed25519_generate(&s->ed_key);
+  s->ed_key_valid = !r;
+  return r;
+}
+
+static int op_ed25519_sign(bench_state_t* s)
+{
+  size_t size = sizeof(s->signature);
+  return crypto_ed25519_sign(&s->ed_key, s->message, 64, s->signature, &size);
+}
+
+static int op_ed25519_verify(bench_state_t* s)
+{
+  return crypto_ed25519_verify(&s->ed_key, s->message, 64, s->signature, sizeof(s->signature));
+}
+
+static int op_ed25519_verify_cached(bench_state_t* s)
+{
+  return crypto_ed25519_verify_cached(s->verify_cache, s->message, 64, s->signature, sizeof(s->signature));
+}
+
+static int op_curve25519_generate(bench_state_t* s)
+{
+  crypto_curve25519_done(&s->curve_peer);
+  return crypto_curve25519_generate(&s->curve_peer);
+}
+
+static int op_curve25519_shared_secret(bench_state_t* s)
+{
+  byte secret[CURVE25519_KEYSIZE];
+  size_t size = sizeof(secret);
+  return crypto_curve25519_shared_secret(&s->curve_key, &s->curve_peer, secret, &size);
+}
+
+static int op_srp_init(bench_state_t* s)
+{
+  return crypto_srp_init(s->srp, "Pair-Setup", "111-11-111");
+}
+
+static int op_srp_get_public_key(bench_state_t* s)
+{
+  s->srp_public_key_size = sizeof(s->srp_public_key);
+  return crypto_srp_get_public_key(s->srp, s->srp_public_key, &s->srp_public_key_size);
+}
+
+static int op_srp_compute_key(bench_state_t* s)
+{
+  // own public key as client key: valid group element, same cost
+  return crypto_srp_compute_key(s->srp,
+    s->srp_public_key, s->srp_public_key_size,
+    s->srp_public_key, s->srp_public_key_size);
+}
+
+static int op_srp_verify(bench_state_t* s)
+{
+  // a verify finalizes the proof hashes, each run starts from the saved state
+  s->srp->client_proof = s->srp_client_proof;
+  s->srp->server_proof = s->srp_server_proof;
+  return crypto_srp_verify(s->srp, s->srp_proof, sizeof(s->srp_proof));
+}
+
+static int op_srp_hkdf(bench_state_t* s)
+{
+  const byte salt[] = "Pair-Setup-Encrypt-Salt";
+  const byte info[] = "Pair-Setup-Encrypt-Info";
+  byte output[HKDF_HASH_SIZE];
+  size_t size = sizeof(output);
+  return crypto_srp_hkdf(s->srp, salt, sizeof(salt) - 1, info, sizeof(info) - 1, output, &size);
+}
+
+#pragma endregion
+
+#pragma region Cases
+#define BENCH_NAME(id, text) static const char id[] PROGMEM = text;
+BENCH_NAME(N_SHA512, "SHA-512 1 KB")
+BENCH_NAME(N_HKDF, "HKDF-SHA512")
+BENCH_NAME(N_ENC64, "ChaCha20-Poly1305 encrypt 64 B")
+BENCH_NAME(N_ENC512, "ChaCha20-Poly1305 encrypt 512 B")
+BENCH_NAME(N_ENC1K, "ChaCha20-Poly1305 encrypt 1 KB")
+BENCH_NAME(N_ENCIP1K, "ChaCha20-Poly1305 in-place 1 KB")
+BENCH_NAME(N_DEC64, "ChaCha20-Poly1305 decrypt 64 B")
+BENCH_NAME(N_DEC512, "ChaCha20-Poly1305 decrypt 512 B")
+BENCH_NAME(N_DEC1K, "ChaCha20-Poly1305 decrypt 1 KB")
+BENCH_NAME(N_EDGEN, "Ed25519 generate")
+BENCH_NAME(N_EDSIGN, "Ed25519 sign")
+BENCH_NAME(N_EDVERIFY, "Ed25519 verify")
+BENCH_NAME(N_EDVERIFYC, "Ed25519 verify (cached key)")
+#ifndef ED25519_SMALL
+BENCH_NAME(N_EDVERIFYH, "Ed25519 verify (heap table)")
+BENCH_NAME(N_EDVERIFYS, "Ed25519 verify (stack table)")
+BENCH_NAME(N_EDVERIFYL, "Ed25519 verify (low-mem)")
+#endif
+BENCH_NAME(N_CVGEN, "Curve25519 generate")
+BENCH_NAME(N_CVSHARED, "Curve25519 shared secret")
+BENCH_NAME(N_SRPINIT, "SRP init (verifier)")
+BENCH_NAME(N_SRPPUB, "SRP public key")
+BENCH_NAME(N_SRPKEY, "SRP compute key")
+BENCH_NAME(N_SRPVERIFY, "SRP verify")
+BENCH_NAME(N_SRPHKDF, "SRP HKDF")
+#undef BENCH_NAME
+
+static const bench_case_t gbCases[] =
+{
+  { N_SHA512,    NULL,                      op_sha512,                   false, 1024 },
+  { N_HKDF,      NULL,                      op_hkdf,                     false,    0 },
+  { N_ENC64,     NULL,                      op_chacha_encrypt_64,        false,   64 },
+  { N_ENC512,    NULL,                      op_chacha_encrypt_512,       false,  512 },
+  { N_ENC1K,     NULL,                      op_chacha_encrypt_1024,      false, 1024 },
+  { N_ENCIP1K,   NULL,                      op_chacha_inplace_1024,      false, 1024 },
+  { N_DEC64,     setup_chacha_decrypt_64,   op_chacha_decrypt,           false,   64 },
+  { N_DEC512,    setup_chacha_decrypt_512,  op_chacha_decrypt,           false,  512 },
+  { N_DEC1K,     setup_chacha_decrypt_1024, op_chacha_decrypt,           false, 1024 },
+  { N_EDGEN,     NULL,                      op_ed25519_generate,         false,    0 },
+  { N_EDSIGN,    setup_ed25519,             op_ed25519_sign,             false,    0 },
+  { N_EDVERIFY,  setup_ed25519,             op_ed25519_verify,           false,    0 },
+  { N_EDVERIFYC, setup_ed25519_cached,      op_ed25519_verify_cached,    false,    0 },
+#ifndef ED25519_SMALL
+  { N_EDVERIFYH, setup_ed25519_heap_table,  op_ed25519_verify,           false,    0 },
+  { N_EDVERIFYS, setup_ed25519_stack_table, op_ed25519_verify,           false,    0 },
+  { N_EDVERIFYL, setup_ed25519_lowmem,      op_ed25519_verify,           false,    0 },
+#endif
+  { N_CVGEN,     setup_curve25519,          op_curve25519_generate,      false,    0 },
+  { N_CVSHARED,  setup_curve25519,          op_curve25519_shared_secret, false,    0 },
+  { N_SRPINIT,   setup_srp_new,             op_srp_init,                 true,     0 },
+  { N_SRPPUB,    setup_srp,                 op_srp_get_public_key,       true,     0 },
+  { N_SRPKEY,    setup_srp,                 op_srp_compute_key,          true,     0 },
+  { N_SRPVERIFY, setup_srp_verify,          op_srp_verify,               false,    0 },
+  { N_SRPHKDF,   setup_srp,                 op_srp_hkdf,                 false,    0 },
+};
+
+#pragma endregion
+
+#pragma region Stack measurement
+#ifdef ARDUINO_ARCH_ESP8266
+/* Fills the free cont stack below the caller with STACK_MARK.
+* @return stack pointer of the caller, NULL if not on the cont stack
+*/
+static uint32_t* __attribute__((noinline)) stack_paint()
+{
+  uint32_t* bottom = &g_pcont->stack[0];
+  uint32_t* sp = (uint32_t*)__builtin_frame_address(0);
+  if(sp <= bottom || sp > &g_pcont->stack[CONT_STACKSIZE / 4])
+    return NULL;
+
+  // keep clear of this frame
+  for(uint32_t* p = bottom; p < sp - 32; ++p)
+    *p = STACK_MARK;
+  return sp;
+}
+
+static uint32_t stack_peak(const uint32_t* sp)
+{
+  const uint32_t* p = &g_pcont->stack[0];
+  while(p < sp && *p == STACK_MARK)
+    ++p;
+  return (uint32_t)((sp - p) * sizeof(uint32_t));
+}
+#else
+static uint32_t* stack_paint() { return NULL; }
+static uint32_t stack_peak(const uint32_t* sp) { (void)sp; return 0; }
+#endif
+
+#pragma endregion
+
+
+#pragma region crypto_benchmark_count
+int crypto_benchmark_count()
+{
+  return sizeof(gbCases) / sizeof(gbCases[0]);
+}
+
+#pragma endregion
+
+#pragma region crypto_benchmark_run
+bool crypto_benchmark_run(int index, crypto_benchmark_result_t* result)
+{
+  if(index < 0 || index >= crypto_benchmark_count())
+    return false;
+
+  const bench_case_t* Case = &gbCases[index];
+  memset(result, 0, sizeof(*result));
+  result->name = Case->name;
+  result->peak_heap = -1;
+
+  if(!gbState)
+  {
+    gbState = (bench_state_t*)malloc(sizeof(bench_state_t));
+    if(!gbState)
+    {
+      result->result = -1;
+      return true;
+    }
+    memset(gbState, 0, sizeof(*gbState));
+    homekit_random_fill(gbState->key, sizeof(gbState->key));
+    homekit_random_fill(gbState->nonce, sizeof(gbState->nonce));
+    homekit_random_fill(gbState->message, sizeof(gbState->message));
+  }
+
+  if(Case->setup && !Case->setup(gbState))
+  {
+    crypto_ed25519_set_verify_engine(CRYPTO_ED25519_VERIFY_AUTO);
+    ERROR("Crypto benchmark: setup of case %d failed", index);
+    result->result = -1;
+    return true;
+  }
+
+  watchdog_disable_all();
+
+  #ifdef UMM_STATS_FULL
+  size_t HeapBefore = system_get_free_heap_size();
+  umm_free_heap_size_min_reset();
+  #endif
+  uint32_t* SP = stack_paint();
+
+  uint32_t Ops = 0;
+  uint32_t Start = micros();
+  uint32_t Elapsed;
+  do
+  {
+    result->result = Case->op(gbState);
+    ++Ops;
+    Elapsed = micros() - Start;
+  } while(!Case->once && Elapsed < BENCH_MIN_TIME_US && Ops < BENCH_MAX_OPS);
+
+  if(SP)
+    result->peak_stack = stack_peak(SP);
+  #ifdef UMM_STATS_FULL
+  result->peak_heap = (int32_t)(HeapBefore - umm_free_heap_size_min());
+  #endif
+
+  watchdog_enable_all();
+  crypto_ed25519_set_verify_engine(CRYPTO_ED25519_VERIFY_AUTO);
+
+  result->ops = Ops;
+  result->us_per_op = Elapsed / Ops;
+  result->bytes = Case->bytes;
+  #ifdef ARDUINO_ARCH_ESP8266
+  result->cycles_per_op = (uint32_t)((uint64_t)Elapsed * system_get_cpu_freq() / Ops);
+  #endif
+
+  char Name[40];
+  strncpy_P(Name, result->name, sizeof(Name) - 1);
+  Name[sizeof(Name) - 1] = 0;
+  VERBOSE("Crypto benchmark: %s %u us/op %u cycles/op (%u ops) stack %u heap %d -> %d",
+    Name, result->us_per_op, result->cycles_per_op, Ops, result->peak_stack, result->peak_heap, result->result);
+  return true;
+}
+
+#pragma endregion
+
+#pragma region crypto_benchmark_done
+void crypto_benchmark_done()
+{
+  if(!gbState)
+    return;
+
+  crypto_ed25519_verify_cache_free(gbState->verify_cache);
+  if(gbState->curve_valid)
+  {
+    crypto_curve25519_done(&gbState->curve_key);
+    crypto_curve25519_done(&gbState->curve_peer);
+  }
+  if(gbState->srp)
+    crypto_srp_free(gbState->srp);
+  free(gbState);
+  gbState = NULL;
+}
+
+#pragma endregion
+
+#pragma region crypto_benchmark_config
+#define BENCH_STR_(x) #x
+#define BENCH_STR(x) BENCH_STR_(x)
+
+const char* crypto_benchmark_config()
+{
+  static const char Config[] PROGMEM = ""
+  #ifdef ARDUINO_HOMEKIT_LOWROM
+    "ARDUINO_HOMEKIT_LOWROM "
+  #endif
+  #ifdef ED25519_SMALL
+    "ED25519_SMALL "
+  #endif
+  #ifdef CURVE25519_SMALL
+    "CURVE25519_SMALL "
+  #endif
+  #ifdef ESP_GE_DOUBLE_SCALARMULT_VARTIME_LOWMEM
+    "ESP_GE_DOUBLE_SCALARMULT_VARTIME_LOWMEM "
+  #endif
+  #ifdef ESP_SHA512_TRANSFORM_32BIT
+    "ESP_SHA512_TRANSFORM_32BIT "
+  #endif
+  #ifdef ESP_INTEGER_WINSIZE
+    "ESP_INTEGER_WINSIZE=" BENCH_STR(ESP_INTEGER_WINSIZE) " "
+  #endif
+  #ifdef ESP_FORCE_S_MP_EXPTMOD
+    "ESP_FORCE_S_MP_EXPTMOD "
+  #endif
+  #ifdef MP_16BIT
+    "MP_16BIT "
+  #endif
+  #ifdef ARDUINO_HOMEKIT_SKIP_ED25519_VERIFY
+    "ARDUINO_HOMEKIT_SKIP_ED25519_VERIFY "
+  #endif
+    ;
+  return Config;
+}
+
+#pragma endregion
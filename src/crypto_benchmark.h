@@ -0,0 +1,68 @@
+#pragma region Prolog
+#ifndef __CRYPTO_BENCHMARK_H__
+#define __CRYPTO_BENCHMARK_H__
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>crypto_benchmark.h<< 19 Okt 2026  10:12:40 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#pragma endregion
+
+#pragma region crypto_benchmark_result_t
+/* Result of one benchmark case.
+* @see crypto_benchmark_run
+*/
+typedef struct
+{
+  const char* name;     // PROGMEM
+  uint32_t    ops;      // number of measured operations
+  uint32_t    us_per_op;
+  uint32_t    cycles_per_op; // 0 if unknown (host)
+  uint32_t    bytes;      // payload per operation, 0 if not a throughput case
+  uint32_t    peak_stack; // bytes, 0 if unknown
+  int32_t     peak_heap;  // bytes, -1 if unknown
+  int         result;     // return code of the last operation
+} crypto_benchmark_result_t;
+
+#pragma endregion
+
+/* Number of benchmark cases.
+*/
+int crypto_benchmark_count();
+
+/* Runs one benchmark case and fills 'result'.
+* Cases depend on their predecessors (e.g. SRP compute needs SRP init),
+* missing state is prepared without being measured.
+* @note Runs for up to ~20 s (SRP) with the watchdogs disabled.
+* @return false if index is out of range
+*/
+bool crypto_benchmark_run(int index, crypto_benchmark_result_t* result);
+
+/* Releases the state kept between the cases.
+*/
+void crypto_benchmark_done();
+
+/* Compile-time crypto configuration (user_settings.h) as text, PROGMEM.
+*/
+const char* crypto_benchmark_config();
+
+
+#pragma region Epilog
+#ifdef __cplusplus
+}
+#endif
+#endif // __CRYPTO_BENCHMARK_H__
+
+#pragma endregion
@@ -12,7 +12,11 @@
 extern "C" {
 #endif
 
+#ifdef HOMEKIT_FLASH_SIM
+#include "host_shim.h"
+#else
 #include <pgmspace.h>
+#endif
 #include <stdint.h>
 #include <string.h>
 
@@ -0,0 +1,148 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>flash_sim.c<< 19 Okt 2026  14:05:10 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#ifdef HOMEKIT_FLASH_SIM
+#pragma region Includes
+#include <string.h>
+#include "flash_sim.h"
+
+#pragma endregion
+
+#pragma region Definitions
+#define SIM_SIZE (HOMEKIT_FLASH_SIM_SECTORS * SPI_FLASH_SEC_SIZE)
+
+static uint8_t sim_flash[SIM_SIZE];
+static homekit_flash_sim_sector_t sim_sectors[HOMEKIT_FLASH_SIM_SECTORS];
+static long sim_power_budget = -1;   // bytes until the power fail, -1: never
+static bool sim_power_failed = false;
+
+#pragma endregion
+
+#pragma region Helpers
+static bool sim_in_range(uint32_t addr, size_t size)
+{
+  return addr < SIM_SIZE && size <= SIM_SIZE - addr;
+}
+
+/* Takes up to 'size' bytes from the budget.
+* @return The bytes that may still be written.
+*/
+static size_t sim_consume(size_t size)
+{
+  if(sim_power_failed)
+    return 0;
+  if(sim_power_budget < 0)
+    return size;
+  if((long)size >= sim_power_budget)
+  {
+    size = sim_power_budget;
+    sim_power_budget = 0;
+    sim_power_failed = true;
+    return size;
+  }
+  sim_power_budget -= size;
+  return size;
+}
+
+#pragma endregion
+
+#pragma region homekit_flash_sim_reset
+void homekit_flash_sim_reset()
+{
+  memset(sim_flash, 0xff, sizeof(sim_flash));
+  memset(sim_sectors, 0, sizeof(sim_sectors));
+  sim_power_budget = -1;
+  sim_power_failed = false;
+}
+
+#pragma endregion
+
+#pragma region read / write / erase
+bool homekit_flash_sim_read(uint32_t addr, void* buffer, size_t size)
+{
+  if(!sim_in_range(addr, size))
+    return false;
+  memcpy(buffer, &sim_flash[addr], size);
+  return true;
+}
+
+bool homekit_flash_sim_write(uint32_t addr, const void* data, size_t size)
+{
+  if(!sim_in_range(addr, size))
+    return false;
+
+  // a write may span sectors, count it in the first
+  homekit_flash_sim_sector_t* s = &sim_sectors[addr / SPI_FLASH_SEC_SIZE];
+  s->writes++;
+
+  size_t n = sim_consume(size);
+  const uint8_t* p = (const uint8_t*)data;
+  for(size_t i = 0; i < n; i++)
+    sim_flash[addr + i] &= p[i];   // NOR: bits are only cleared
+  s->bytes_written += n;
+  return true;
+}
+
+bool homekit_flash_sim_erase_sector(uint32_t addr)
+{
+  addr &= ~(uint32_t)(SPI_FLASH_SEC_SIZE - 1);
+  if(!sim_in_range(addr, SPI_FLASH_SEC_SIZE))
+    return false;
+
+  if(sim_consume(1) == 0)
+    return true;
+
+  sim_sectors[addr / SPI_FLASH_SEC_SIZE].erases++;
+  if(sim_power_failed)
+  {
+    // cut in the middle: partly erased, the rest keeps old content
+    memset(&sim_flash[addr], 0xff, SPI_FLASH_SEC_SIZE / 2);
+    return true;
+  }
+  memset(&sim_flash[addr], 0xff, SPI_FLASH_SEC_SIZE);
+  return true;
+}
+
+#pragma endregion
+
+#pragma region Inspection
+uint8_t* homekit_flash_sim_data()
+{
+  return sim_flash;
+}
+
+const homekit_flash_sim_sector_t* homekit_flash_sim_sector(int index)
+{
+  if(index < 0 || index >= HOMEKIT_FLASH_SIM_SECTORS)
+    return NULL;
+  return &sim_sectors[index];
+}
+
+#pragma endregion
+
+#pragma region Power fail
+void homekit_flash_sim_power_fail_after(long bytes)
+{
+  sim_power_budget = bytes;
+  sim_power_failed = false;
+}
+
+bool homekit_flash_sim_power_failed()
+{
+  return sim_power_failed;
+}
+
+void homekit_flash_sim_power_on()
+{
+  sim_power_budget = -1;
+  sim_power_failed = false;
+}
+
+#pragma endregion
+
+#endif // HOMEKIT_FLASH_SIM
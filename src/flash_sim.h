@@ -0,0 +1,101 @@
+#pragma region Prolog
+#ifndef __FLASH_SIM_H__
+#define __FLASH_SIM_H__
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>flash_sim.h<< 19 Okt 2026  14:05:10 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#pragma endregion
+
+/* Flash simulator for host builds (-DHOMEKIT_FLASH_SIM), used by port.h
+* instead of the SDK: storage.c, CSimpleFileSystem and CTimeSeriesStore
+* run unchanged on Linux, e.g. to measure erases or to test the recovery.
+* - NOR semantics: an erase sets a sector to 0xff, a write only clears bits.
+* - Erases, writes and written bytes are counted per sector.
+* - Power fail: after a given number of bytes (an erase counts 1) the
+*   running operation is cut, all further ones are ignored until
+*   homekit_flash_sim_power_on. A cut write programs only its first bytes,
+*   a cut erase leaves the sector partly erased.
+*
+* Layout of the simulated window (sector indexes, as Arduino 4MB/FS:2MB):
+* |FS ...|free|EEPROM|RF cal|WiFi config (SDK) x3|
+*/
+#pragma region Layout
+#define SPI_FLASH_SEC_SIZE 4096
+#define SPI_FLASH_SECTOR_SIZE SPI_FLASH_SEC_SIZE
+
+#ifndef HOMEKIT_FLASH_SIM_SECTORS
+#define HOMEKIT_FLASH_SIM_SECTORS 16
+#endif
+#ifndef HOMEKIT_FLASH_SIM_FREE_SECTORS
+#define HOMEKIT_FLASH_SIM_FREE_SECTORS 1 // between the file system and the EEPROM
+#endif
+
+#define HOMEKIT_FLASH_SIM_EEPROM_ADDR ((HOMEKIT_FLASH_SIM_SECTORS - 5) * SPI_FLASH_SEC_SIZE)
+#define HOMEKIT_FLASH_SIM_FS_END_ADDR (HOMEKIT_FLASH_SIM_EEPROM_ADDR - HOMEKIT_FLASH_SIM_FREE_SECTORS * SPI_FLASH_SEC_SIZE)
+
+// as flash_hal.h
+#define FS_PHYS_ADDR 0
+#define FS_PHYS_SIZE HOMEKIT_FLASH_SIM_FS_END_ADDR
+
+#pragma endregion
+
+#pragma region homekit_flash_sim_sector_t
+typedef struct
+{
+  uint32_t erases;
+  uint32_t writes;
+  uint32_t bytes_written;
+} homekit_flash_sim_sector_t;
+
+#pragma endregion
+
+/* Erases the whole window and clears the counters and the power fail.
+*/
+void homekit_flash_sim_reset();
+
+bool homekit_flash_sim_read(uint32_t addr, void* buffer, size_t size);
+bool homekit_flash_sim_write(uint32_t addr, const void* data, size_t size);
+bool homekit_flash_sim_erase_sector(uint32_t addr);
+
+/* Content of the window, e.g. to save or restore a state.
+*/
+uint8_t* homekit_flash_sim_data();
+
+/* Counters of a sector, NULL if out of range.
+*/
+const homekit_flash_sim_sector_t* homekit_flash_sim_sector(int index);
+
+/* Cuts the power after 'bytes' written bytes, -1 disables.
+*/
+void homekit_flash_sim_power_fail_after(long bytes);
+
+/* @return true if the power has been cut.
+*/
+bool homekit_flash_sim_power_failed();
+
+/* Ends a power fail, e.g. before the next "boot".
+*/
+void homekit_flash_sim_power_on();
+
+
+#pragma region Epilog
+#ifdef __cplusplus
+}
+#endif
+#endif // __FLASH_SIM_H__
+
+#pragma endregion
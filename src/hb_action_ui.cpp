@@ -110,6 +110,12 @@ CController& InstallActionUI(CController& c)
 
     #pragma endregion
 
+    // depend on their arguments only
+    .TrackVar("ACTION_BUTTON")
+    .TrackVar("ACTION_CHECKBOX")
+    .HideVar("ACTION_BUTTON")
+    .HideVar("ACTION_CHECKBOX")
+
     //END Variables
     #pragma endregion
 
@@ -153,9 +159,67 @@ function SetVar(varName, varValue)
     });
 }
 
+function ForVars(varNames, functor)
+{
+  fetch('/var?batch=' + varNames.join(','))
+    .then(response =>
+      {
+        if(!response.ok)
+        {
+          throw new Error('Network response was not OK ' + response.statusText);
+        }
+        return response.json();
+      })
+    .then(values =>
+      {
+        functor(values);
+      })
+    .catch(error =>
+      {
+        console.error('Error:', error);
+        functor(null, 'Error: ' + error.message);
+      })
+  ;
+}
+
+var PendingVars = null;
+
+function FlushPendingVars()
+{
+  var Pending = PendingVars;
+  PendingVars = null;
+
+  if(Pending.length == 1)
+  {
+    InvokeAction(Pending[0].name, Pending[0].functor);
+    return;
+  }
+
+  var Names = [];
+  Pending.forEach(p => { if(!Names.includes(p.name)) Names.push(p.name); });
+  ForVars(Names, function(values, errorText)
+    {
+      Pending.forEach(p =>
+        {
+          if(values == null)
+            p.functor(errorText);
+          else if(values[p.name] == null)
+            p.functor('Error: ' + p.name + ' not found');
+          else
+            p.functor(values[p.name]);
+        });
+    });
+}
+
 function ForVar(varName, functor)
 {
-  InvokeAction(varName, functor);
+  // collect the calls of this script run into one batch request
+  if(PendingVars == null)
+  {
+    PendingVars = [];
+    setTimeout(FlushPendingVars, 0);
+  }
+  PendingVars.push({ name: varName, functor: functor });
 }
 
 function ForSetVar(varName, varValue, functor)
@@ -163,6 +227,96 @@ function ForSetVar(varName, varValue, functor)
   InvokeAction(varName + '=' + varValue, functor);
 }
 
+/* Live updates, pushed by the device via Server-Sent Events ("/events"),
+ * polled if the device has no free event channel.
+ */
+var VarWatchers = [];
+var LogWatcher = null;
+var WatchingStarted = false;
+
+function WatchVar(varName, intervalMS, functor)
+{
+  VarWatchers.push({ name: varName, interval: intervalMS, functor: functor });
+  StartWatching();
+}
+
+function WatchLog(functor, pollFunction)
+{
+  LogWatcher = { functor: functor, poll: pollFunction, next: 0 };
+  StartWatching();
+}
+
+function PollWatchers()
+{
+  var Intervals = [];
+  VarWatchers.forEach(w => { if(!Intervals.includes(w.interval)) Intervals.push(w.interval); });
+  Intervals.forEach(interval =>
+    {
+      var Poll = function()
+        {
+          VarWatchers.forEach(w =>
+            {
+              if(w.interval != interval)
+                return;
+              var Sep = w.name.indexOf(':');
+              if(Sep < 0)
+                ForVar(w.name, w.functor);
+              else
+                ForSetVar(w.name.substring(0, Sep), w.name.substring(Sep + 1), w.functor);
+            });
+        };
+      Poll();
+      setInterval(Poll, interval);
+    });
+
+  if(LogWatcher && LogWatcher.poll)
+  {
+    LogWatcher.poll();
+    setInterval(LogWatcher.poll, 1000);
+  }
+}
+
+function StartWatching()
+{
+  if(WatchingStarted)
+    return;
+  WatchingStarted = true;
+
+  // all watchers of this script run share one connection
+  setTimeout(function()
+    {
+      if(typeof(EventSource) === 'undefined')
+      {
+        PollWatchers();
+        return;
+      }
+
+      var Names = [];
+      VarWatchers.forEach(w => { if(!Names.includes(w.name)) Names.push(w.name); });
+      var Url = '/events?vars=' + Names.join(',');
+      if(LogWatcher)
+        Url += '&log=' + LogWatcher.next;
+
+      var Source = new EventSource(Url);
+      Source.addEventListener('vars', e =>
+        {
+          var Values = JSON.parse(e.data);
+          VarWatchers.forEach(w => { if(w.name in Values) w.functor(Values[w.name]); });
+        });
+      Source.addEventListener('log', e =>
+        {
+          LogWatcher.next = parseInt(e.lastEventId) + 1;
+          LogWatcher.functor(JSON.parse(e.data));
+        });
+      Source.onerror = function()
+        {
+          // refused (e.g. no free channel); otherwise it reconnects by itself
+          if(Source.readyState == EventSource.CLOSED)
+            PollWatchers();
+        };
+    }, 0);
+}
+
 
 )"));
 }
@@ -0,0 +1,216 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>hb_crypto_menu.cpp<< 19 Okt 2026  11:02:17 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Spelling
+// Ignore Spelling: benchtab
+#pragma endregion
+#pragma region Includes
+#include <Arduino.h>
+#include "hb_homekit.h"
+#include "crypto_benchmark.h"
+
+namespace HBHomeKit
+{
+namespace
+{
+#pragma endregion
+
+#pragma region Crypto_CCS
+CTextEmitter Crypto_CCS()
+{
+  return MakeTextEmitter(F(R"(
+#benchtab td, #benchtab th {
+  padding: 0.2em 0.6em;
+}
+#benchtab th {
+  padding-top: 0.5em;
+  padding-bottom: 0.5em;
+  text-align: center;
+  background-color: #888;
+  color: black;
+}
+#benchtab td:not(:first-child) {
+  text-align: right;
+}
+#benchtab .error {
+  background-color: #a22;
+}
+#benchtab tr:nth-child(even){background-color: #222;}
+)"));
+}
+#pragma endregion
+
+#pragma region Crypto_JavaScript
+CTextEmitter Crypto_JavaScript()
+{
+  return MakeTextEmitter(F(R"(
+
+function AddBenchEntry(message)
+{
+  var table = document.getElementById("benchtab");
+  var cells = message.split('\t');
+  var row = table.insertRow(-1);
+  if(cells[cells.length - 1] != "0")
+    row.className = "error";
+
+  for(var i = 0; i < cells.length; ++i)
+  {
+    var cell = row.insertCell(i);
+    cell.className = row.className;
+    cell.innerHTML = cells[i];
+  }
+}
+
+function RunBench(index)
+{
+  document.getElementById("benchstate").innerHTML = "Running case " + (index + 1) + " ...";
+  ForSetVar('CRYPTO_BENCH', index, function(text)
+    {
+      if(text.length > 0)
+      {
+        AddBenchEntry(text);
+        RunBench(index + 1);
+      }
+      else
+      {
+        document.getElementById("benchstate").innerHTML = "Done";
+        document.getElementById("benchstart").disabled = false;
+      }
+    });
+}
+
+function StartBench()
+{
+  document.getElementById("benchstart").disabled = true;
+  RunBench(0);
+}
+
+)"));
+}
+#pragma endregion
+
+#pragma region Crypto_Html
+const __FlashStringHelper* Crypto_Html()
+{
+  return F(R"(
+  <p>Configuration: <b>{CRYPTO_CONFIG}</b></p>
+  <p>The benchmark blocks the device for about a minute,
+  HomeKit requests are not answered meanwhile.</p>
+  <button id='benchstart' onclick='StartBench()'>Start</button>
+  <span id='benchstate'></span>
+  <table id='benchtab'>
+  <tr><th>Case</th><th>&micro;s/op</th><th>Cycles/op</th><th>Bytes/cycle</th><th>Ops</th><th>Stack</th><th>Heap</th><th>Result</th></tr>
+
+  </table>
+)");
+}
+#pragma endregion
+
+
+
+#pragma region AddCryptoBenchmarkMenu
+} // namespace
+
+
+CController& AddCryptoBenchmarkMenu(CController& c)
+{
+  c
+
+    #pragma region Variables
+    #pragma region CRYPTO_BENCH
+    .SetVar("CRYPTO_BENCH", [&](auto p)
+      {
+        String Result;
+        if(p.Args[0] != nullptr)
+        {
+          int Index = convert_value<int>(*p.Args[0]);
+          crypto_benchmark_result_t R;
+          if(crypto_benchmark_run(Index, &R))
+          {
+            Result.reserve(64);
+            Result += FPSTR(R.name);
+            Result += '\t';
+            Result += R.us_per_op;
+            Result += '\t';
+            Result += R.cycles_per_op;
+            Result += '\t';
+            if(R.bytes && R.cycles_per_op)
+              Result += String((float)R.bytes / R.cycles_per_op, 3);
+            else
+              Result += '-';
+            Result += '\t';
+            Result += R.ops;
+            Result += '\t';
+            Result += R.peak_stack;
+            Result += '\t';
+            if(R.peak_heap >= 0)
+              Result += R.peak_heap;
+            else
+              Result += '-';
+            Result += '\t';
+            Result += R.result;
+          }
+          else
+          {
+            crypto_benchmark_done();
+          }
+        }
+        return MakeTextEmitter(Result);
+      })
+    .HideVar("CRYPTO_BENCH")
+
+    #pragma endregion
+
+    #pragma region CRYPTO_CONFIG
+    .SetVar("CRYPTO_CONFIG", [](auto)
+      {
+        String Result(FPSTR(crypto_benchmark_config()));
+        Result += F(", sketch ");
+        Result += ESP.getSketchSize();
+        Result += F(" bytes");
+        return MakeTextEmitter(Result);
+      })
+    .TrackVar("CRYPTO_CONFIG")
+
+    #pragma endregion
+
+    //END Variables
+    #pragma endregion
+
+    #pragma region Menu
+    .AddMenuItem
+    (
+      {
+        .Title = "Crypto Benchmark",
+        .MenuName = "Crypto",
+        .URI = "/crypto",
+        .LowMemoryUsage = true,
+        .SpecialMenu = true,
+        .CSS = Crypto_CCS(),
+        .JavaScript = [](Stream& out)
+          {
+            out << ActionUI_JavaScript();
+            out << Crypto_JavaScript();
+          },
+        .BodyText = Crypto_Html()
+      }
+    )
+    //END Menus
+    #pragma endregion
+
+    ;
+
+  return c;
+}
+
+#pragma endregion
+
+
+#pragma region Epilog
+} // namespace HBHomeKit
+#pragma endregion
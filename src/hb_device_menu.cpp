@@ -73,6 +73,7 @@ void Model(Stream& out)
 #pragma region FirmwareUpdateStat
 static String gbFirmwareUpdateStat;
 static bool gbUpdatingFirmware = false;
+static bool gbFirmwareUpdatePending = false;
 
 void FirmwareUpdateStat(Stream& out)
 {
@@ -172,16 +173,23 @@ CController& AddDeviceMenu(CController& c)
         if(p.Args[0] != nullptr)
         {
           INFO("START_UPDATE_FIRMWARE Button pressed");
-          if(!gbUpdatingFirmware)
+          if(!gbUpdatingFirmware && !gbFirmwareUpdatePending)
           {
             gbFirmwareUpdateStat.clear();
-
-            if(UpdatingFirmware(c))
-              gbUpdatingFirmware = true;
+            gbFirmwareUpdatePending = true;
+
+            // the download takes a while: answer the request first
+            c.Defer([&c]
+              {
+                gbFirmwareUpdatePending = false;
+                if(UpdatingFirmware(c))
+                  gbUpdatingFirmware = true;
+              }, 0, true);
           }
         }
         return MakeTextEmitter();
       })
+    .HideVar("START_UPDATE_FIRMWARE")
 
 
     //END Variables
@@ -200,7 +208,7 @@ CController& AddDeviceMenu(CController& c)
         .JavaScript = [](Stream& out)
         {
           out << ActionUI_JavaScript();
-          out << F(R"(
+          out << MakeTextEmitter(F(R"(
 var LastBootTime = '';
 
 function SetDiv(divID, value)
@@ -234,30 +242,15 @@ function OnStartUpdateFirmware()
 
 window.addEventListener('load', (event) =>
 {
-  setInterval
-  ( 
-    function() 
-    { 
-      ForVar('TIME', responseText => SetDiv('time', responseText) );
-      ForVar('FIRMWARE_UPDATE_STA', responseText => SetDiv('firmwareupdate', responseText) );
-    },
-    1000
-  );
-
-  setInterval
-  ( 
-    function() 
-    { 
-      ForVar('DATE', responseText => SetDiv('date', responseText) );
-      ForVar('BOOT_DATETIME', responseText => OnBootTime(responseText) );
-      ForVar('CLIENT_COUNT', responseText => SetDiv('clients', '#' + responseText + ' clients') );
-    },
-    5000
-  );
+  WatchVar('TIME', 1000, responseText => SetDiv('time', responseText) );
+  WatchVar('FIRMWARE_UPDATE_STA', 1000, responseText => SetDiv('firmwareupdate', responseText) );
 
+  WatchVar('DATE', 5000, responseText => SetDiv('date', responseText) );
+  WatchVar('BOOT_DATETIME', 5000, responseText => OnBootTime(responseText) );
+  WatchVar('CLIENT_COUNT', 5000, responseText => SetDiv('clients', '#' + responseText + ' clients') );
 });
 
-)");
+)"));
         },
         .Body = [&](Stream& out)
         {
@@ -278,6 +271,8 @@ window.addEventListener('load', (event) =>
 <tr><th>Serial Number</th><td>{SERIAL_NUMBER}</td></tr>
 <tr><th>Firmware</th><td><div id='firmware'>{FIRMWARE}</div></td></tr>
 <tr><th>Firmware URL</th><td>{FIRMWARE_UPDATE_URL}</td></tr>
+<tr><th>Web Pages</th><td>{WEB_METRICS}</td></tr>
+<tr><th>Registry</th><td>{REGISTRY_INFO}</td></tr>
 
 {PARAM_TABLE_END}
 <br>
@@ -13,6 +13,7 @@ $DAT >>hb_homekit.cpp<< 10 Dez 2024  09:20:35 - (c) proDAD
 #include <Arduino.h>
 #include <StreamString.h>
 #include "hb_homekit.h"
+#include <uri/UriBraces.h>
 
 namespace HBHomeKit
 {
@@ -112,22 +113,55 @@ std::vector<String> Split(const String& text, char sep)
 #pragma region CStreamPassThru (local)
 namespace
 {
-/* Forward write actions over a stream to a writer function. */
+/* Forward write actions over a stream to a writer function.
+* With a buffer size, small writes (e.g. the single characters of
+* ExpandVariables) are coalesced and forwarded in blocks of that size,
+* the remainder by Flush() or the destructor.
+*/
 class CStreamPassThru : public StreamNull
 {
 public:
   using CTargetWriter = std::function<size_t(const uint8_t* buffer, size_t size)>;
-  size_t Size{};
+  size_t Size{};    // bytes written to the stream
+  size_t Chunks{};  // calls of the writer function
 private:
   CTargetWriter mWriter;
+  std::unique_ptr<uint8_t[]> mBuffer;
+  size_t mCapacity{}, mUsed{};
+
+  size_t Forward(const uint8_t* buffer, size_t size)
+  {
+    ++Chunks;
+    return mWriter(buffer, size);
+  }
+
 public:
-  CStreamPassThru(CTargetWriter writer) : mWriter(std::move(writer)) {}
+  CStreamPassThru(CTargetWriter writer, size_t bufferSize = 0) : mWriter(std::move(writer))
+  {
+    if(bufferSize > 1)
+    {
+      mBuffer.reset(new (std::nothrow) uint8_t[bufferSize]);
+      if(mBuffer)
+        mCapacity = bufferSize;
+      // else: unbuffered
+    }
+  }
+
+  ~CStreamPassThru() { Flush(); }
+
+  /* Forwards the buffered bytes. */
+  void Flush()
+  {
+    if(mUsed > 0)
+    {
+      Forward(mBuffer.get(), mUsed);
+      mUsed = 0;
+    }
+  }
 
   virtual size_t write(uint8_t v) override
   {
-    auto Sz = mWriter(&v, 1);
-    Size += Sz;
-    return Sz;
+    return write(&v, 1);
   }
 
   virtual size_t write(const uint8_t* buffer, size_t size) override
@@ -135,9 +169,27 @@ public:
     if(size == 0)
       return 0; // Special case, no "" may be sent, because this represents the end of the transmission for the web server.
 
-    auto Sz = mWriter(buffer, size);
-    Size += Sz;
-    return Sz;
+    if(mCapacity == 0)
+    {
+      auto Sz = Forward(buffer, size);
+      Size += Sz;
+      return Sz;
+    }
+
+    if(mUsed + size > mCapacity)
+      Flush();
+
+    if(size >= mCapacity)
+      Forward(buffer, size); // large blocks (e.g. F() texts) are not copied
+    else
+    {
+      memcpy(mBuffer.get() + mUsed, buffer, size);
+      mUsed += size;
+      if(mUsed == mCapacity)
+        Flush();
+    }
+    Size += size;
+    return size;
   }
 
 };
@@ -146,173 +198,397 @@ public:
 //END CStreamPassThru
 #pragma endregion
 
-#pragma region CTextBuilder
+#pragma region CStreamCounter (local)
 namespace
 {
-class CTextBuilder : public StreamNull
+/* Counts the written bytes only, e.g. to measure a page before sending it. */
+class CStreamCounter : public StreamNull
 {
-  #pragma region Types
-  struct Line_Type
-  {
-    uint8_t Buf[512];
-  };
+public:
+  size_t Size{};
 
-  using List_Type = std::list<Line_Type>;
-  using const_interator = List_Type::const_iterator;
+  virtual size_t write(uint8_t) override
+  {
+    ++Size;
+    return 1;
+  }
 
-  #pragma endregion
+  virtual size_t write(const uint8_t*, size_t size) override
+  {
+    Size += size;
+    return size;
+  }
 
-  #pragma region Fields
-  size_t    mTotalSize{};
-  size_t    mLineSize{};
-  uint8_t* mCurLine{};
-  List_Type mLines;
+};
 
-  #pragma endregion
+} // namespace
+//END CStreamCounter
+#pragma endregion
 
+#pragma region CStreamCrc (local)
+namespace
+{
+/* Computes the crc32 of the written bytes, e.g. to detect a changed value. */
+class CStreamCrc : public StreamNull
+{
 public:
+  uint32_t Crc{ 0xffffffff };
+  size_t   Size{};
 
-  size_t size() const { return mTotalSize; }
+  virtual size_t write(uint8_t v) override
+  {
+    return write(&v, 1);
+  }
 
-  #pragma region ItrAt
-  auto ItrAt(size_t index) const
+  virtual size_t write(const uint8_t* buffer, size_t size) override
   {
-    std::pair<const_interator, size_t> Result{ mLines.end(), 0 };
-    for(auto Itr = mLines.begin(); Itr != mLines.end(); ++Itr)
-    {
-      if(index < sizeof(Line_Type))
-      {
-        Result.first = Itr;
-        Result.second = index;
-        break;
-      }
-      index -= sizeof(Line_Type);
-    }
-    return Result;
+    Crc = crc32(buffer, size, Crc);
+    Size += size;
+    return size;
   }
+};
 
-  #pragma endregion
+} // namespace
+//END CStreamCrc
+#pragma endregion
 
-  #pragma region AddString
-  void AddString(const uint8_t* text, size_t len)
+#pragma region CStreamWindow (local)
+namespace
+{
+/* Keeps the bytes [skip, skip+capacity) of the written data in a buffer,
+* counts all of them.
+*/
+class CStreamWindow : public StreamNull
+{
+  uint8_t* mBuffer;
+  size_t   mSkip, mCapacity;
+public:
+  size_t Size{};    // all written bytes
+  size_t Filled{};  // kept bytes
+
+  CStreamWindow(uint8_t* buffer, size_t skip, size_t capacity)
+    : mBuffer(buffer), mSkip(skip), mCapacity(capacity)
   {
-    if(!text || len == 0)
-      return;
+  }
 
-    //Serial.printf("AddString: %d  |%.16s|\n", len, text);
+  virtual size_t write(uint8_t v) override
+  {
+    return write(&v, 1);
+  }
 
-    while(len > 0)
+  virtual size_t write(const uint8_t* buffer, size_t size) override
+  {
+    const size_t End = Size + size;
+    if(End > mSkip && Filled < mCapacity)
     {
-      size_t UseableLen = std::min(len, sizeof(Line_Type) - mLineSize);
+      const size_t From = mSkip > Size ? mSkip - Size : 0;
+      const size_t Count = std::min(size - From, mCapacity - Filled);
+      memcpy(mBuffer + Filled, buffer + From, Count);
+      Filled += Count;
+    }
+    Size = End;
+    return size;
+  }
+};
 
-      if(mCurLine == nullptr || UseableLen == 0)
-      {
-        //Serial.printf("AddString: New Line\n");
-        mCurLine = mLines.emplace_back().Buf;
-        mLineSize = 0;
-        continue;
-      }
+/* CStreamWindow that also computes the crc32 of all written bytes.
+*/
+class CStreamCrcWindow : public CStreamWindow
+{
+public:
+  uint32_t Crc{ 0xffffffff };
 
-      memcpy(mCurLine + mLineSize, text, UseableLen);
-      mLineSize += UseableLen;
-      mTotalSize += UseableLen;
-      text += UseableLen;
-      len -= UseableLen;
-    }
+  using CStreamWindow::CStreamWindow;
 
-    //Serial.printf("AddString: TotalSize: %d\n", mTotalSize);
+  virtual size_t write(uint8_t v) override
+  {
+    return write(&v, 1);
   }
 
-  #pragma endregion
+  virtual size_t write(const uint8_t* buffer, size_t size) override
+  {
+    Crc = crc32(buffer, size, Crc);
+    return CStreamWindow::write(buffer, size);
+  }
+};
 
+} // namespace
+//END CStreamWindow
+#pragma endregion
 
-  #pragma region StreamZero Implementation
-  size_t mStreamReadIndex{};
+#pragma region WriteFlashText / CStreamPieces
+CStreamPieces* CStreamPieces::spRecording{};
 
-  virtual size_t write(uint8_t v) override
+void WriteFlashText(Stream& out, PGM_P text, size_t len)
+{
+  if(CStreamPieces::spRecording && static_cast<Stream*>(CStreamPieces::spRecording) == &out)
   {
-    AddString(&v, 1);
-    return 1;
+    CStreamPieces::spRecording->WriteFlash(text, len);
+    return;
   }
 
-  virtual size_t write(const uint8_t* buffer, size_t size) override
+  char Buffer[128];
+  for(size_t Pos = 0; Pos < len; Pos += sizeof(Buffer))
+  {
+    const size_t Size = std::min(sizeof(Buffer), len - Pos);
+    memcpy_P(Buffer, text + Pos, Size);
+    out.write(Buffer, Size);
+  }
+}
+
+bool CStreamPieces::Record(const CTextEmitter& emitter)
+{
+  CStreamPieces* const pPrevious = spRecording;
+  spRecording = this;
+  emitter(*this);
+  spRecording = pPrevious;
+
+  mPieces.shrink_to_fit();
+  if(mTextSize > 0 && mTextSize < mTextCapacity)
+  {
+    if(auto pText = static_cast<uint8_t*>(realloc(mText.get(), mTextSize)))
+    {
+      mText.release();
+      mText.reset(pText);
+      mTextCapacity = mTextSize;
+    }
+  }
+  return !mFailed;
+}
+
+size_t CStreamPieces::write(const uint8_t* buffer, size_t size)
+{
+  constexpr size_t MaxTextSize = std::numeric_limits<uint16_t>::max();
+  const size_t End = mTextSize + size;
+  if(mFailed || size == 0)
+    return size;
+  if(End > MaxTextSize)
   {
-    AddString(buffer, size);
+    mFailed = true;
     return size;
   }
 
-  virtual ssize_t streamRemaining() override
+  if(End > mTextCapacity)
+  {
+    const size_t Capacity = std::min(std::max(End, mTextCapacity * 3 / 2 + 64), MaxTextSize);
+    auto pText = static_cast<uint8_t*>(realloc(mText.get(), Capacity));
+    if(pText == nullptr)
+    {
+      mFailed = true;
+      return size;
+    }
+    mText.release();
+    mText.reset(pText);
+    mTextCapacity = Capacity;
+  }
+  memcpy(mText.get() + mTextSize, buffer, size);
+
+  if(!mPieces.empty() && mPieces.back().Flash == nullptr)
+    mPieces.back().Len += uint16_t(size); // follows in mText
+  else
+    mPieces.push_back({ nullptr, uint16_t(mTextSize), uint16_t(size) });
+  mTextSize = End;
+  mSize += size;
+  return size;
+}
+
+void CStreamPieces::WriteFlash(PGM_P text, size_t len)
+{
+  // a short text costs less as bytes than as a piece
+  if(len < 2 * sizeof(CPiece))
   {
-    return mTotalSize - mStreamReadIndex;
+    uint8_t Buffer[2 * sizeof(CPiece)];
+    memcpy_P(Buffer, text, len);
+    write(Buffer, len);
+    return;
   }
 
-  virtual int read(uint8_t* buffer, size_t len) override
+  while(len > 0 && !mFailed)
   {
-    if(!buffer || len == 0 || len > mTotalSize - mStreamReadIndex)
-      return 0;
+    const size_t Len = std::min<size_t>(len, std::numeric_limits<uint16_t>::max());
+    mPieces.push_back({ text, 0, uint16_t(Len) });
+    mSize += Len;
+    text += Len;
+    len -= Len;
+  }
+}
 
-    auto Pair = ItrAt(mStreamReadIndex);
-    const_interator Itr = Pair.first;
-    size_t Index = Pair.second;
+size_t CStreamPieces::Read(size_t pos, uint8_t* buffer, size_t size)
+{
+  if(pos < mReadPos)
+    mReadPiece = mReadPos = 0;
 
-    size_t Read = 0;
-    while(len > 0 && Itr != mLines.end())
+  size_t Copied = 0;
+  while(Copied < size && mReadPiece < mPieces.size())
+  {
+    const auto& Piece = mPieces[mReadPiece];
+    if(pos >= mReadPos + Piece.Len)
     {
-      size_t UseableLen = std::min(len, sizeof(Line_Type) - Index);
-      memcpy(buffer, Itr->Buf + Index, UseableLen);
-      buffer += UseableLen;
-      len -= UseableLen;
-      Read += UseableLen;
-      mStreamReadIndex += UseableLen;
-
-      if(Index + UseableLen == sizeof(Line_Type))
-      {
-        ++Itr;
-        Index = 0;
-      }
-      else
-        Index += UseableLen;
+      mReadPos += Piece.Len;
+      ++mReadPiece;
+      continue;
     }
 
-    return Read;
+    const size_t Offset = pos - mReadPos;
+    const size_t Count = std::min(size - Copied, Piece.Len - Offset);
+    if(Piece.Flash)
+      memcpy_P(buffer + Copied, Piece.Flash + Offset, Count);
+    else
+      memcpy(buffer + Copied, mText.get() + Piece.Pos + Offset, Count);
+    Copied += Count;
+    pos += Count;
   }
+  return Copied;
+}
+
+//END CStreamPieces
+#pragma endregion
+
+#pragma region CStreamJsonString (local)
+namespace
+{
+/* Writes the text as content of a JSON string (without the quotes),
+* i.e. '"', '\\' and control characters are escaped.
+*/
+class CStreamJsonString : public StreamNull
+{
+  Stream& mOut;
+public:
+  CStreamJsonString(Stream& out) : mOut(out) {}
 
-  virtual size_t readBytes(char* buffer, size_t len) override
+  virtual size_t write(uint8_t v) override
   {
-    return read(reinterpret_cast<uint8_t*>(buffer), len);
+    return write(&v, 1);
   }
 
-  virtual int peek() override
+  virtual size_t write(const uint8_t* buffer, size_t size) override
   {
-    if(mStreamReadIndex >= mTotalSize)
-      return -1;
+    size_t Start = 0;
+    for(size_t i = 0; i < size; ++i)
+    {
+      uint8_t c = buffer[i];
+      if(c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      if(i > Start)
+        mOut.write(buffer + Start, i - Start);
+      Start = i + 1;
 
-    auto Pair = ItrAt(mStreamReadIndex);
-    return Pair.first->Buf[Pair.second];
+      char Esc[8];
+      switch(c)
+      {
+        case '"':  mOut.write("\\\"", 2); break;
+        case '\\': mOut.write("\\\\", 2); break;
+        case '\n': mOut.write("\\n", 2); break;
+        case '\r': mOut.write("\\r", 2); break;
+        case '\t': mOut.write("\\t", 2); break;
+        default:
+          snprintf_P(Esc, sizeof(Esc), PSTR("\\u%04x"), c);
+          mOut.write(Esc, 6);
+          break;
+      }
+    }
+    if(size > Start)
+      mOut.write(buffer + Start, size - Start);
+    return size;
   }
+};
+
+} // namespace
+//END CStreamJsonString
+#pragma endregion
+
+#pragma region WriteJsonValue (local)
+namespace
+{
+/* Keeps the first bytes of a text and counts all of them.
+*/
+class CStreamPeek : public StreamNull
+{
+public:
+  char    Text[24];
+  size_t  Size{};
 
-  virtual int read() override
+  virtual size_t write(uint8_t v) override
   {
-    if(mStreamReadIndex >= mTotalSize)
-      return -1;
+    return write(&v, 1);
+  }
 
-    auto Pair = ItrAt(mStreamReadIndex);
-    int Result = Pair.first->Buf[Pair.second];
-    ++mStreamReadIndex;
-    return Result;
+  virtual size_t write(const uint8_t* buffer, size_t size) override
+  {
+    if(Size < sizeof(Text))
+      memcpy(Text + Size, buffer, std::min(size, sizeof(Text) - Size));
+    Size += size;
+    return size;
   }
+};
+
+/* true if the text is a JSON number, true or false (strict, no spaces). */
+bool IsJsonLiteral(const char* text, size_t len)
+{
+  if((len == 4 && memcmp_P(text, PSTR("true"), 4) == 0)
+  || (len == 5 && memcmp_P(text, PSTR("false"), 5) == 0))
+    return true;
 
-  virtual int available() override
+  const char* p = text;
+  const char* End = text + len;
+  auto Digits = [&]
+    {
+      const char* Start = p;
+      while(p < End && isdigit(*p))
+        ++p;
+      return p > Start;
+    };
+
+  if(p < End && *p == '-')
+    ++p;
+  if(p < End && *p == '0')
+    ++p;
+  else if(!Digits())
+    return false;
+  if(p < End && *p == '.')
   {
-    return mTotalSize - mStreamReadIndex;
+    ++p;
+    if(!Digits())
+      return false;
+  }
+  if(p < End && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    if(p < End && (*p == '+' || *p == '-'))
+      ++p;
+    if(!Digits())
+      return false;
   }
+  return p == End;
+}
 
-  //END StreamZero Implementation
-  #pragma endregion
+/* Writes the text as JSON value: short numbers and true/false as such,
+* everything else as string.
+* @note A long text is emitted a second time (stable rendering, @see CTextEmitter).
+*/
+void WriteJsonValue(Stream& out, const CTextEmitter& emit)
+{
+  CStreamPeek Peek;
+  Peek << emit;
 
+  if(Peek.Size <= sizeof(Peek.Text) && IsJsonLiteral(Peek.Text, Peek.Size))
+  {
+    out.write(Peek.Text, Peek.Size);
+    return;
+  }
+
+  out.write('"');
+  CStreamJsonString Value(out);
+  if(Peek.Size <= sizeof(Peek.Text))
+    Value.write(reinterpret_cast<const uint8_t*>(Peek.Text), Peek.Size);
+  else
+    Value << emit;
+  out.write('"');
+}
 
-};
 } // namespace
+//END WriteJsonValue
 #pragma endregion
 
 #pragma region homekit_value_cast - Implementation
@@ -1088,22 +1364,37 @@ i {
     out << params.Title;
 
     out << F(R"(</title>
-<style type="text/css">
 )");
 
-    out << StandardCSS();
-    out << params.CSS;
-
-    out << F(R"(
-</style><script type="text/javascript">
+    if(params.CSSURI)
+    {
+      out << F("<link rel='stylesheet' href='") << params.CSSURI << F("'>\n");
+    }
+    else
+    {
+      out << F(R"(<style type="text/css">
 )");
+      StyleSheet(out, params.CSS);
+      out << F(R"(
+</style>
+)");
+    }
 
-
-    out << params.JavaScript;
-
-    out << F(R"(
+    if(params.JavaScriptURI)
+    {
+      out << F("<script src='") << params.JavaScriptURI << F("'></script>\n");
+    }
+    else if(params.JavaScript)
+    {
+      out << F(R"(<script type="text/javascript">
+)");
+      out << params.JavaScript;
+      out << F(R"(
 </script>
-</head>
+)");
+    }
+
+    out << F(R"(</head>
 <body>
 <div class = 'Header'>)");
 
@@ -1118,6 +1409,15 @@ i {
 
   #pragma endregion
 
+  #pragma region StyleSheet
+  virtual void StyleSheet(Stream& out, const CTextEmitter& css) override
+  {
+    out << StandardCSS();
+    out << css;
+  }
+
+  #pragma endregion
+
   #pragma region Tail
   virtual void Tail(Stream& out) override
   {
@@ -1191,12 +1491,6 @@ struct CController::CMenuStripItems : IHtmlWebSiteBuilder::IMenuStripItems
   const_menu_iterator mEnd;
   const_menu_iterator mCurrent;
   const CHtmlWebSiteMenuItem* mSelected{};
-  
-  /* Only menus with low memory usage are visible.
-  * @see CHtmlWebSiteMenuItem::LowMemoryUsage
-  * @see SendHtmlPage
-  */
-  bool mOnlyLMUMenusVisible{};
 
   #pragma endregion
 
@@ -1205,13 +1499,11 @@ struct CController::CMenuStripItems : IHtmlWebSiteBuilder::IMenuStripItems
   (
     const_menu_iterator begin,
     const_menu_iterator end,
-    const CHtmlWebSiteMenuItem* selected,
-    bool onlyLMUMenusVisible
+    const CHtmlWebSiteMenuItem* selected
   )
     : mBegin{ begin }
     , mEnd{ end }
     , mSelected{ selected }
-    , mOnlyLMUMenusVisible{ onlyLMUMenusVisible }
   {
   }
 
@@ -1222,10 +1514,6 @@ struct CController::CMenuStripItems : IHtmlWebSiteBuilder::IMenuStripItems
   {
     auto IsVisible = [&](const_menu_iterator item) -> bool
       {
-        if(mOnlyLMUMenusVisible)
-          if(!item->LowMemoryUsage)
-            return false;
-
         return item->Visible ? item->Visible() : true;
       };
 
@@ -1300,10 +1588,19 @@ bool CController::SetSelectedMenuItemIndex(int index)
 #pragma region AddMenuItem
 CController& CController::AddMenuItem(CHtmlWebSiteMenuItem&& item)
 {
+  CPageTemplate Template;
+  Template.Compile(*this, item.BodyText);
+
   if(item.URI[0] == '/' && item.URI[1] == '\0') // Root always at index 0
+  {
     mMenuItems.emplace_front(std::move(item));
+    mBodyTemplates.insert(mBodyTemplates.begin(), std::move(Template));
+  }
   else
+  {
     mMenuItems.emplace_back(std::move(item));
+    mBodyTemplates.push_back(std::move(Template));
+  }
   return *this;
 }
 
@@ -1312,7 +1609,7 @@ CController& CController::AddMenuItem(CHtmlWebSiteMenuItem&& item)
 #pragma region InstallCmd
 CController& CController::InstallCmd(const char* cmd, CInvoker&& func)
 {
-  mCMDs[cmd] = CCmdItem
+  mCMDs(cmd) = CCmdItem
   {
     .Invoker = std::move(func)
   };
@@ -1320,7 +1617,7 @@ CController& CController::InstallCmd(const char* cmd, CInvoker&& func)
 }
 CController& CController::InstallCmd(const char* cmd, CmdAttribute attr, CInvoker&& func)
 {
-  mCMDs[cmd] = CCmdItem
+  mCMDs(cmd) = CCmdItem
   {
     .Invoker = std::move(func),
     .Attr = attr
@@ -1330,7 +1627,7 @@ CController& CController::InstallCmd(const char* cmd, CmdAttribute attr, CInvoke
 
 CController& CController::InstallCmd(const char* cmd, const char* text, CInvoker&& func)
 {
-  mCMDs[cmd] = CCmdItem
+  mCMDs(cmd) = CCmdItem
   {
     .Invoker = std::move(func),
     .Text = text
@@ -1339,7 +1636,7 @@ CController& CController::InstallCmd(const char* cmd, const char* text, CInvoker
 }
 CController& CController::InstallCmd(const char* cmd, const char* text, CmdAttribute attr, CInvoker&& func)
 {
-  mCMDs[cmd] = CCmdItem
+  mCMDs(cmd) = CCmdItem
   {
     .Invoker = std::move(func),
     .Text = text,
@@ -1353,48 +1650,86 @@ CController& CController::InstallCmd(const char* cmd, const char* text, CmdAttri
 #pragma region SetVar
 CController& CController::SetVar(const char* var, Expander&& expander)
 {
-  mVars[var] = std::move(expander);
+  bool Added;
+  mVars(var, &Added) = std::move(expander);
+  if(Added)
+    ++mVarGeneration;
   return *this;
 }
 CController& CController::SetVar(const String& var, Expander&& expander)
 {
-  mVars[var] = std::move(expander);
+  bool Added;
+  mVars(var, &Added) = std::move(expander);
+  if(Added)
+    ++mVarGeneration;
   return *this;
 }
 
 CController& CController::SetVar(const char* var, String content)
 {
-  return SetVar(var, [content = std::move(content)](auto)
+  SetVar(var, [content = std::move(content)](auto)
     {
       return MakeTextEmitter(content);
     });
+  return VarChanged(var);
 }
 CController& CController::SetVar(const String& var, String content)
 {
-  return SetVar(var, [content = std::move(content)](auto)
+  SetVar(var, [content = std::move(content)](auto)
     {
       return MakeTextEmitter(content);
     });
+  return VarChanged(var.c_str());
+}
+
+#pragma endregion
+
+#pragma region TrackVar / VarChanged
+CController& CController::TrackVar(const char* var)
+{
+  mVarVersions(var);
+  return *this;
+}
+
+CController& CController::VarChanged(const char* var)
+{
+  ++mVarVersions(var);
+  return *this;
+}
+
+#pragma endregion
+
+#pragma region HideVar
+CController& CController::HideVar(const char* var)
+{
+  mHiddenVars(var) = true;
+  return *this;
 }
 
 #pragma endregion
 
+#pragma region FindFormValue
+const String* CController::FindFormValue(const char* name, size_t len) const
+{
+  // reverse: the first of several equal arguments wins (stored in reverse order)
+  for(auto It = mFormValues.rbegin(); It != mFormValues.rend(); ++It)
+  {
+    if(It->Name.length() == len && memcmp(It->Name.c_str(), name, len) == 0)
+      return &It->Value;
+  }
+  return nullptr;
+}
+#pragma endregion
+
 #pragma region TryGetVar
 bool CController::TryGetVar(const char* var, String* pContent, CInvokerParam param) const
 {
-  auto It = mVars.find(var);
-  if(It == mVars.end())
+  if(auto pValue = FindFormValue(var, strlen(var)))
   {
     if(pContent)
-      *pContent = emptyString;
-    return false;
+      *pContent = *pValue;
+    return true;
   }
-  if(pContent)
-    *pContent = to_string(It->second(param));
-  return true;
-}
-bool CController::TryGetVar(const String& var, String* pContent, CInvokerParam param) const
-{
   auto It = mVars.find(var);
   if(It == mVars.end())
   {
@@ -1403,20 +1738,33 @@ bool CController::TryGetVar(const String& var, String* pContent, CInvokerParam p
     return false;
   }
   if(pContent)
-    *pContent = to_string(It->second(param));
+    *pContent = to_string(It->Value(param));
   return true;
 }
+bool CController::TryGetVar(const String& var, String* pContent, CInvokerParam param) const
+{
+  return TryGetVar(var.c_str(), pContent, param);
+}
 
-bool CController::TryGetVar(const String& var, Stream& out, CInvokerParam param) const
+bool CController::TryGetVar(const char* var, Stream& out, CInvokerParam param) const
 {
+  if(auto pValue = FindFormValue(var, strlen(var)))
+  {
+    out.write(pValue->c_str(), pValue->length());
+    return true;
+  }
   auto It = mVars.find(var);
   if(It == mVars.end())
     return false;
-  out << It->second(param);
+  out << It->Value(param);
   return true;
 }
-
-#pragma endregion
+bool CController::TryGetVar(const String& var, Stream& out, CInvokerParam param) const
+{
+  return TryGetVar(var.c_str(), out, param);
+}
+
+#pragma endregion
 
 #pragma region Setup
 void CController::Setup()
@@ -1437,6 +1785,42 @@ void CController::Setup()
       mWifiConnection.SetInUse();
       PerformWebServerRequest();
     });
+  WebServer.on("/events", HTTP_GET, [this]
+    {
+      mWifiConnection.SetInUse();
+      PerformEventSubscribe();
+    });
+  {
+    // EventSource sends Last-Event-ID after a reconnect
+    const char* Headers[] = { "Last-Event-ID", "If-None-Match" };
+    WebServer.collectHeaders(Headers, 2);
+  }
+  WebServer.on("/asset.css", HTTP_GET, [this]
+    {
+      mWifiConnection.SetInUse();
+      PerformAssetRequest(false);
+    });
+  WebServer.on("/asset.js", HTTP_GET, [this]
+    {
+      mWifiConnection.SetInUse();
+      PerformAssetRequest(true);
+    });
+  WebServer.on("/api/vars", HTTP_GET, [this]
+    {
+      mWifiConnection.SetInUse();
+      PerformApiVarsRequest();
+    });
+  WebServer.on(UriBraces("/api/vars/{}"), HTTP_GET, [this]
+    {
+      mWifiConnection.SetInUse();
+      PerformApiVarRequest(WebServer.pathArg(0));
+    });
+  WebServer.on(UriBraces("/api/cmd/{}"), HTTP_OPTIONS, [] { WebServer.send(204); });
+  WebServer.on(UriBraces("/api/cmd/{}"), HTTP_POST, [this]
+    {
+      mWifiConnection.SetInUse();
+      PerformApiCmdRequest(WebServer.pathArg(0));
+    });
   WebServer.on("/var", HTTP_OPTIONS, [] { WebServer.send(204); });
   WebServer.on("/var", HTTP_GET, [this] 
     {
@@ -1470,7 +1854,10 @@ void CController::Setup()
 #pragma region Loop
 void CController::Loop(bool tickerEnabled)
 {
+  const uint32_t StartUS = micros();
   WebServer.handleClient();
+  SimpleFileSystem::Loop();
+  CTimeSeriesStore::LoopAll();
 
   const uint32_t CurTick = millis();
   if(tickerEnabled)
@@ -1478,7 +1865,135 @@ void CController::Loop(bool tickerEnabled)
     OneShotTicker.OnTick(CurTick);
     Ticker.OnTick(CurTick);
   }
+
+  if(!mEventSubscribers.empty() && CurTick - mLastEventCheckMS >= EventCheckIntervalMS)
+  {
+    mLastEventCheckMS = CurTick;
+    SendEvents();
+  }
+
+  if(!mDeferredActions.empty())
+    RunDeferredAction(CurTick);
+
+  if(!mSendJobs.empty())
+    SendJobStep();
+
+  mWebMetrics.MaxLoopUS = std::max(mWebMetrics.MaxLoopUS, uint32_t(micros() - StartUS));
+}
+#pragma endregion
+
+#pragma region StartSendJob / SendJobStep
+bool CController::StartSendJob(CStreamPieces&& content, bool page, const char* contentType)
+{
+  if(mSendJobs.size() >= MaxSendJobs)
+    return false;
+
+  // The connection is handed over to the job, not kept for a next request.
+  WebServer.keepAlive(false);
+  WebServer.setContentLength(content.Size());
+  WebServer.send(200, contentType, emptyString);
+
+  if(content.Size() > 0)
+  {
+    mSendJobs.push_back
+    (
+      {
+        .Client = WebServer.client(),
+        .Content = std::move(content),
+        .Page = page,
+        .StartMS = millis()
+      }
+    );
+  }
+  return true;
+}
+
+void CController::SendJobStep()
+{
+  const size_t BufferSize = mSendBufferSize ? mSendBufferSize : DefaultSendBufferSize;
+
+  for(size_t i = 0; i < mSendJobs.size(); ++i)
+  {
+    auto& Job = mSendJobs[i];
+    const size_t Size = Job.Content.Size();
+    if(!Job.Client.connected())
+    {
+      WARN("Send: connection closed after %d of %d bytes", Job.Sent, Size);
+      mSendJobs.erase(mSendJobs.begin() + i);
+      break;
+    }
+
+    // only what the TCP send buffer takes, never wait for the client
+    const size_t Count = std::min({ BufferSize, Size - Job.Sent, size_t(Job.Client.availableForWrite()) });
+    if(Count == 0)
+      continue;
+
+    const uint32_t StartUS = micros();
+    if(mSendJobBuffer.size() < BufferSize)
+      mSendJobBuffer.resize(BufferSize);
+
+    const size_t Read = Job.Content.Read(Job.Sent, mSendJobBuffer.data(), Count);
+    Job.Sent += Job.Client.write(mSendJobBuffer.data(), Read);
+    ++Job.Chunks;
+    mWebMetrics.MaxStepUS = std::max(mWebMetrics.MaxStepUS, uint32_t(micros() - StartUS));
+
+    if(Job.Sent >= Size)
+    {
+      const uint32_t MS = millis() - Job.StartMS;
+      if(Job.Page)
+        UpdateWebMetrics(Size, Job.Chunks, MS);
+      VERBOSE("Sent from Loop: %d bytes (%d on the heap) in %d steps, %d ms | Free heap: %d bytes", Size, Job.Content.HeapSize(), Job.Chunks, MS, system_get_free_heap_size());
+      mSendJobs.erase(mSendJobs.begin() + i); // closes the connection
+    }
+    else if(mSendJobs.size() > 1)
+    {
+      // the others are next
+      std::rotate(mSendJobs.begin() + i, mSendJobs.begin() + i + 1, mSendJobs.end());
+    }
+    break; // one buffer per Loop
+  }
+
+  if(mSendJobs.empty())
+    mSendJobBuffer = {};
+}
+
+#pragma endregion
+
+#pragma region Defer
+CController& CController::Defer(std::function<void()> action, uint32_t delayMS, bool afterResponse)
+{
+  mDeferredActions.push_back
+  (
+    {
+      .Action = std::move(action),
+      .Client = afterResponse ? WebServer.client() : WiFiClient(),
+      .StartMS = millis(),
+      .DelayMS = delayMS
+    }
+  );
+  return *this;
+}
+
+void CController::RunDeferredAction(uint32_t curTick)
+{
+  for(auto It = mDeferredActions.begin(); It != mDeferredActions.end(); ++It)
+  {
+    const uint32_t Elapsed = curTick - It->StartMS;
+    if(Elapsed < It->DelayMS)
+      continue;
+
+    // response still in transit?
+    if(It->Client.connected() && !It->Client.flush(1) && Elapsed < DeferredFlushTimeoutMS)
+      continue;
+
+    // the action may defer further ones or reboot
+    auto Action = std::move(It->Action);
+    mDeferredActions.erase(It);
+    Action();
+    return;
+  }
 }
+
 #pragma endregion
 
 #pragma region IndexOfMenuURI
@@ -1505,10 +2020,41 @@ int CController::IndexOfMenuURI(const char* uri) const
 void CController::SendHtmlPage()
 {
   uint32_t StartMS = millis();
-  WebServer.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  WebServer.sendHeader("Pragma", "no-cache");
-  WebServer.sendHeader("Expires", "-1");
+  uint32_t Version;
+
+  // form values or commands may change the page
+  if(WebServer.args() == 0 && GetPageVersion(Version))
+  {
+    char ETag[12];
+    snprintf_P(ETag, sizeof(ETag), PSTR("\"%08x\""), Version);
+    WebServer.sendHeader(F("ETag"), ETag);
+    WebServer.sendHeader("Cache-Control", "no-cache"); // store, but ask again
+
+    if(WebServer.header(F("If-None-Match")) == ETag)
+    {
+      WebServer.send(304);
+      ++mWebMetrics.NotModified;
+      VERBOSE("HP not modified: %s", ETag);
+      return;
+    }
+  }
+  else
+  {
+    WebServer.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    WebServer.sendHeader("Pragma", "no-cache");
+    WebServer.sendHeader("Expires", "-1");
+  }
+
 
+  /* Without form values the page is recorded once (its static text by
+  * reference) and sent from Loop, one buffer per call (@see CSendJob).
+  */
+  if(WebServer.args() == 0 && mSendJobs.size() < MaxSendJobs)
+  {
+    CStreamPieces Content;
+    if(Content.Record([this](Stream& out) { SendHtmlPage(out); }) && StartSendJob(std::move(Content), true, "text/html"))
+      return;
+  }
 
   // use HTTP/1.1 Chunked response to avoid building a huge temporary string
   if(WebServer.chunkedResponseModeStart(200, "text/html"))
@@ -1519,63 +2065,116 @@ void CController::SendHtmlPage()
       {
         WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
         return size;
-      }
+      },
+      mSendBufferSize
     );
     SendHtmlPage(HtmlOutStream);
+    HtmlOutStream.Flush();
     WebServer.chunkedResponseFinalize();
     StartMS = millis() - StartMS;
-    VERBOSE("HP Sent: %d bytes | Free heap: %d bytes | %d ms", HtmlOutStream.Size, system_get_free_heap_size(), StartMS);
+    UpdateWebMetrics(HtmlOutStream.Size, HtmlOutStream.Chunks, StartMS);
+    VERBOSE("HP Sent: %d bytes in %d chunks | Free heap: %d bytes | %d ms", HtmlOutStream.Size, HtmlOutStream.Chunks, system_get_free_heap_size(), StartMS);
   }
   else
   {
-    if(!mOnlyLMUMenusVisible)
-    {
-      WARN("HTTP1.1 not supported - Only small websites can be sent.");
-      mOnlyLMUMenusVisible = true;
-    }
-
-    /* The HTML 1.0 protocol expects the page length as a parameter at
-    * the beginning. To determine the number of bytes, the entire HTML
-    * page must be prepared in memory.
-    * Some menus contain large HTML pages that cannot be rendered
-    * completely in memory. For this reason, only those menus are
-    * displayed that can be safely rendered with little memory.
-    * The LowMemoryUsage option can be used to check if a suitable
-    * menu has been selected. If this is not the case, a suitable
-    * menu will be selected.
+    /* The HTML 1.0 protocol expects the page length at the beginning.
+    * Instead of building the page in memory, it is rendered twice:
+    * first into a counter, then directly to the client.
+    * @see SetVar (stable render)
     */
-    {
-      int FirstLowMemPageIndex = -1;
-      int Index=0;
-      for(const auto& Item : mMenuItems)
-      {
-        if(Item.LowMemoryUsage && FirstLowMemPageIndex < 0)
-          FirstLowMemPageIndex = Index;
+    CStreamCounter Counter;
+    SendHtmlPage(Counter);
 
-        if(mSelectedMenuIndex == Index)
-          if(!Item.LowMemoryUsage)
-            mSelectedMenuIndex = -1;
+    WebServer.setContentLength(Counter.Size);
+    WebServer.send(200, "text/html", emptyString);
 
-        ++Index;
-      }
-      if(mSelectedMenuIndex < 0 && FirstLowMemPageIndex >= 0)
+    size_t Sent = 0, Rendered = 0;
+    CStreamPassThru HtmlOutStream
+    (
+      [&](const uint8_t* buffer, size_t size) -> size_t
       {
-        WARN("Because of HTML1.0 it is necessary to switch to a page with low memory usage.");
-        mSelectedMenuIndex = FirstLowMemPageIndex;
-      }
-      if(mSelectedMenuIndex < 0)
+        // never more than announced
+        Rendered += size;
+        size = std::min(size, Counter.Size - Sent);
+        if(size > 0)
+          WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
+        Sent += size;
+        return size;
+      },
+      mSendBufferSize
+    );
+    SendHtmlPage(HtmlOutStream);
+    HtmlOutStream.Flush();
+
+    if(Rendered != Counter.Size)
+    {
+      ERROR("HP unstable render: %d of %d bytes", Rendered, Counter.Size);
+      while(Sent < Counter.Size)
       {
-        ERROR("Unfortunately there is no Low-Mem-Usage page.");
-        mSelectedMenuIndex = 0;
+        HtmlOutStream.write(' ');
+        HtmlOutStream.Flush();
       }
     }
+    StartMS = millis() - StartMS;
+    UpdateWebMetrics(Sent, HtmlOutStream.Chunks, StartMS);
+    VERBOSE("HP Sent (HTTP1.0): %d bytes in %d chunks | Free heap: %d bytes | %d ms", Counter.Size, HtmlOutStream.Chunks, system_get_free_heap_size(), StartMS);
+  }
+}
+
+#pragma endregion
+
+#pragma region GetPageVersion
+bool CController::GetPageVersion(uint32_t& version) const
+{
+  if(GetSelectedMenuItem() == nullptr || size_t(mSelectedMenuIndex) >= mPageDeps.size())
+    return false;
+
+  const auto& Deps = mPageDeps[mSelectedMenuIndex];
+  if(Deps.Renders < 2)
+    return false;
+
+  uint32_t Crc = crc32(&mPageVersionSalt, sizeof(mPageVersionSalt));
+  Crc = crc32(&mSelectedMenuIndex, sizeof(mSelectedMenuIndex), Crc);
+  Crc = crc32(&mVarGeneration, sizeof(mVarGeneration), Crc);
+  Crc = crc32(&Deps.BodyCrc, sizeof(Deps.BodyCrc), Crc);
 
-    CTextBuilder TextBuilder;
-    SendHtmlPage(TextBuilder);
-    VERBOSE("HTML Page has %d bytes", TextBuilder.size());
-    WebServer.send(200, "text/html", static_cast<Stream*>(&TextBuilder));
-    INFO_HEAP();
+  /*--- Body --- */
+  for(const char* Name : Deps.Vars)
+  {
+    auto It = mVarVersions.find(Name);
+    if(It == mVarVersions.end())
+      return false; // may change at any time
+    Crc = crc32(&It->Value, sizeof(It->Value), Crc);
+  }
+
+  /*--- Header and menu strip --- */
+  String WifiInfo = mWifiConnection.WifiInfoText();
+  Crc = crc32(WifiInfo.c_str(), WifiInfo.length(), Crc);
+  const char* Name = DeviceName();
+  Crc = crc32(Name, strlen(Name), Crc);
+  for(const auto& Item : mMenuItems)
+  {
+    const bool Visible = Item.Visible ? Item.Visible() : true;
+    Crc = crc32(&Visible, sizeof(Visible), Crc);
   }
+
+  version = Crc;
+  return true;
+}
+
+#pragma endregion
+
+#pragma region UpdateWebMetrics
+void CController::UpdateWebMetrics(size_t bytes, size_t chunks, uint32_t ms)
+{
+  auto& M = mWebMetrics;
+  ++M.Pages;
+  M.Bytes += bytes;
+  M.Chunks += chunks;
+  M.LastBytes = bytes;
+  M.LastChunks = chunks;
+  M.LastMS = ms;
+  M.MaxMS = std::max(M.MaxMS, ms);
 }
 
 #pragma endregion
@@ -1586,6 +2185,18 @@ void CController::SendHtmlPage(Stream& out) const
   auto MenuItem = GetSelectedMenuItem();
   String WifiInfo = mWifiConnection.WifiInfoText();
 
+  /*--- CSS and JavaScript as cached files --- */
+  char CSSURI[32]{}, JavaScriptURI[32]{};
+  if(MenuItem)
+  {
+    auto& CSS = GetMenuAsset(mSelectedMenuIndex, *MenuItem, false);
+    snprintf_P(CSSURI, sizeof(CSSURI), PSTR("/asset.css?v=%08x"), CSS.Crc);
+
+    auto& JavaScript = GetMenuAsset(mSelectedMenuIndex, *MenuItem, true);
+    if(JavaScript.Size > 0)
+      snprintf_P(JavaScriptURI, sizeof(JavaScriptURI), PSTR("/asset.js?v=%08x"), JavaScript.Crc);
+  }
+
   /*--- Html-Page Header --- */
   mBuilder->Header
   (
@@ -1596,6 +2207,8 @@ void CController::SendHtmlPage(Stream& out) const
 
       .CSS = MenuItem ? MenuItem->CSS : CTextEmitter{},
       .JavaScript = MenuItem ? MenuItem->JavaScript : CTextEmitter{},
+      .CSSURI = CSSURI[0] ? CSSURI : nullptr,
+      .JavaScriptURI = JavaScriptURI[0] ? JavaScriptURI : nullptr,
 
       .RefreshInterval = MenuItem ? MenuItem->RefreshInterval : 0
     }
@@ -1607,7 +2220,7 @@ void CController::SendHtmlPage(Stream& out) const
     (
       mMenuItems.begin(),
       mMenuItems.end(),
-      MenuItem, mOnlyLMUMenusVisible
+      MenuItem
     );
     mBuilder->MenuStrip(out, MenuItems);
   }
@@ -1621,14 +2234,14 @@ void CController::SendHtmlPage(Stream& out) const
   }
 
   /*--- Body --- */
-  if(MenuItem && MenuItem->Body)
+  if(MenuItem && (MenuItem->Body || MenuItem->BodyText))
   {
     mBuilder->Body
     (
       out,
-      [this, BodyText = to_string(MenuItem->Body)](Stream& out)
+      [this, MenuItem](Stream& out)
       {
-        ExpandVariables(out, BodyText);
+        ExpandBody(out, *MenuItem);
       }
     );
   }
@@ -1645,9 +2258,9 @@ const char* CController::GetCmdText(const char* cmd) const
   auto It = mCMDs.find(cmd);
   if(It == mCMDs.end())
     return cmd;
-  if(It->second.Text.isEmpty())
+  if(It->Value.Text.isEmpty())
     return cmd;
-  return It->second.Text.c_str();
+  return It->Value.Text.c_str();
 }
 #pragma endregion
 
@@ -1684,12 +2297,16 @@ void CController::ExpandVariables(Stream& out, const String& _inputText) const
         }
 
         auto It = mVars.find(VarName);
-        if(It != mVars.end())
+        if(auto pValue = FindFormValue(VarName.c_str(), VarName.length()))
+        {
+          WriteString(*pValue);
+        }
+        else if(It != mVars.end())
         {
           const homekit_value_t Arg0 = static_value_cast(Args.c_str());
 
           // expand variable by calling the expander-function @see CInvokerParam
-          WriteEmitter(It->second(Args.isEmpty() ? nullptr : &Arg0));
+          WriteEmitter(It->Value(Args.isEmpty() ? nullptr : &Arg0));
         }
         else
         {
@@ -1714,178 +2331,987 @@ void CController::ExpandVariables(Stream& out, const String& _inputText) const
 }
 #pragma endregion
 
-#pragma region PerformWebServerRequest
-void CController::PerformWebServerRequest()
+#pragma region ExpandBody
+void CController::ExpandBody(Stream& out, const CHtmlWebSiteMenuItem& item) const
 {
-  CmdAttribute Attr{};
-  const String* CMD = &emptyString;
+  size_t Index = 0;
+  for(auto& Item : mMenuItems)
+  {
+    if(&Item == &item)
+      break;
+    ++Index;
+  }
+
+  uint32_t BodyCrc;
+  std::vector<const char*> Vars;
+  const CPageTemplate* pTemplate = Index < mBodyTemplates.size() && mBodyTemplates[Index].Text ? &mBodyTemplates[Index] : nullptr;
+  if(pTemplate)
+  {
+    mBodyTemplates[Index].Expand(out, *this);
+    BodyCrc = pTemplate->TextCrc;
+  }
+  else
+  {
+    CBodyExpander Expander(out, *this, Vars);
+    Expander << item.Body;
+    Expander.Flush();
+    BodyCrc = Expander.Crc;
+  }
 
+  /*--- Record the variables of the page @see GetPageVersion --- */
+  if(Index >= mMenuItems.size())
+    return;
+  if(Index >= mPageDeps.size())
+    mPageDeps.resize(Index + 1);
 
-  for(int i = WebServer.args(); --i >= 0;)
+  auto& Deps = mPageDeps[Index];
+  if(Deps.Renders > 0 && Deps.BodyCrc == BodyCrc)
   {
-    const String& Name = WebServer.argName(i);
-    const String& Arg = WebServer.arg(i);
-    VERBOSE("Arg[%d]: \"%s\" = \"%s\"", i, Name.c_str(), Arg.c_str());
+    Deps.Renders = 2; // same body again
+    return;
+  }
 
-    if(Name == "CMD")
-      CMD = &Arg;
-    else
-      SetVar(Name, Arg);
+  Deps.BodyCrc = BodyCrc;
+  Deps.Renders = 1;
+  Deps.Vars = std::move(Vars);
+  if(pTemplate)
+  {
+    for(const auto& Token : pTemplate->Tokens)
+    {
+      if(Token.Name && std::find(Deps.Vars.begin(), Deps.Vars.end(), Token.Name) == Deps.Vars.end())
+        Deps.Vars.push_back(Token.Name);
+    }
   }
+  Deps.Vars.shrink_to_fit();
+}
+#pragma endregion
 
+#pragma region ExpandToken
+void CController::ExpandToken(Stream& out, char* token, size_t len, size_t nameLen, const Expander* func) const
+{
+  if(!mFormValues.empty())
+  {
+    if(auto pValue = FindFormValue(token + 1, nameLen))
+    {
+      out.write(pValue->c_str(), pValue->length());
+      return;
+    }
+  }
 
-  /* Parse the command from Webserver request
-   * FORM_CMD: Command to be executed: e.g.: "REBOOT" or "LOGIN:Name"
-   * PlainCMD: CMD without any arguments: e.g.: "REBOOT" or "LOGIN"
-   * Arg: Argument of FORM_CMD: e.g.: "Name"
-   * CmdItr: Iterator to the command in the command list. If not found, it is mCMDs.end()
-   * Param: Invoker-Parameter for the command.
-  */
-  // PlainCMD: CMD without any arguments (: as sep)
-  int ArgPos = CMD->indexOf(':');
-  String PlainCMD = CMD->isEmpty()
-    ? ""
-    : CMD->substring(0, ArgPos)
-    ;
-  String Arg = (ArgPos == -1)
-    ? ""
-    : CMD->substring(ArgPos + 1)
-    ;
-  homekit_value_t Arg0 = static_value_cast(Arg.c_str());
-  CInvokerParam Param{ &Arg0 };
-  auto CmdItr = FindCMD(PlainCMD);
+  if(func == nullptr)
+  {
+    // variable not found -> copy the original text
+    out.write(token, len);
+    return;
+  }
 
+  // "{VarName:Args}" -> "Args"
+  const bool HasArgs = len > nameLen + 3;
+  token[len - 1] = '\0';
+  const char* Args = HasArgs ? token + nameLen + 2 : "";
+  const homekit_value_t Arg0 = static_value_cast(Args);
 
-  /* Set the selected menu item by the URI of the WebServer request
-   * e.g. "/device" -> "Device Information" - Menu
-  */
+  // expand variable by calling the expander-function @see CInvokerParam
+  out << (*func)(HasArgs ? &Arg0 : nullptr);
+}
+#pragma endregion
+
+#pragma region CBodyExpander
+/* Passes the text of a Body emitter on to 'out', a "{VarName:Args}" is
+* collected (up to MaxTokenLength) and written expanded.
+* @note Flush must be called at the end.
+*/
+class CController::CBodyExpander : public StreamNull
+{
+  static constexpr size_t MaxTokenLength = CPageTemplate::MaxTokenLength;
+
+  Stream&                   mOut;
+  const CController&        mCtrl;
+  std::vector<const char*>& mVars;      // names of the found variables
+  char                      mToken[MaxTokenLength + 1];
+  size_t                    mLen{};     // of mToken, 0: outside of a variable
+  size_t                    mNameLen{}; // 0: no ':' in mToken
+
+public:
+  uint32_t Crc{ 0xffffffff }; // of the text before expansion
+
+  CBodyExpander(Stream& out, const CController& ctrl, std::vector<const char*>& vars)
+    : mOut(out), mCtrl(ctrl), mVars(vars) {}
+
+  /* Write an unfinished variable as text. */
+  void Flush()
   {
-    int MIdx = IndexOfMenuURI(WebServer.uri().c_str());
-    if(MIdx >= 0)
-      SetSelectedMenuItemIndex(MIdx);
+    if(mLen)
+    {
+      mToken[mLen] = '\0';
+      ERROR("Missing '}' in \"%.32s\"", mToken);
+      mOut.write(mToken, mLen);
+      mLen = 0;
+    }
   }
 
-  /* Execute the command
-   * If the command is not found, an error message is output.
-   * If the command is found, the command is executed.
-   * If the command is marked with CmdAttr_FirstSendPage, the page is sent first.
-  */
-  if(CmdItr != mCMDs.end())
+  virtual size_t write(uint8_t v) override
   {
-    Attr = CmdItr->second.Attr;
-    if(Attr != CmdAttr_FirstSendPage)
-      InvokeCMD(CmdItr, PlainCMD, Param);
+    return write(&v, 1);
   }
-  else if(!CMD->isEmpty())
+
+  virtual size_t write(const uint8_t* buffer, size_t size) override
   {
-    ERROR("Unsupported CMD \"%s\"", PlainCMD.c_str());
+    Crc = crc32(buffer, size, Crc);
+    const char* Pos = reinterpret_cast<const char*>(buffer);
+    const char* const End = Pos + size;
+    while(Pos < End)
+    {
+      if(mLen == 0)
+      {
+        auto Open = static_cast<const char*>(memchr(Pos, '{', End - Pos));
+        mOut.write(Pos, (Open ? Open : End) - Pos);
+        if(Open == nullptr)
+          break;
+        mToken[mLen++] = '{';
+        mNameLen = 0;
+        Pos = Open + 1;
+        continue;
+      }
+
+      const char c = *Pos++;
+      mToken[mLen++] = c;
+      if(c == '}')
+        ExpandToken();
+      else if(c == ':' && mNameLen == 0)
+        mNameLen = mLen - 2;
+      else if(mLen == MaxTokenLength)
+      {
+        // too long for a variable -> text
+        mOut.write(mToken, mLen);
+        mLen = 0;
+      }
+    }
+    return size;
   }
 
-  /* Send the HTML page to the client.
-  */
+private:
+  void ExpandToken()
   {
-    const auto* MenuItem = GetSelectedMenuItem();
+    const size_t Len = mLen;
+    const size_t NameLen = mNameLen ? mNameLen : Len - 2;
+    mLen = 0;
+    if(NameLen == 0)
+    {
+      mOut.write(mToken, Len);
+      return;
+    }
 
-    DispatchWebseverUriRequest
-    (
+    // "{VarName:Args}" -> "VarName"
+    const char Sep = mToken[1 + NameLen];
+    mToken[1 + NameLen] = '\0';
+    auto It = mCtrl.mVars.find(mToken + 1);
+    const Expander* Func = nullptr;
+    if(It != mCtrl.mVars.end())
+    {
+      Func = &It->Value;
+      if(std::find(mVars.begin(), mVars.end(), It->Name) == mVars.end())
+        mVars.push_back(It->Name);
+    }
+    else
+    {
+      WARN("Variable \"%.32s\" not found", mToken + 1);
+    }
+    mToken[1 + NameLen] = Sep;
+    mToken[Len] = '\0';
+    mCtrl.ExpandToken(mOut, mToken, Len, NameLen, Func);
+  }
+};
+
+#pragma endregion
+
+#pragma region CPageTemplate
+void CController::CPageTemplate::Compile(const CController& ctrl, const __FlashStringHelper* text)
+{
+  Text = reinterpret_cast<PGM_P>(text);
+  Tokens.clear();
+  if(Text == nullptr)
+    return;
+
+  const size_t Length = std::min<size_t>(strlen_P(Text), std::numeric_limits<uint16_t>::max());
+  size_t LiteralPos = 0;
+  size_t OpenPos = 0, SepPos = 0; // of '{' and ':' of the current variable
+  bool   Open = false;
+
+  auto AddLiteral = [&](size_t end)
+    {
+      if(end > LiteralPos)
+        Tokens.push_back({ .Pos = uint16_t(LiteralPos), .Len = uint16_t(end - LiteralPos) });
+    };
+
+  for(size_t Pos = 0; Pos < Length; ++Pos)
+  {
+    const char c = pgm_read_byte(Text + Pos);
+    if(!Open)
+    {
+      if(c == '{')
+      {
+        Open = true;
+        OpenPos = Pos;
+        SepPos = 0;
+      }
+    }
+    else if(c == ':' && SepPos == 0)
+    {
+      SepPos = Pos;
+    }
+    else if(c == '}')
+    {
+      // Split "{VarName:Args}" -> "VarName" and "Args"
+      Open = false;
+      const size_t Len = Pos + 1 - OpenPos;
+      const size_t NameLen = (SepPos ? SepPos : Pos) - OpenPos - 1;
+      if(NameLen == 0 || NameLen > std::numeric_limits<uint8_t>::max() || Len > MaxTokenLength)
+        continue; // literal
+
+      AddLiteral(OpenPos);
+      Tokens.push_back({ .Pos = uint16_t(OpenPos), .Len = uint16_t(Len), .NameLen = uint8_t(NameLen) });
+      LiteralPos = Pos + 1;
+    }
+  }
+  if(Open) // rest is literal
+  {
+    char Snippet[33];
+    const size_t Size = std::min(sizeof(Snippet) - 1, Length - OpenPos);
+    memcpy_P(Snippet, Text + OpenPos, Size);
+    Snippet[Size] = '\0';
+    ERROR("Missing '}' in \"%s\"", Snippet);
+  }
+  AddLiteral(Length);
+  Tokens.shrink_to_fit();
+  VarGeneration = ctrl.mVarGeneration - 1; // resolved by the first Expand
+
+  char Buffer[64];
+  TextCrc = 0xffffffff;
+  for(size_t Pos = 0; Pos < Length; Pos += sizeof(Buffer))
+  {
+    const size_t Size = std::min(sizeof(Buffer), Length - Pos);
+    memcpy_P(Buffer, Text + Pos, Size);
+    TextCrc = crc32(Buffer, Size, TextCrc);
+  }
+}
+
+void CController::CPageTemplate::Resolve(const CController& ctrl)
+{
+  char Name[MaxTokenLength + 1];
+  for(auto& Token : Tokens)
+  {
+    if(Token.NameLen == 0)
+      continue;
+
+    memcpy_P(Name, Text + Token.Pos + 1, Token.NameLen);
+    Name[Token.NameLen] = '\0';
+    auto It = ctrl.mVars.find(Name);
+    Token.Func = It != ctrl.mVars.end() ? &It->Value : nullptr;
+    Token.Name = It != ctrl.mVars.end() ? It->Name : nullptr;
+    if(Token.Func == nullptr)
+      WARN("Variable \"%.32s\" not found", Name);
+  }
+  VarGeneration = ctrl.mVarGeneration;
+}
+
+void CController::CPageTemplate::Expand(Stream& out, const CController& ctrl)
+{
+  char Buffer[MaxTokenLength + 1];
+  for(const auto& Token : Tokens)
+  {
+    if(Token.NameLen == 0)
+    {
+      WriteFlashText(out, Text + Token.Pos, Token.Len);
+      continue;
+    }
+
+    // an expander may have added variables
+    if(VarGeneration != ctrl.mVarGeneration)
+      Resolve(ctrl);
+
+    memcpy_P(Buffer, Text + Token.Pos, Token.Len);
+    Buffer[Token.Len] = '\0';
+    ctrl.ExpandToken(out, Buffer, Token.Len, Token.NameLen, Token.Func);
+  }
+}
+
+#pragma endregion
+
+#pragma region PerformWebServerRequest
+void CController::PerformWebServerRequest()
+{
+  CmdAttribute Attr{};
+  const String* CMD = &emptyString;
+
+
+  for(int i = WebServer.args(); --i >= 0;)
+  {
+    const String& Name = WebServer.argName(i);
+    const String& Arg = WebServer.arg(i);
+    VERBOSE("Arg[%d]: \"%s\" = \"%s\"", i, Name.c_str(), Arg.c_str());
+
+    if(Name == "CMD")
+      CMD = &Arg;
+    else if(mFormValues.size() < MaxFormValues)
+      mFormValues.push_back({ Name, Arg });
+    else
+      WARN("Form argument \"%.32s\" ignored", Name.c_str());
+  }
+
+
+  /* Parse the command from Webserver request
+   * FORM_CMD: Command to be executed: e.g.: "REBOOT" or "LOGIN:Name"
+   * PlainCMD: CMD without any arguments: e.g.: "REBOOT" or "LOGIN"
+   * Arg: Argument of FORM_CMD: e.g.: "Name"
+   * CmdItr: Iterator to the command in the command list. If not found, it is mCMDs.end()
+   * Param: Invoker-Parameter for the command.
+  */
+  // PlainCMD: CMD without any arguments (: as sep)
+  int ArgPos = CMD->indexOf(':');
+  String PlainCMD = CMD->isEmpty()
+    ? ""
+    : CMD->substring(0, ArgPos)
+    ;
+  String Arg = (ArgPos == -1)
+    ? ""
+    : CMD->substring(ArgPos + 1)
+    ;
+  homekit_value_t Arg0 = static_value_cast(Arg.c_str());
+  CInvokerParam Param{ &Arg0 };
+  auto CmdItr = FindCMD(PlainCMD);
+
+
+  /* Set the selected menu item by the URI of the WebServer request
+   * e.g. "/device" -> "Device Information" - Menu
+  */
+  {
+    int MIdx = IndexOfMenuURI(WebServer.uri().c_str());
+    if(MIdx >= 0)
+      SetSelectedMenuItemIndex(MIdx);
+  }
+
+  /* Execute the command
+   * If the command is not found, an error message is output.
+   * If the command is found, the command is executed.
+   * If the command is marked with CmdAttr_FirstSendPage, the page is sent first.
+  */
+  if(CmdItr != mCMDs.end())
+  {
+    Attr = CmdItr->Value.Attr;
+    if(Attr != CmdAttr_FirstSendPage)
+      InvokeCMD(CmdItr, PlainCMD, Param);
+  }
+  else if(!CMD->isEmpty())
+  {
+    ERROR("Unsupported CMD \"%s\"", PlainCMD.c_str());
+  }
+
+  /* Send the HTML page to the client.
+  */
+  {
+    const auto* MenuItem = GetSelectedMenuItem();
+
+    DispatchWebseverUriRequest
+    (
       MenuItem != nullptr
       ? MenuItem->URI
       : WebServer.uri().c_str()
     );
   }
 
-  /* Execute the command
-   * If the command is marked with CmdAttr_FirstSendPage, the page is sent first.
-  */
-  if(Attr == CmdAttr_FirstSendPage && CmdItr != mCMDs.end())
+  /* Execute the command
+   * If the command is marked with CmdAttr_FirstSendPage, the page is sent first.
+  */
+  if(Attr == CmdAttr_FirstSendPage && CmdItr != mCMDs.end())
+  {
+    // after the page has reached the client, from Loop
+    Defer([this, PlainCMD, Arg]
+      {
+        homekit_value_t Arg0 = static_value_cast(Arg.c_str());
+        InvokeCMD(FindCMD(PlainCMD), PlainCMD, { &Arg0 });
+      }, 0, true);
+  }
+
+  mFormValues = {}; // release the memory, too
+
+}
+#pragma endregion
+
+#pragma region PerformWebServerVarRequest
+void CController::PerformWebServerVarRequest()
+{
+  uint32_t StartMS = millis();
+  String ResultText;
+  int ArgIndex;
+
+  //Serial.printf("HTTP_GET /var:\n");
+
+  if(WebServer.hasArg(F("batch")))
+  {
+    PerformWebServerVarBatchRequest(WebServer.arg(F("batch")));
+    return;
+  }
+
+  for(ArgIndex = 0; ArgIndex < WebServer.args(); ++ArgIndex)
+  {
+    //Serial.printf("\t\"%s\" = \"%s\"\n", WebServer.argName(ArgIndex).c_str(), WebServer.arg(ArgIndex).c_str());
+
+    const String& Name = WebServer.argName(ArgIndex);
+    if(TryGetVar(Name, nullptr))
+      break;
+
+  }
+
+  if(ArgIndex >= WebServer.args())
+  {
+    WebServer.send(404, "text/plain", "Variable Not found");
+
+    ResultText.reserve(256);
+
+    for(ArgIndex = 0; ArgIndex < WebServer.args(); ++ArgIndex)
+    {
+      const String& Name = WebServer.argName(ArgIndex);
+      ResultText += F("\"");
+      ResultText += WebServer.argName(ArgIndex);
+      ResultText += F("\" ");
+    }
+
+    // get IP of the client
+    ResultText += F(" From: ");
+    ResultText += WebServer.client().remoteIP().toString();
+
+    ERROR("HTTP_GET /var: Not found: %s", ResultText.c_str());
+  }
+  else
+  {
+    const String& Name = WebServer.argName(ArgIndex);
+    const String& ArgContent = WebServer.arg(ArgIndex);
+    CInvokerParam Param;
+    homekit_value_t Arg0;
+
+    if(!ArgContent.isEmpty())
+    {
+      Arg0 = static_value_cast<const char*>(ArgContent.c_str());
+      Param.Args[0] = &Arg0;
+    }
+
+    // use HTTP/1.1 Chunked response to avoid building a huge temporary string
+    if(WebServer.chunkedResponseModeStart(200, "text/html"))
+    {
+      CStreamPassThru HtmlOutStream
+      (
+        [&](const uint8_t* buffer, size_t size) -> size_t
+        {
+          WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
+          return size;
+        },
+        mSendBufferSize
+      );
+      TryGetVar(Name, HtmlOutStream, Param);
+      HtmlOutStream.Flush();
+      WebServer.chunkedResponseFinalize();
+      StartMS = millis() - StartMS;
+      if(StartMS > 200)
+      VERBOSE("VAR %s Sent: %d bytes in %d chunks | Free heap: %d bytes | %d ms", Name.c_str(), HtmlOutStream.Size, HtmlOutStream.Chunks, system_get_free_heap_size(), StartMS);
+    }
+    else
+    {
+      TryGetVar(Name, &ResultText, Param);
+      WebServer.send(200, "text/plain", ResultText);
+    }
+  }
+}
+#pragma endregion
+
+#pragma region PerformWebServerVarBatchRequest
+void CController::PerformWebServerVarBatchRequest(const String& names) const
+{
+  uint32_t StartMS = millis();
+  size_t Count = 0;
+
+  // {"NAME":"value",...}, null for unknown variables
+  auto WriteJson = [&](Stream& out)
+    {
+      char Name[48];
+      size_t Start = 0;
+
+      out.write('{');
+      while(Start < names.length())
+      {
+        int End = names.indexOf(',', Start);
+        if(End == -1)
+          End = names.length();
+
+        size_t Len = std::min<size_t>(End - Start, sizeof(Name) - 1);
+        memcpy(Name, names.c_str() + Start, Len);
+        Name[Len] = '\0';
+        Start = End + 1;
+        if(Len == 0)
+          continue;
+
+        if(Count++ > 0)
+          out.write(',');
+        out.write('"');
+        CStreamJsonString(out).write(reinterpret_cast<const uint8_t*>(Name), Len);
+        out.write("\":", 2);
+        if(TryGetVar(Name, nullptr))
+        {
+          out.write('"');
+          CStreamJsonString Value(out);
+          TryGetVar(Name, Value);
+          out.write('"');
+        }
+        else
+        {
+          out.write("null", 4);
+          WARN("VAR batch: \"%s\" not found", Name);
+        }
+      }
+      out.write('}');
+    };
+
+  if(WebServer.chunkedResponseModeStart(200, "application/json"))
+  {
+    CStreamPassThru OutStream
+    (
+      [&](const uint8_t* buffer, size_t size) -> size_t
+      {
+        WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
+        return size;
+      },
+      mSendBufferSize
+    );
+    WriteJson(OutStream);
+    OutStream.Flush();
+    WebServer.chunkedResponseFinalize();
+    StartMS = millis() - StartMS;
+    if(StartMS > 200)
+      VERBOSE("VAR batch of %d Sent: %d bytes in %d chunks | Free heap: %d bytes | %d ms", Count, OutStream.Size, OutStream.Chunks, system_get_free_heap_size(), StartMS);
+  }
+  else
+  {
+    WebServer.send(200, "application/json", to_string(WriteJson));
+  }
+}
+#pragma endregion
+
+#pragma region SendJson
+void CController::SendJson(int code, const CTextEmitter& writeJson) const
+{
+  if(WebServer.chunkedResponseModeStart(code, "application/json"))
+  {
+    CStreamPassThru OutStream
+    (
+      [&](const uint8_t* buffer, size_t size) -> size_t
+      {
+        WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
+        return size;
+      },
+      mSendBufferSize
+    );
+    OutStream << writeJson;
+    OutStream.Flush();
+    WebServer.chunkedResponseFinalize();
+  }
+  else
+  {
+    WebServer.send(code, "application/json", to_string(writeJson));
+  }
+}
+#pragma endregion
+
+#pragma region PerformApiVarsRequest
+void CController::PerformApiVarsRequest() const
+{
+  uint32_t StartMS = millis();
+  size_t Count = 0;
+
+  SendJson(200, [&](Stream& out)
+    {
+      out.write('{');
+      // by index: an expander may add variables
+      for(size_t i = 0; i < mVars.size(); ++i)
+      {
+        const auto& Var = *(mVars.begin() + i);
+        if(mHiddenVars.find(Var.Name) != mHiddenVars.end())
+          continue;
+
+        if(Count++ > 0)
+          out.write(',');
+        out.write('"');
+        CStreamJsonString(out).write(reinterpret_cast<const uint8_t*>(Var.Name), strlen(Var.Name));
+        out.write("\":", 2);
+        WriteJsonValue(out, Var.Value({}));
+      }
+      out.write('}');
+    });
+
+  StartMS = millis() - StartMS;
+  if(StartMS > 200)
+    VERBOSE("API vars: %d sent | Free heap: %d bytes | %d ms", Count, system_get_free_heap_size(), StartMS);
+}
+#pragma endregion
+
+#pragma region PerformApiVarRequest
+void CController::PerformApiVarRequest(const String& name) const
+{
+  // hidden variables are not part of the API (@see HideVar)
+  auto It = mVars.find(name);
+  if(It == mVars.end() || mHiddenVars.find(It->Name) != mHiddenVars.end())
+  {
+    WARN("API var \"%s\" not found", name.c_str());
+    SendJson(404, MakeTextEmitter(F("{\"error\":\"Variable not found\"}")));
+    return;
+  }
+
+  CInvokerParam Param;
+  homekit_value_t Arg0;
+  const String& ArgContent = WebServer.arg(F("arg"));
+  if(!ArgContent.isEmpty())
+  {
+    Arg0 = static_value_cast<const char*>(ArgContent.c_str());
+    Param.Args[0] = &Arg0;
+  }
+
+  SendJson(200, [&](Stream& out)
+    {
+      out.write("{\"", 2);
+      CStreamJsonString(out).write(reinterpret_cast<const uint8_t*>(It->Name), strlen(It->Name));
+      out.write("\":", 2);
+      WriteJsonValue(out, It->Value(Param));
+      out.write('}');
+    });
+}
+#pragma endregion
+
+#pragma region PerformApiCmdRequest
+void CController::PerformApiCmdRequest(const String& name)
+{
+  auto CmdItr = FindCMD(name);
+  if(CmdItr == mCMDs.end())
+  {
+    ERROR("API: Unsupported CMD \"%s\"", name.c_str());
+    SendJson(404, MakeTextEmitter(F("{\"error\":\"Command not found\"}")));
+    return;
+  }
+
+  // names stay valid when a command adds commands, entries may move
+  const char* CmdName = CmdItr->Name;
+  bool Deferred = CmdItr->Value.Attr == CmdAttr_FirstSendPage;
+  String Arg = WebServer.arg(F("arg"));
+
+  if(Deferred)
+  {
+    // after the response has reached the client, from Loop
+    Defer([this, name, Arg]
+      {
+        homekit_value_t Arg0 = static_value_cast(Arg.c_str());
+        InvokeCMD(FindCMD(name), name, { &Arg0 });
+      }, 0, true);
+  }
+  else
+  {
+    homekit_value_t Arg0 = static_value_cast(Arg.c_str());
+    InvokeCMD(CmdItr, name, { &Arg0 });
+  }
+
+  SendJson(200, [&](Stream& out)
+    {
+      out.write("{\"cmd\":\"", 8);
+      CStreamJsonString(out).write(reinterpret_cast<const uint8_t*>(CmdName), strlen(CmdName));
+      out.print(Deferred ? F("\",\"deferred\":true}") : F("\",\"deferred\":false}"));
+    });
+}
+#pragma endregion
+
+#pragma region PerformEventSubscribe
+void CController::PerformEventSubscribe()
+{
+  // remove closed ones
+  for(auto It = mEventSubscribers.begin(); It != mEventSubscribers.end(); )
+  {
+    if(It->Client.connected())
+      ++It;
+    else
+      It = mEventSubscribers.erase(It);
+  }
+
+  if(mEventSubscribers.size() >= MaxEventSubscribers)
+  {
+    WARN("Events: no free channel");
+    WebServer.send(503, "text/plain", "No free event channel");
+    return;
+  }
+
+  CEventSubscriber Sub;
+  Sub.Client = WebServer.client();
+
+  // "A,B:Arg,C"
+  const String& Vars = WebServer.arg(F("vars"));
+  size_t Start = 0;
+  while(Start < Vars.length())
+  {
+    int End = Vars.indexOf(',', Start);
+    if(End == -1)
+      End = Vars.length();
+
+    String Spec = Vars.substring(Start, End);
+    Start = End + 1;
+
+    String Arg;
+    int SepPos = Spec.indexOf(':');
+    if(SepPos != -1)
+    {
+      Arg = Spec.substring(SepPos + 1);
+      Spec.remove(SepPos);
+    }
+
+    auto It = mVars.find(Spec);
+    if(It != mVars.end())
+      Sub.Vars.push_back({ .Name = It->Name, .Arg = std::move(Arg) });
+    else
+      WARN("Events: variable \"%.32s\" not found", Spec.c_str());
+  }
+
+  if(WebServer.hasArg(F("log")))
+  {
+    Sub.Log = true;
+    Sub.LogSequence = WebServer.arg(F("log")).toInt();
+    if(WebServer.hasHeader(F("Last-Event-ID")))
+      Sub.LogSequence = WebServer.header(F("Last-Event-ID")).toInt() + 1;
+  }
+
+  // The connection is kept, the web server forgets it after this handler.
+  // No keep-alive: the server would otherwise wait for a next request on it.
+  WebServer.keepAlive(false);
+  Sub.Client.setNoDelay(true);
+  Sub.Client.print(F(
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n"
+    "retry: 5000\n\n"));
+
+  VERBOSE("Events: subscriber #%d with %d vars%s", mEventSubscribers.size() + 1, Sub.Vars.size(), Sub.Log ? " and log" : "");
+
+  mEventSubscribers.push_back(std::move(Sub));
+  SendEvents(mEventSubscribers.back(), millis()); // current values
+}
+#pragma endregion
+
+#pragma region SendEvents
+void CController::SendEvents()
+{
+  const uint32_t CurTick = millis();
+  for(auto It = mEventSubscribers.begin(); It != mEventSubscribers.end(); )
+  {
+    if(It->Client.connected() && SendEvents(*It, CurTick))
+    {
+      ++It;
+    }
+    else
+    {
+      It->Client.stop();
+      It = mEventSubscribers.erase(It);
+    }
+  }
+}
+
+bool CController::SendEvents(CEventSubscriber& sub, uint32_t curTick)
+{
+  const size_t Space = static_cast<size_t>(sub.Client.availableForWrite());
+  if(Space < MinEventWriteSpace)
+    return curTick - sub.LastSendMS < EventStallTimeoutMS; // try again with the next check
+
+  bool Ok = true;
+  CStreamPassThru OutStream
+  (
+    [&](const uint8_t* buffer, size_t size) -> size_t
+    {
+      // would block; a partly sent event cannot be completed later, the client reconnects
+      if(Ok && (static_cast<size_t>(sub.Client.availableForWrite()) < size || sub.Client.write(buffer, size) != size))
+        Ok = false;
+      return size;
+    },
+    std::min(mSendBufferSize, Space)
+  );
+  Stream& Out = OutStream;
+  bool Sent = false;
+
+  auto WriteValue = [this](Stream& out, const CEventSubscriber::CWatch& w)
+    {
+      const homekit_value_t Arg0 = static_value_cast(w.Arg.c_str());
+      TryGetVar(w.Name, out, w.Arg.isEmpty() ? nullptr : &Arg0);
+    };
+
+  /*--- Changed variables: {"NAME":"value",...} --- */
+  uint8_t ValueBuffer[MaxEventValueSize];
+  for(auto& W : sub.Vars)
+  {
+    CStreamCrcWindow Value(ValueBuffer, 0, sizeof(ValueBuffer));
+    WriteValue(Value, W);
+    if(W.Sent && W.Crc == Value.Crc)
+      continue;
+
+    // the values that do not fit follow with the next check (escaping not counted)
+    const size_t NameLen = strlen(W.Name);
+    if(OutStream.Size + NameLen + W.Arg.length() + Value.Size + 24 > Space)
+      break;
+
+    if(!Sent)
+      Out.write("event: vars\ndata: {\"", 20);
+    else
+      Out.write(",\"", 2);
+    Out.write(W.Name, NameLen);
+    if(!W.Arg.isEmpty())
+    {
+      Out.write(':');
+      CStreamJsonString(Out).write(reinterpret_cast<const uint8_t*>(W.Arg.c_str()), W.Arg.length());
+    }
+    Out.write("\":\"", 3);
+    CStreamJsonString Json(Out);
+    if(Value.Filled == Value.Size)
+      Json.write(ValueBuffer, Value.Filled);
+    else
+      WriteValue(Json, W); // larger than MaxEventValueSize
+    Out.write('"');
+
+    W.Crc = Value.Crc;
+    W.Sent = Sent = true;
+  }
+  if(Sent)
+    Out.write("}\n\n", 3);
+
+  /*--- New log lines: one event per line --- */
+  if(sub.Log && gbLogging)
+  {
+    const uint32_t End = gbLogging->Sequence();
+    const uint32_t First = gbLogging->FirstSequence();
+    if(sub.LogSequence - First > End - First) // too old or after a reboot
+      sub.LogSequence = First;
+
+    for(; sub.LogSequence != End; ++sub.LogSequence)
+    {
+      const char* pLine = gbLogging->GetLineBySequence(sub.LogSequence);
+      if(pLine == nullptr)
+        continue;
+
+      char Head[40];
+      const int Len = snprintf_P(Head, sizeof(Head), PSTR("event: log\nid: %u\ndata: \""), sub.LogSequence);
+      const size_t LineLen = strlen(pLine);
+      if(OutStream.Size + Len + LineLen + 3 > Space)
+        break; // the other lines with the next check
+      Out.write(Head, Len);
+      CStreamJsonString(Out).write(reinterpret_cast<const uint8_t*>(pLine), LineLen);
+      Out.write("\"\n\n", 3);
+      Sent = true;
+    }
+  }
+
+  /*--- Heartbeat --- */
+  if(Sent)
+    sub.LastSendMS = curTick;
+  else if(curTick - sub.LastSendMS >= EventHeartbeatMS)
   {
-    // waiting until page is sent
-    delay(1000);
-
-    InvokeCMD(CmdItr, PlainCMD, Param);
+    Out.write(":\n\n", 3);
+    sub.LastSendMS = curTick;
   }
 
+  OutStream.Flush();
+  return Ok;
 }
 #pragma endregion
 
-#pragma region PerformWebServerVarRequest
-void CController::PerformWebServerVarRequest()
+#pragma region PerformAssetRequest
+void CController::PerformAssetRequest(bool javaScript)
 {
-  uint32_t StartMS = millis();
-  String ResultText;
-  int ArgIndex;
+  const uint32_t Version = strtoul(WebServer.arg(F("v")).c_str(), nullptr, 16);
 
-  //Serial.printf("HTTP_GET /var:\n");
-
-  for(ArgIndex = 0; ArgIndex < WebServer.args(); ++ArgIndex)
+  size_t Index = 0;
+  for(auto& Item : mMenuItems)
   {
-    //Serial.printf("\t\"%s\" = \"%s\"\n", WebServer.argName(ArgIndex).c_str(), WebServer.arg(ArgIndex).c_str());
-
-    const String& Name = WebServer.argName(ArgIndex);
-    if(TryGetVar(Name, nullptr))
-      break;
-
-  }
+    auto& Asset = GetMenuAsset(Index++, Item, javaScript);
+    if(Asset.Crc != Version || Asset.Size == 0)
+      continue;
 
-  if(ArgIndex >= WebServer.args())
-  {
-    WebServer.send(404, "text/plain", "Variable Not found");
+    char ETag[12];
+    snprintf_P(ETag, sizeof(ETag), PSTR("\"%08x\""), Asset.Crc);
+    WebServer.sendHeader(F("ETag"), ETag);
+    WebServer.sendHeader(F("Cache-Control"), F("public, max-age=31536000, immutable"));
 
-    ResultText.reserve(256);
+    if(WebServer.header(F("If-None-Match")) == ETag)
+    {
+      WebServer.send(304);
+      return;
+    }
 
-    for(ArgIndex = 0; ArgIndex < WebServer.args(); ++ArgIndex)
+    const char* ContentType = javaScript ? "text/javascript" : "text/css";
+    if(mSendJobs.size() < MaxSendJobs)
     {
-      const String& Name = WebServer.argName(ArgIndex);
-      ResultText += F("\"");
-      ResultText += WebServer.argName(ArgIndex);
-      ResultText += F("\" ");
+      CStreamPieces Content;
+      if(Content.Record([this, &Item, javaScript](Stream& out) { WriteMenuAsset(out, Item, javaScript); }))
+      {
+        if(Content.Size() != Asset.Size)
+          ERROR("Asset %s changed: %d of %d bytes", WebServer.uri().c_str(), Content.Size(), Asset.Size);
+        if(StartSendJob(std::move(Content), false, ContentType))
+          return;
+      }
     }
 
-    // get IP of the client
-    ResultText += F(" From: ");
-    ResultText += WebServer.client().remoteIP().toString();
+    WebServer.setContentLength(Asset.Size);
+    WebServer.send(200, ContentType, emptyString);
 
-    ERROR("HTTP_GET /var: Not found: %s", ResultText.c_str());
+    CStreamPassThru OutStream
+    (
+      [&](const uint8_t* buffer, size_t size) -> size_t
+      {
+        WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
+        return size;
+      },
+      mSendBufferSize
+    );
+    WriteMenuAsset(OutStream, Item, javaScript);
+    OutStream.Flush();
+    VERBOSE("Asset %s sent: %d bytes", WebServer.uri().c_str(), OutStream.Size);
+    return;
   }
-  else
-  {
-    const String& Name = WebServer.argName(ArgIndex);
-    const String& ArgContent = WebServer.arg(ArgIndex);
-    CInvokerParam Param;
-    homekit_value_t Arg0;
 
-    if(!ArgContent.isEmpty())
-    {
-      Arg0 = static_value_cast<const char*>(ArgContent.c_str());
-      Param.Args[0] = &Arg0;
-    }
+  WebServer.send(404, "text/plain", "Asset not found");
+}
 
-    // use HTTP/1.1 Chunked response to avoid building a huge temporary string
-    if(WebServer.chunkedResponseModeStart(200, "text/html"))
-    {
-      CStreamPassThru HtmlOutStream
-      (
-        [&](const uint8_t* buffer, size_t size) -> size_t
-        {
-          //Serial.printf("%02x ", buffer[0]);
-          WebServer.sendContent_P(reinterpret_cast<const char*>(buffer), size);
-          return size;
-        }
-      );
-      TryGetVar(Name, HtmlOutStream, Param);
-//Serial.printf("var %s %d\n", Name.c_str(), HtmlOutStream.Size);
-      WebServer.chunkedResponseFinalize();
-      StartMS = millis() - StartMS;
-      if(StartMS > 200)
-      VERBOSE("VAR %s Sent: %d bytes | Free heap: %d bytes | %d ms", Name.c_str(), HtmlOutStream.Size, system_get_free_heap_size(), StartMS);
-    }
-    else
-    {
-      TryGetVar(Name, &ResultText, Param);
-      WebServer.send(200, "text/plain", ResultText);
-    }
+const CController::CAssetInfo& CController::GetMenuAsset(size_t index, const CHtmlWebSiteMenuItem& item, bool javaScript) const
+{
+  if(index >= mMenuAssets.size())
+    mMenuAssets.resize(index + 1);
+
+  auto& Asset = javaScript ? mMenuAssets[index].JavaScript : mMenuAssets[index].CSS;
+  if(!Asset.Valid)
+  {
+    CStreamCrc Crc;
+    WriteMenuAsset(Crc, item, javaScript);
+    Asset.Crc = Crc.Crc;
+    Asset.Size = Crc.Size;
+    Asset.Valid = true;
+  }
+  return Asset;
+}
+
+void CController::WriteMenuAsset(Stream& out, const CHtmlWebSiteMenuItem& item, bool javaScript) const
+{
+  if(javaScript)
+  {
+    if(item.JavaScript)
+      item.JavaScript(out);
+  }
+  else
+  {
+    mBuilder->StyleSheet(out, item.CSS);
   }
 }
+
 #pragma endregion
 
 #pragma region DispatchWebseverUriRequest
@@ -1941,7 +3367,7 @@ void CController::InvokeCMD(const_cmd_iterator cmdItr, const String& cmd, CInvok
       to_string(*param.Args[0], ArgBuf, sizeof(ArgBuf));
 
     INFO("CMD \"%s\" %s", cmd.c_str(), ArgBuf);
-    cmdItr->second.Invoker(param);
+    cmdItr->Value.Invoker(param);
   }
   else
   {
@@ -1955,11 +3381,13 @@ void CController::InstallStdCMDs()
 {
   InstallCmd("REBOOT", CmdAttr_FirstSendPage, [](auto)
     {
+      SimpleFileSystem::Sync();
       ESP.reset();
     });
   InstallCmd("RESET_PAIRING", CmdAttr_FirstSendPage, [](auto)
     {
       homekit_storage_reset();
+      SimpleFileSystem::Sync();
       ESP.reset();
     });
   InstallCmd("REFRESH", [](auto)
@@ -2023,6 +3451,60 @@ void CController::InstallStdVariables()
       return MakeTextEmitter(String(arduino_homekit_connected_clients_count()));
     });
 
+  #pragma endregion
+  #pragma region WEB_METRICS
+  SetVar("WEB_METRICS", [this](auto)
+    {
+      const auto& M = mWebMetrics;
+      char Text[224];
+      snprintf_P(Text, sizeof(Text), PSTR("%u pages, %u KB in %u chunks, %u not modified | last: %u bytes in %u chunks, %u ms | max. %u ms, step %u us, loop %u us | buffer %u bytes"),
+        M.Pages, M.Bytes / 1024, M.Chunks, M.NotModified, M.LastBytes, M.LastChunks, M.LastMS, M.MaxMS, M.MaxStepUS, M.MaxLoopUS, mSendBufferSize);
+      return MakeTextEmitter(String(Text));
+    });
+
+  #pragma endregion
+  #pragma region REGISTRY_INFO
+  SetVar("REGISTRY_INFO", [this](auto)
+    {
+      char Text[96];
+      snprintf_P(Text, sizeof(Text), PSTR("%u variables, %u commands | %u bytes"),
+        mVars.size(), mCMDs.size(), mVars.MemoryUsage() + mCMDs.MemoryUsage());
+      return MakeTextEmitter(String(Text));
+    });
+
+  #pragma endregion
+  #pragma region RENDER_BENCH
+  SetVar("RENDER_BENCH", [this](auto p)
+    {
+      constexpr int Count = 50;
+      const char* URI = p.Args[0] ? static_value_cast<const char*>(*p.Args[0]) : "/";
+
+      size_t Index = 0;
+      for(auto It = mMenuItems.begin(); It != mMenuItems.end(); ++It, ++Index)
+      {
+        const auto& Item = *It;
+        if(strcmp(Item.URI, URI) != 0 || (!Item.Body && !Item.BodyText))
+          continue;
+
+        CStreamCounter Legacy, Compiled;
+        uint32_t LegacyUS = micros();
+        for(int i = 0; i < Count; ++i)
+          ExpandVariables(Legacy, Item.BodyText ? String(Item.BodyText) : to_string(Item.Body));
+        LegacyUS = micros() - LegacyUS;
+
+        uint32_t CompiledUS = micros();
+        for(int i = 0; i < Count; ++i)
+          ExpandBody(Compiled, Item);
+        CompiledUS = micros() - CompiledUS;
+
+        char Text[128];
+        snprintf_P(Text, sizeof(Text), PSTR("%s: %u bytes, %u tokens | ExpandVariables %u us | ExpandBody %u us"),
+          URI, Legacy.Size / Count, mBodyTemplates[Index].Tokens.size(), LegacyUS / Count, CompiledUS / Count);
+        return MakeTextEmitter(String(Text));
+      }
+      return MakeTextEmitter(F("menu not found"));
+    });
+
   #pragma endregion
   #pragma region FORM_CMD
   SetVar("FORM_CMD", [this](auto p)
@@ -2131,7 +3613,27 @@ void CController::InstallStdVariables()
     });
   #pragma endregion
 
+  #pragma region Tracked Variables
+  // unchanged while running, pages with only these get an ETag (@see TrackVar)
+  mPageVersionSalt = ESP.random();
+  TrackVar("DEVICE_NAME");
+  TrackVar("MAC");
+  TrackVar("FORM_BEGIN");
+  TrackVar("FORM_END");
+  TrackVar("FORM_CMD");
+  TrackVar("PARAM_TABLE_BEGIN");
+  TrackVar("PARAM_TABLE_END");
+  #pragma endregion
 
+  #pragma region Hidden Variables
+  // page helpers and slow values, not part of the JSON API (@see HideVar)
+  HideVar("RENDER_BENCH");
+  HideVar("FORM_BEGIN");
+  HideVar("FORM_END");
+  HideVar("FORM_CMD");
+  HideVar("PARAM_TABLE_BEGIN");
+  HideVar("PARAM_TABLE_END");
+  #pragma endregion
 
 }
 #pragma endregion
@@ -2186,296 +3688,21 @@ void CController::CWiFiConnectionCtrl::ConnectOrDie()
 //END CController - Implementation
 #pragma endregion
 
-#pragma region CSimpleFileSystem - Implementation
-#define _PRT(f, ...) //Serial.printf(f, ##__VA_ARGS__)
-
-#pragma region CFileEnumerator::Next
-bool CSimpleFileSystem::CFileEnumerator::Next()
-{
-  if(mBeginModifyCounter != mFS.mModifyCounter)
-    return false;
-
-  while(++mIndex < MaxTableEntries)
-  {
-    const auto& E = mFS.mPage.Entries[mIndex];
-
-    if(E.Name[0] != 0)
-    {
-      memcpy(mName, E.Name, NameLength);
-      mName[NameLength] = 0;
-      return true;
-    }
-  }
-  return false;
-}
-
-#pragma endregion
-
-#pragma region Sync
-void CSimpleFileSystem::Sync()
-{
-  if(mWriteBackNeeded)
-  {
-    WritePage();
-    mWriteBackNeeded = false;
-    INFO("File system synced: %d bytes", mUsedMemorySize);
-    //DebugPrintTable();
-  }
-}
-
-#pragma endregion
-
-#pragma region FileSize
-int CSimpleFileSystem::FileSize(const char* pName) const
-{
-  int index = FindEntry(pName);
-  if(index < 0)
-    return -1;
-  return mPage.Entries[index].Size;
-}
-
-#pragma endregion
-
-#pragma region ReadFile
-int CSimpleFileSystem::ReadFile(const char* pName, uint8_t* pBuf, int Size)
-{
-  int index = FindEntry(pName);
-  if(index < 0)
-    return -1;
-
-  const auto& E = mPage.Entries[index];
-  const auto& M = mPage.Memory;
-
-  if(Size != E.Size)
-    return -1;
-
-  memcpy(pBuf, &M[E.StartOffset], E.Size);
-  return E.Size;
-}
-
-#pragma endregion
-
-#pragma region WriteFile
-/* Writes or creates a file.
-  * @param pName The name of the file. Must be 4 characters long.
-  * @param pBuf The buffer to write.
-  * @param Size The size of the buffer. Must be equal to the file size if the file already exists.
-  * @return The number of bytes written or -1 if the file system is full.
-*/
-int CSimpleFileSystem::WriteFile(const char* pName, const uint8_t* pBuf, int Size)
-{
-  bool NewFile = false;
-  int index = FindEntry(pName);
-  if(index < 0)
-  {
-    index = FindEntry(); // find empty slot
-    if(index < 0)
-    {
-      ERROR("No more entry for new files");
-      return -1;
-    }
-
-    size_t FreeMemory = sizeof(mPage.Memory) - mUsedMemorySize;
-    if(Size > FreeMemory)
-    {
-      ERROR("Not enough memory for new file");
-      return -1;
-    }
-
-    memcpy(mPage.Entries[index].Name, pName, NameLength);
-    NewFile = true;
-  }
-  else
-  {
-    if(mPage.Entries[index].Size != Size)
-    {
-      ERROR("Size mismatch for existing file");
-      return -1;
-    }
-  }
-
-  INFO("%s #%d \"%s\"  %d bytes"
-    , NewFile ? "CreateFile" : "WriteFile"
-    , index
-    , pName
-    , Size
-  );
-
-  auto& E = mPage.Entries[index];
-
-  if(NewFile)
-  {
-    E.StartOffset = mUsedMemorySize;
-    E.Size = Size;
-    mUsedMemorySize += Size;
-  }
-
-  bool Changed = memcmp(&mPage.Memory[E.StartOffset], pBuf, Size) != 0;
-
-  memcpy(&mPage.Memory[E.StartOffset], pBuf, Size);
-
-  if(Changed || NewFile)
-    Touch();
-  return Size;
-}
-
-#pragma endregion
-
-#pragma region List
-/* Lists the files in the file system.
-*/
-void CSimpleFileSystem::List()
-{
-  auto Enum = Files();
-  Serial.println("Files:");
-  while(Enum.Next())
-  {
-    Serial.printf
-    (
-      "\t\"%-4.4s\"  #%d\n"
-      , Enum.Current()
-      , FileSize(Enum.Current())
-    );
-  }
-  Serial.println();
-}
-
-#pragma endregion
-
-#pragma region Touch
-void CSimpleFileSystem::Touch()
-{
-  ++mModifyCounter;
-  mWriteBackNeeded = true;
-}
-
-#pragma endregion
-
-#pragma region ReadPage
-bool CSimpleFileSystem::ReadPage()
-{
-  if(!homekit_storage_common_read(EpromPage, 0, (uint8_t*)&mPage, sizeof(mPage)))
-    return false;
-
-  uint32_t Crc = crc32((const uint8_t*)&mPage.Entries[0], sizeof(mPage.Entries));
-  _PRT("ReadPage CRC %08X  %08X\n", Crc, mPage.Crc);
-  if(Crc != mPage.Crc)
-  {
-    return false;
-  }
-
-  const size_t MaxMemorySize = sizeof(mPage.Memory);
-  size_t MemOffset = 0;
-
-  for(int i = 0; i < MaxTableEntries; ++i)
-  {
-    const auto& E = mPage.Entries[i];
-    if(E.StartOffset >= MaxMemorySize)
-    {
-      _PRT("Invalid StartOffset %d\n", E.StartOffset);
-      return false;
-    }
-    if(E.StartOffset + E.Size > MaxMemorySize)
-    {
-      _PRT("Invalid Size %d\n", E.Size);
-      return false;
-    }
-
-
-    MemOffset = std::max<size_t>(MemOffset, E.StartOffset + E.Size);
-  }
-  mUsedMemorySize = MemOffset;
-
-  if(mUsedMemorySize > MaxMemorySize)
-  {
-    _PRT("Invalid MemorySize %d\n", mUsedMemorySize);
-    return false;
-  }
-
-  _PRT("ReadPage OK %d bytes\n", mUsedMemorySize);
-  return true;
-}
-#pragma endregion
-
-#pragma region WritePage
-bool CSimpleFileSystem::WritePage()
-{
-  mPage.Crc = crc32((const uint8_t*)&mPage.Entries[0], sizeof(mPage.Entries));
-  _PRT("WritePage CRC %08X\n", mPage.Crc);
-  return homekit_storage_common_write(EpromPage, 0, (uint8_t*)&mPage, sizeof(mPage));
-}
-
-#pragma endregion
-
-#pragma region Format
-void CSimpleFileSystem::Format()
-{
-  INFO("Formatting file system");
-  memset(&mPage, 0, sizeof(mPage));
-  mUsedMemorySize = 0;
-  Touch();
-}
-
-#pragma endregion
-
-#pragma region ReadPageOrFormat
-void CSimpleFileSystem::ReadPageOrFormat()
-{
-  bool State = ReadPage();
-
-  //DebugPrintTable();
-
-  if(!State)
-    Format();
-}
-
-#pragma endregion
-
-#pragma region FindEntry
-int CSimpleFileSystem::FindEntry(const char* pName) const
+#pragma region MakeHistoryInfoEmitter
+CTextEmitter MakeHistoryInfoEmitter(const CTimeSeriesStore* pStore)
 {
-  char InternalName[NameLength]{};
-  if(pName)
-    strncpy(InternalName, pName, NameLength);
-
-  for(int i = 0; i < MaxTableEntries; ++i)
-  {
-    if(memcmp(mPage.Entries[i].Name, InternalName, NameLength) == 0)
-      return i;
-  }
-  return -1;
-}
-
-#pragma endregion
+  if(!pStore)
+    return MakeTextEmitter(F("RAM only"));
 
-#pragma region DebugPrintTable
-void CSimpleFileSystem::DebugPrintTable()
-{
-  Serial.printf("(Debug) Table: #%d\n", mUsedMemorySize);
-  for(int i = 0; i < MaxTableEntries; ++i)
-  {
-    const auto& E = mPage.Entries[i];
-    if(E.Name[0] != 0)
-    {
-      Serial.printf
-      (
-        "\t%d: \"%-4.4s\"  %d #%d\n"
-        , i
-        , E.Name
-        , E.StartOffset
-        , E.Size
-      );
-    }
-  }
-  Serial.println();
+  char Buf[96];
+  auto St = pStore->Stats();
+  snprintf_P(Buf, sizeof(Buf), PSTR("%u records in %u sectors, max. %u erases per sector")
+    , St.Records + St.Buffered, St.Sectors, St.MaxEraseCount);
+  return MakeTextEmitter(Buf);
 }
 
 #pragma endregion
 
-#undef _PRT
-//END CSimpleFileSystem - Implementation
-#pragma endregion
-
 
 #pragma region >>> CHomeKit <<<
 
@@ -2489,7 +3716,10 @@ void CHomeKit::ResetPairing(bool reboot)
   mIsPaired = false;
   homekit_storage_reset();
   if(reboot)
+  {
+    SimpleFileSystem::Sync();
     ESP.reset();
+  }
 }
 
 #pragma endregion
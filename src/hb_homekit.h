@@ -20,10 +20,13 @@ using namespace HBHomeKit;
 #include <array>
 #include <memory>
 #include <list>
+#include <forward_list>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <cstddef>
 #include <homekit_debug.h>
+#include "hb_storage.h"
 #include <arduino_homekit_server.h>
 #include <homekit/homekit.h>
 #include <homekit/characteristics.h>
@@ -1397,6 +1400,72 @@ inline Stream& operator << (Stream& out, float value)
 
 #pragma endregion
 
+#pragma region WriteFlashText / CStreamPieces
+/* Write a PROGMEM text, e.g. of F(...).
+* A recording CStreamPieces keeps only the reference, any other stream
+* gets the bytes.
+*/
+void WriteFlashText(Stream&, PGM_P text, size_t len);
+inline void WriteFlashText(Stream& out, const __FlashStringHelper* text)
+{
+  PGM_P pText = reinterpret_cast<PGM_P>(text);
+  WriteFlashText(out, pText, strlen_P(pText));
+}
+
+/* Keeps a written text as pieces: the PROGMEM texts of WriteFlashText
+* (and so of MakeTextEmitter(F(...))) by reference, all other bytes in a
+* heap buffer. The text is then read out in parts (@see Read).
+* @see CController::CSendJob
+*/
+class CStreamPieces : public StreamNull
+{
+public:
+  /* Write the text of 'emitter' into the pieces.
+  * @return false if the heap ran out, the pieces are then incomplete
+  */
+  bool Record(const CTextEmitter& emitter);
+
+  /* Copy up to 'size' bytes from position 'pos' to 'buffer'.
+  * Reading on where the previous Read ended needs no search.
+  * @return copied bytes
+  */
+  size_t Read(size_t pos, uint8_t* buffer, size_t size);
+
+  size_t Size() const { return mSize; }
+  size_t HeapSize() const { return mTextSize; } // bytes not in the flash
+
+  virtual size_t write(uint8_t v) override
+  {
+    return write(&v, 1);
+  }
+  virtual size_t write(const uint8_t* buffer, size_t size) override;
+
+private:
+  friend void WriteFlashText(Stream&, PGM_P, size_t);
+  void WriteFlash(PGM_P text, size_t len);
+
+  struct CPiece
+  {
+    PGM_P     Flash;    // nullptr: Len bytes of mText from Pos
+    uint16_t  Pos, Len;
+  };
+  struct CFree
+  {
+    void operator()(uint8_t* p) const { free(p); }
+  };
+
+  std::vector<CPiece>             mPieces;
+  std::unique_ptr<uint8_t, CFree> mText;
+  size_t                          mTextSize{}, mTextCapacity{};
+  size_t                          mSize{};
+  bool                            mFailed{};
+  size_t                          mReadPiece{}, mReadPos{}; // piece of the last Read, its position
+
+  static CStreamPieces* spRecording;
+};
+
+#pragma endregion
+
 #pragma region MakeTextEmitter
 /* Create a CTextEmitter from a static text.
 * @param text The text to stream
@@ -1405,7 +1474,7 @@ inline Stream& operator << (Stream& out, float value)
 */
 inline CTextEmitter MakeTextEmitter(const __FlashStringHelper* text)
 {
-  return [text](Stream& p) { p << text; };
+  return [text](Stream& p) { WriteFlashText(p, text); };
 }
 inline CTextEmitter MakeTextEmitter(const String& text)
 {
@@ -2077,6 +2146,61 @@ struct ILogging
   virtual ILoggingEnumerator_Ptr GetEnumerator() const = 0;
   virtual String GetLine(uint32_t id) const = 0;
 
+  /* Sequence number of the next completed line, counted since start.
+  * Unlike the index of GetLine, it identifies a line permanently.
+  */
+  virtual uint32_t Sequence() const = 0;
+
+  /* Sequence number of the oldest line in the buffer. */
+  virtual uint32_t FirstSequence() const = 0;
+
+  /* Get a line by its sequence number.
+  * @return nullptr if the line is not (yet or no longer) in the buffer
+  * @note The text is valid until the next line is added.
+  */
+  virtual const char* GetLineBySequence(uint32_t seq) const = 0;
+
+  /* Writes up to maxCount lines, starting with sequence number seq,
+  * directly from the buffer as "SEQ\tLINE\n".
+  * In LINE '\\', '\n' and '\r' are written as "\\\\", "\\n" and "\\r",
+  * so every line of the output is one log line.
+  * A seq older than the buffer or beyond Sequence() (e.g. after a reboot)
+  * starts with the oldest line.
+  * @return number of written lines
+  */
+  size_t WriteLines(Stream& out, uint32_t seq, size_t maxCount) const
+  {
+    const uint32_t End = Sequence();
+    const uint32_t First = FirstSequence();
+    if(seq - First > End - First)
+      seq = First;
+
+    size_t Count = 0;
+    for(; seq != End && Count < maxCount; ++seq)
+    {
+      const char* pLine = GetLineBySequence(seq);
+      if(pLine == nullptr)
+        continue;
+      out.print(seq);
+      out.write('\t');
+      for(const char* p = pLine; ; ++p)
+      {
+        const char c = *p;
+        if(c != 0 && c != '\\' && c != '\n' && c != '\r')
+          continue;
+        out.write(reinterpret_cast<const uint8_t*>(pLine), p - pLine);
+        if(c == 0)
+          break;
+        out.write('\\');
+        out.write(c == '\n' ? 'n' : c == '\r' ? 'r' : c);
+        pLine = p + 1;
+      }
+      out.write('\n');
+      ++Count;
+    }
+    return Count;
+  }
+
 };
 
 using ILogging_Ptr = std::unique_ptr<ILogging>;
@@ -2095,6 +2219,7 @@ class CLogging : public ILogging
   using Cline = std::array<char, CharsPerLine + 1>;
   std::vector<Cline> mBuffer;
   uint16_t mEndIndex{};
+  uint32_t mSequence{};
   bool mFull{};
   bool mNeedClearLine{};
 
@@ -2163,6 +2288,7 @@ public:
   #pragma region NewLine
   virtual void NewLine() override
   {
+    ++mSequence;
     ++mEndIndex;
     if(mEndIndex >= MaxLines)
     {
@@ -2241,6 +2367,29 @@ public:
   }
   #pragma endregion
 
+  #pragma region Sequence / GetLineBySequence
+  virtual uint32_t Sequence() const override
+  {
+    return mSequence;
+  }
+
+  virtual uint32_t FirstSequence() const override
+  {
+    // when full, the slot at mEndIndex is the line being overwritten
+    return mSequence - (mFull ? MaxLines - 1 : mEndIndex);
+  }
+
+  virtual const char* GetLineBySequence(uint32_t seq) const override
+  {
+    uint32_t First = FirstSequence();
+    uint32_t Count = mSequence - First;
+    if(seq - First >= Count) // also seq < First
+      return nullptr;
+    uint32_t Index = mFull ? (mEndIndex + 1 + seq - First) % MaxLines : seq - First;
+    return mBuffer[Index].data();
+  }
+  #pragma endregion
+
 
 
   //END Public Methods
@@ -2546,10 +2695,9 @@ struct CHtmlWebSiteMenuItem
   */
   const char* URI{};
 
-  /* Pages that are smaller than 10kb must be marked.
-  * @note Important for servers that do not support HTTP1.1 and the page
-  * length must be known before sending. This means that the page
-  * must be completely available in the main memory.  
+  /* Pages that are smaller than 10kb were marked for HTTP1.0 clients.
+  * @note No longer evaluated: pages of any size are streamed, for
+  * HTTP1.0 the length is measured by a first render (see SetVar).
   */
   bool        LowMemoryUsage{};
 
@@ -2559,9 +2707,19 @@ struct CHtmlWebSiteMenuItem
   int           ID{};
   bool          SpecialMenu{};      // Optional: e.g. right justified for "About"
   int           RefreshInterval{};  // Optional: Refresh (reload page) interval in seconds
-  CTextEmitter  CSS;                // Optional: CSS for the website
-  CTextEmitter  JavaScript;         // Optional: JavaScript for the website
+  /* Optional: CSS and JavaScript for the website.
+  * @note Both are sent as separate files, which the browser caches,
+  * and must therefore always produce the same text.
+  * @see CController::PerformAssetRequest
+  */
+  CTextEmitter  CSS;
+  CTextEmitter  JavaScript;
   CTextEmitter  Body;               // The body of the website
+  /* Alternative to Body: the body as one PROGMEM text, e.g. F(R"(...)").
+  * It is parsed once by AddMenuItem and written from the flash,
+  * Body is then not used.
+  */
+  const __FlashStringHelper* BodyText{};
   CGetBool      Visible;            // Optional ability to temporarily hide a menu.
 };
 
@@ -2578,6 +2736,8 @@ struct IHtmlWebSiteBuilder
     const char*   ExText{};
     CTextEmitter  CSS{};
     CTextEmitter  JavaScript{};
+    const char*   CSSURI{};         // Optional: link the style sheet instead of CSS
+    const char*   JavaScriptURI{};  // Optional: link the script instead of JavaScript
     int           RefreshInterval{};
   };
 
@@ -2606,6 +2766,15 @@ struct IHtmlWebSiteBuilder
   virtual void MenuStrip(Stream&, IMenuStripItems&) = 0;
   virtual void Body(Stream&, CTextEmitter) = 0;
 
+  /* Writes the complete style sheet of a page:
+  * own standard styles followed by 'css' (of the menu item).
+  */
+  virtual void StyleSheet(Stream& out, const CTextEmitter& css)
+  {
+    if(css)
+      css(out);
+  }
+
 
 };
 
@@ -2620,13 +2789,120 @@ IHtmlWebSiteBuilder_Ptr CreateHtmlWebSiteBuilder();
 //END WebSite
 #pragma endregion
 
+#pragma region CNameRegistry
+/* Flat table of named values, sorted by name (variables and commands of CController).
+* One array entry per name instead of a tree node plus a String key;
+* lookups are a binary search without allocations.
+* @note Names are copied into a string pool of the registry (blocks of
+*       PoolBlockSize bytes that never move), the caller's name may be a
+*       temporary. Entry names stay valid as long as the registry.
+* @note Adding a name moves the entries, pointers and iterators become invalid.
+*/
+template<typename T>
+class CNameRegistry
+{
+public:
+  struct CEntry
+  {
+    const char* Name;
+    T           Value;
+  };
+  using const_iterator = typename std::vector<CEntry>::const_iterator;
+
+  /* The table grows in steps of this size, not by doubling. */
+  static constexpr size_t GrowBy = 8;
+  /* Names are copied into blocks of this size, a longer name gets its own block. */
+  static constexpr size_t PoolBlockSize = 128;
+
+private:
+  std::vector<CEntry>                          mEntries;
+  std::forward_list<std::unique_ptr<char[]>>   mPool;
+  char*                                        mPoolNext{};
+  size_t                                       mPoolFree{};
+  size_t                                       mPoolSize{};
+
+  typename std::vector<CEntry>::iterator LowerBound(const char* name)
+  {
+    return std::lower_bound(mEntries.begin(), mEntries.end(), name,
+      [](const CEntry& e, const char* n) { return strcmp(e.Name, n) < 0; });
+  }
+
+  const char* CopyName(const char* name)
+  {
+    const size_t Size = strlen(name) + 1;
+    if(Size > mPoolFree)
+    {
+      const size_t Block = std::max(Size, PoolBlockSize);
+      mPool.emplace_front(new char[Block]);
+      mPoolNext = mPool.front().get();
+      mPoolFree = Block;
+      mPoolSize += sizeof(void*) * 2 + Block;
+    }
+    char* Copy = mPoolNext;
+    memcpy(Copy, name, Size);
+    mPoolNext += Size;
+    mPoolFree -= Size;
+    return Copy;
+  }
+
+public:
+  CNameRegistry() = default;
+  CNameRegistry(const CNameRegistry&) = delete;
+  CNameRegistry& operator=(const CNameRegistry&) = delete;
+
+  const_iterator begin() const { return mEntries.begin(); }
+  const_iterator end() const { return mEntries.end(); }
+  size_t size() const { return mEntries.size(); }
+
+  /* Bytes used by the table and the name pool. */
+  size_t MemoryUsage() const
+  {
+    return mEntries.capacity() * sizeof(CEntry) + mPoolSize;
+  }
+
+  const_iterator find(const char* name) const
+  {
+    auto It = const_cast<CNameRegistry*>(this)->LowerBound(name);
+    return (It != mEntries.end() && strcmp(It->Name, name) == 0) ? It : mEntries.end();
+  }
+  const_iterator find(const String& name) const { return find(name.c_str()); }
+
+  /* Get the value of the name, a default value is added if not found.
+  * @param pAdded Optional: true if the name was added.
+  */
+  T& operator()(const char* name, bool* pAdded = nullptr)
+  {
+    auto It = LowerBound(name);
+    bool Added = It == mEntries.end() || strcmp(It->Name, name) != 0;
+    if(Added)
+    {
+      if(mEntries.size() == mEntries.capacity())
+      {
+        size_t Index = It - mEntries.begin();
+        mEntries.reserve(mEntries.size() + GrowBy);
+        It = mEntries.begin() + Index;
+      }
+      It = mEntries.insert(It, CEntry{ CopyName(name), T{} });
+    }
+    if(pAdded)
+      *pAdded = Added;
+    return It->Value;
+  }
+  T& operator()(const String& name, bool* pAdded = nullptr)
+  {
+    return (*this)(name.c_str(), pAdded);
+  }
+};
+
+#pragma endregion
+
 #pragma region CmdAttribute
 /* Attributes for commands (@see CController::InstallCmd)
 */
 enum CmdAttribute
 {
   CmdAttr_None,
-  CmdAttr_FirstSendPage, // Send page before executing the command
+  CmdAttr_FirstSendPage, // Send page before executing the command (deferred, @see CController::Defer)
 };
 
 #pragma endregion
@@ -2641,6 +2917,45 @@ public:
   static constexpr size_t MaxTickerSlots = 8;
   static constexpr size_t MaxOneShotTickerSlots = 5;
 
+  /* Default size of the web output buffer: one TCP segment (MSS 1460 bytes)
+  * @see SetSendBufferSize
+  */
+  static constexpr size_t DefaultSendBufferSize = 1460;
+
+  /* Maximum number of form arguments kept per web request
+  * @see PerformWebServerRequest
+  */
+  static constexpr size_t MaxFormValues = 8;
+
+  /* Server-Sent Events: max. number of "/events" clients, the interval
+  * in which watched variables are checked for changes and the interval
+  * of heartbeats if nothing changed.
+  * @see PerformEventSubscribe
+  */
+  static constexpr size_t   MaxEventSubscribers = 3;
+  static constexpr uint32_t EventCheckIntervalMS = 1000;
+  static constexpr uint32_t EventHeartbeatMS = 15000;
+
+  /* Server-Sent Events: a value up to MaxEventValueSize bytes is rendered
+  * once per check (larger ones twice). Nothing is sent to a client with
+  * less than MinEventWriteSpace bytes free in its send buffer; a client
+  * that stays below for EventStallTimeoutMS is dropped.
+  * @see SendEvents
+  */
+  static constexpr size_t   MaxEventValueSize = 128;
+  static constexpr size_t   MinEventWriteSpace = 256;
+  static constexpr uint32_t EventStallTimeoutMS = 30000;
+
+  /* Max. number of pages and files sent at the same time from Loop.
+  * @see CSendJob
+  */
+  static constexpr size_t MaxSendJobs = 2;
+
+  /* Longest wait of a deferred action for the response to be flushed.
+  * @see Defer
+  */
+  static constexpr uint32_t DeferredFlushTimeoutMS = 2000;
+
   /* Expander for variables (@see SetVar, ExpandVariables)
   */
   using Expander = std::function<CTextEmitter(CInvokerParam)>;
@@ -2655,6 +2970,25 @@ public:
 
   #pragma endregion
 
+  #pragma region CWebMetrics
+  /* Statistics of the sent html pages (@see GetWebMetrics)
+  */
+  struct CWebMetrics
+  {
+    uint32_t Pages{};       // number of sent pages
+    uint32_t Bytes{};       // sum of all pages
+    uint32_t Chunks{};      // sum of all pages
+    uint32_t LastBytes{};
+    uint32_t LastChunks{};
+    uint32_t LastMS{};      // render and send time of the last page
+    uint32_t MaxMS{};
+    uint32_t NotModified{}; // pages answered with 304
+    uint32_t MaxStepUS{};   // longest send step within one Loop (@see CSendJob)
+    uint32_t MaxLoopUS{};   // longest Loop, incl. directly sent pages
+  };
+
+  #pragma endregion
+
   #pragma region CWiFiConnectionCtrl
   struct CWiFiConnectionCtrl
   {
@@ -2680,13 +3014,124 @@ public:
 private:
   struct CMenuStripItems; /* Enumerator for menu items */
 
+  #pragma region CEventSubscriber
+  /* Client of "/events" (@see PerformEventSubscribe)
+  */
+  struct CEventSubscriber
+  {
+    struct CWatch
+    {
+      const char* Name;     // name in mVars
+      String      Arg;      // of "NAME:Arg"
+      uint32_t    Crc{};    // of the last sent value
+      bool        Sent{};
+    };
+
+    WiFiClient          Client;
+    std::vector<CWatch> Vars;
+    bool                Log{};
+    uint32_t            LogSequence{};  // next log line to send
+    uint32_t            LastSendMS{};
+  };
+
+  #pragma endregion
+
+  #pragma region CPageTemplate
+  /* BodyText of a menu item, parsed once by AddMenuItem into literal spans
+  * and variable references. The spans point into the PROGMEM text, the
+  * args of a variable follow its name ("{VarName:Args}").
+  * @see ExpandBody
+  */
+  struct CPageTemplate
+  {
+    static constexpr size_t MaxTokenLength = 127; // of "{VarName:Args}", longer is literal
+
+    struct CToken
+    {
+      uint16_t        Pos{}, Len{};   // span in Text ("{VarName:Args}" for variables)
+      uint8_t         NameLen{};      // 0: literal text
+      const Expander* Func{};         // resolved variable, nullptr if not found
+      const char*     Name{};         // of the resolved variable (in mVars)
+    };
+
+    PGM_P               Text{};       // nullptr: the menu item has no BodyText
+    uint32_t            TextCrc{};
+    std::vector<CToken> Tokens;
+    uint32_t            VarGeneration{};
+
+    void Compile(const CController&, const __FlashStringHelper* text);
+
+    /* Write the text with expanded variables. */
+    void Expand(Stream&, const CController&);
+
+  private:
+    void Resolve(const CController&);
+  };
+
+  /* Expands the variables of a Body emitter while it writes, without
+  * keeping the body text (@see ExpandBody).
+  */
+  class CBodyExpander;
+
+  #pragma endregion
+
+  #pragma region CAssetInfo
+  /* CSS or JavaScript file of a menu item (@see PerformAssetRequest).
+  */
+  struct CAssetInfo
+  {
+    uint32_t  Crc{};    // content version
+    uint32_t  Size{};
+    bool      Valid{};  // measured
+  };
+
+  struct CMenuAssets
+  {
+    CAssetInfo CSS, JavaScript;
+  };
+
+  #pragma endregion
+
+  #pragma region CSendJob
+  /* A page or file that is sent from Loop, one buffer per call,
+  * so that HomeKit is served in between.
+  * The request records the content once into CStreamPieces: the static
+  * text stays in the flash, only the rendered rest is kept on the heap.
+  * Each step copies the next buffer from position Sent, the content is
+  * never rendered again.
+  * @see SendJobStep
+  */
+  struct CSendJob
+  {
+    WiFiClient    Client;
+    CStreamPieces Content;
+    bool          Page{};   // counted in CWebMetrics
+    size_t        Sent{}, Chunks{};
+    uint32_t      StartMS{};
+  };
+
+  #pragma endregion
+
+  #pragma region CPageDeps
+  /* What the page of a menu item depends on, recorded when it is sent.
+  * @see GetPageVersion
+  */
+  struct CPageDeps
+  {
+    uint32_t                  BodyCrc{};  // of the body text before expansion
+    uint8_t                   Renders{};  // with this BodyCrc, counted up to 2
+    std::vector<const char*>  Vars;       // names in mVars
+  };
+
+  #pragma endregion
+
   //END Private Types
   #pragma endregion
 
   #pragma region Private Fields
 private:
-  using CMD_Map = std::map<String, CCmdItem>;
-  using VAR_Map = std::map<String, Expander>;
+  using CMD_Map = CNameRegistry<CCmdItem>;
+  using VAR_Map = CNameRegistry<Expander>;
   using MENU_List = std::list<CHtmlWebSiteMenuItem>;
 
   MENU_List               mMenuItems;
@@ -2696,18 +3141,59 @@ private:
   IHtmlWebSiteBuilder_Ptr mBuilder;
   CWiFiConnection&        mWifiConnection;
   tm                      mBootTimeInfo{};
+  size_t                  mSendBufferSize{ DefaultSendBufferSize };
+  CWebMetrics             mWebMetrics;
+
+  /* Per menu item index, compiled by AddMenuItem. */
+  mutable std::vector<CPageTemplate> mBodyTemplates;
+
+  /* Measured per menu item index, on first use. */
+  mutable std::vector<CMenuAssets> mMenuAssets;
+
+  /* Change counters of the tracked variables (@see TrackVar),
+  * per menu item index the variables of its page.
+  */
+  CNameRegistry<uint32_t>         mVarVersions;
+  CNameRegistry<bool>             mHiddenVars;  // @see HideVar
+  mutable std::vector<CPageDeps>  mPageDeps;
+  uint32_t                        mPageVersionSalt{}; // new ETags after a reboot
+
+  /* Name=value arguments (except CMD) of the current web request.
+  * They are found by TryGetVar and in pages like variables, until the end
+  * of the request; at most MaxFormValues are kept.
+  */
+  struct CFormValue
+  {
+    String Name, Value;
+  };
+  std::vector<CFormValue> mFormValues;
+
+  std::vector<CEventSubscriber> mEventSubscribers;
+  uint32_t                      mLastEventCheckMS{};
+
+  /* @see Defer */
+  struct CDeferredAction
+  {
+    std::function<void()> Action;
+    WiFiClient            Client;   // response to wait for, if connected
+    uint32_t              StartMS{};
+    uint32_t              DelayMS{};
+  };
+  std::vector<CDeferredAction> mDeferredActions;
+
+  std::vector<CSendJob> mSendJobs;
+  std::vector<uint8_t>  mSendJobBuffer;     // while jobs exist
+
+  /* Incremented when a variable is added, resolved references
+  * of CPageTemplate are then looked up again.
+  */
+  uint32_t mVarGeneration{};
 
   /* Selected menu item index.
   * In the range of [0 .. mMenuItems.size()-1]
   */
   int mSelectedMenuIndex{};
 
-  /* Only menus with low memory usage are visible.
-  * @see CHtmlWebSiteMenuItem::LowMemoryUsage
-  * @see SendHtmlPage
-  */
-  bool mOnlyLMUMenusVisible{};
-
   /* Disable all web requests.
   */
   bool mDisableWebRequests{};
@@ -2778,6 +3264,21 @@ public:
   const String& GetFirmwareUpdateURL() const { return mFirmwareUpdateURL; }
   void SetFirmwareUpdateURL(String url) { mFirmwareUpdateURL = std::move(url); }
 
+  /* Get und set the size of the web output buffer.
+  * Page and variable output is collected in this buffer and sent in blocks
+  * of this size instead of one TCP write per template character.
+  * The buffer is allocated for each request only.
+  * @note 0 disables the buffering.
+  * @see DefaultSendBufferSize, GetWebMetrics
+  */
+  size_t GetSendBufferSize() const { return mSendBufferSize; }
+  void SetSendBufferSize(size_t size) { mSendBufferSize = size; }
+
+  /* Get statistics of the sent html pages.
+  * @note Shown on the Device page by the variable WEB_METRICS.
+  */
+  const CWebMetrics& GetWebMetrics() const { return mWebMetrics; }
+
   //END Properties
   #pragma endregion
 
@@ -2794,10 +3295,7 @@ public:
                   .Title = "HomeKit Settings",
                   .MenuName = "Settings",
                   .URI = "/settings",
-                  .Body = []() -> String
-                  {
-                      return F(R"(Html-Body text)");
-                  },
+                  .BodyText = F(R"(Html-Body text)"),
               }
    );
   */
@@ -2865,6 +3363,13 @@ public:
     );
   --or--
     SetVar("VAR", "VAR-Value");
+  * @note Stable render: for HTTP1.0 clients a page is rendered twice, first
+  * to measure the Content-Length, then to send it. Within one request an
+  * expander must return text of the same length, e.g. values with a fixed
+  * number of digits. A shorter second render is padded with spaces, a
+  * longer one is cut (logged as error).
+  * @note Variables are kept in a flat table (@see CNameRegistry); adding a
+  * new one from within an expander or command is not supported.
   */
   CController& SetVar(const char* var, Expander&& expander);
   CController& SetVar(const String& var, Expander&& expander);
@@ -2873,6 +3378,33 @@ public:
 
   #pragma endregion
 
+  #pragma region TrackVar / VarChanged
+  /* Declare that the value of a variable only changes with VarChanged,
+  * e.g. because it depends on its arguments only ({ACTION_BUTTON:..}).
+  * A page whose variables are all tracked gets an ETag and is answered
+  * with 304 while none of them changed, without running any emitter.
+  * Pages with an untracked variable (e.g. {TIME}) are always sent.
+  * Variables set with SetVar(name, content) are tracked.
+  */
+  CController& TrackVar(const char* var);
+
+  /* Increments the change counter of a tracked variable.
+  * @see TrackVar
+  */
+  CController& VarChanged(const char* var);
+
+  #pragma endregion
+
+  #pragma region HideVar
+  /* Leave a variable out of the JSON API "/api/vars": template helpers,
+  * actions, secrets and large or slow values.
+  * Pages and "/var" still expand it.
+  * @see PerformApiVarsRequest
+  */
+  CController& HideVar(const char* var);
+
+  #pragma endregion
+
   #pragma region TryGetVar
   /* Try to get the content of a variable.
   * @param var Name of the variable.
@@ -2884,6 +3416,7 @@ public:
     */
   bool TryGetVar(const char* var, String* pContent, CInvokerParam param = {}) const;
   bool TryGetVar(const String& var, String* pContent, CInvokerParam param = {}) const;
+  bool TryGetVar(const char* var, Stream& out, CInvokerParam param = {}) const;
   bool TryGetVar(const String& var, Stream& out, CInvokerParam param = {}) const;
 
   #pragma endregion
@@ -2903,6 +3436,21 @@ public:
 
   #pragma endregion
 
+  #pragma region Defer
+  /* Run an action later from Loop, instead of blocking the current
+  * request, e.g. a reboot after its page has been sent.
+  * @param delayMS Minimum time before the action runs.
+  * @param afterResponse Also wait until the response of the current web
+  *        request is flushed: acknowledged by the client or the connection
+  *        is closed, at most DeferredFlushTimeoutMS.
+  * @note Actions run even if Loop is called with tickerEnabled = false,
+  *       at most one per Loop; form values of the request are gone by then.
+  * @see CmdAttr_FirstSendPage
+  */
+  CController& Defer(std::function<void()> action, uint32_t delayMS = 0, bool afterResponse = false);
+
+  #pragma endregion
+
   #pragma region DisableWebRequests / EnableWebRequests
 
   void DisableWebRequests() { mDisableWebRequests = true; }
@@ -2936,7 +3484,7 @@ public:
   void ForEachCmdName(F func) const
   {
     for(auto& Item : mCMDs)
-      func(Item.first);
+      func(Item.Name);
   }
 
   /* @param F func: Function to be called for each command: void func(const String& name, const String& content)
@@ -2945,7 +3493,7 @@ public:
   void ForEachVar(F func) const
   {
     for(auto& Item : mVars)
-      func(Item.first, to_string(Item.second(nullptr)));
+      func(Item.Name, to_string(Item.Value(nullptr)));
   }
 
 
@@ -2971,6 +3519,28 @@ public:
   */
   void ExpandVariables(Stream&, const String& _inputText) const;
 
+  /* Expand the variables in the body of the menu item.
+  * Same result as ExpandVariables: a BodyText is written from its
+  * CPageTemplate, a Body emitter through a CBodyExpander.
+  */
+  void ExpandBody(Stream&, const CHtmlWebSiteMenuItem&) const;
+
+  /* Write one variable "{VarName:Args}": the form value, the expanded
+  * variable or, if not found, the text itself.
+  * @param token Zero terminated, changed during the call.
+  * @param func The variable, nullptr if not found.
+  */
+  void ExpandToken(Stream&, char* token, size_t len, size_t nameLen, const Expander* func) const;
+
+  #pragma endregion
+
+  #pragma region FindFormValue
+  /* Find a form value of the current web request (@see mFormValues)
+  * @param len Length of the name, the name needs no terminating zero.
+  * @return nullptr if not found
+  */
+  const String* FindFormValue(const char* name, size_t len) const;
+
   #pragma endregion
 
   #pragma region Debug-Helpers
@@ -3028,6 +3598,84 @@ public:
   void PerformWebServerRequest();
   void PerformWebServerVarRequest();
 
+  /* Handles "/var?batch=A,B,C": the variables are expanded without
+  * arguments and sent as one JSON object {"A":"...","B":"...","C":null},
+  * null for unknown variables.
+  */
+  void PerformWebServerVarBatchRequest(const String& names) const;
+
+  /* Handles "/events?vars=A,B:Arg&log=N", a Server-Sent Events stream:
+  * - "vars": JSON object of the variables whose value has changed,
+  *   checked every EventCheckIntervalMS, all values after subscribing
+  * - "log": each new log line as JSON string, the event id is the
+  *   sequence number of the line (@see ILogging::Sequence), N or
+  *   Last-Event-ID select the first line to send
+  * - comments as heartbeat every EventHeartbeatMS
+  * At most MaxEventSubscribers clients, further ones get a 503 and
+  * fall back to polling (@see WatchVar in ActionUI_JavaScript).
+  */
+  void PerformEventSubscribe();
+  void SendEvents();
+
+  /* Sends the pending events of one client, as much as fits into the free
+  * send buffer of its connection (WiFiClient::availableForWrite), so Loop
+  * never waits for a slow client. The rest follows with the next check.
+  * @return false to drop the client (closed, stalled or a write failed)
+  */
+  bool SendEvents(CEventSubscriber&, uint32_t curTick);
+
+  /* JSON API, values are typed: numbers and true/false as such,
+  * other text as string.
+  * - GET /api/vars           {"NAME":value,...} of all variables except
+  *                           the hidden ones (@see HideVar)
+  * - GET /api/vars/NAME      {"NAME":value}, optional argument "?arg=...",
+  *                           404 for a hidden variable
+  * - POST /api/cmd/NAME      invokes a command, optional argument "arg";
+  *                           {"cmd":"NAME","deferred":false}, deferred
+  *                           for CmdAttr_FirstSendPage (@see Defer)
+  * Unknown names are answered with 404 {"error":"..."}.
+  */
+  void PerformApiVarsRequest() const;
+  void PerformApiVarRequest(const String& name) const;
+  void PerformApiCmdRequest(const String& name);
+
+  /* Sends the JSON text of 'writeJson', streamed in chunks for HTTP/1.1. */
+  void SendJson(int code, const CTextEmitter& writeJson) const;
+
+  /* Runs the first due action of Defer. */
+  void RunDeferredAction(uint32_t curTick);
+
+  /* Sends the headers of the current request with the length of 'content'
+  * and hands the connection over to a CSendJob, which sends the content
+  * step by step.
+  * @param page Counted in CWebMetrics.
+  * @return false if no job is free, the caller sends the content itself
+  */
+  bool StartSendJob(CStreamPieces&& content, bool page, const char* contentType);
+
+  /* Sends the next buffer of one job whose client can take data. */
+  void SendJobStep();
+
+  /* Handles "/asset.css?v=VERSION" and "/asset.js?v=VERSION":
+  * the style sheet (with the standard CSS of the builder) or the
+  * JavaScript of a menu item as file, instead of inlining it in each page.
+  * VERSION is the crc32 of the content, a new firmware therefore gets
+  * new URLs and the browser may keep a file forever
+  * (ETag, Cache-Control: immutable, 304 for If-None-Match).
+  * Menu items with the same JavaScript share one URL.
+  */
+  void PerformAssetRequest(bool javaScript);
+  const CAssetInfo& GetMenuAsset(size_t index, const CHtmlWebSiteMenuItem&, bool javaScript) const;
+  void WriteMenuAsset(Stream&, const CHtmlWebSiteMenuItem&, bool javaScript) const;
+
+  /* Version of the page of the selected menu item, used as ETag.
+  * Combines the change counters of the variables in the body, the
+  * header texts and the menu strip; nothing is rendered.
+  * @return false if the page is not cacheable: not yet sent twice with
+  *         the same body, or an untracked variable is used
+  */
+  bool GetPageVersion(uint32_t& version) const;
+
   #pragma region DispatchWebseverUriRequest
   /* Distributes a web server request, such as "/device" or "/log",
   * by determining the associated menu page and
@@ -3099,6 +3747,17 @@ public:
   * - CLIENT_COUNT
   *   The number of connected clients
   *
+  * - WEB_METRICS
+  *   Sent pages, bytes, chunks and render times (@see GetWebMetrics)
+  *
+  * - REGISTRY_INFO
+  *   Number of variables and commands and the RAM used by their tables
+  *
+  * - RENDER_BENCH:uri
+  *   Renders the body of the menu item 'uri' 50 times with ExpandVariables
+  *   and with ExpandBody and returns the time per render.
+  *   @example /var?RENDER_BENCH=/
+  *
   * - FORM_CMD:cmdName
   *   A button to execute a command
   *   @example {FORM_CMD:REBOOT}
@@ -3153,6 +3812,7 @@ public:
     */
   void SendHtmlPage();
   void SendHtmlPage(Stream&) const;
+  void UpdateWebMetrics(size_t bytes, size_t chunks, uint32_t ms);
 
   #pragma endregion
 
@@ -3165,280 +3825,67 @@ public:
 //END CController
 #pragma endregion
 
-#pragma region CSimpleFileSystem
-/* File system for storing files in the EEPROM.
- * @note This instance cannot allocate on the stack because it is too large.
- * The file system is organized as follows:
- * - The file system is stored in the EEPROM.
- * - Files can only be overwritten with the length they had at creation.
- * - Filename must be 4 characters long.
+#pragma region CEventHistory
+/* Text for the HISTORY_INFO variables: records, sectors and wear of the
+ * store, "RAM only" without a store.
 */
-class CSimpleFileSystem
-{
-  #pragma region Types
-  enum
-  {
-    MaxTableEntries = 16,
-    NameLength = 4,
-    EpromPageSize = 4096, // @see SPI_FLASH_SEC_SIZE
-
-    /* 2024-09-17 HB: May not be #0, otherwise the data will not be stored in the EPROM for unknown reasons. */
-    EpromPage = 1
-  };
-
-  struct CEntry
-  {
-    uint8_t  Name[NameLength];
-    uint16_t StartOffset;
-    uint16_t Size;
-  };
-
-  struct CPage
-  {
-    uint32_t Crc;
-    CEntry   Entries[MaxTableEntries];
-    uint8_t  Memory[EpromPageSize - MaxTableEntries * sizeof(CEntry) - sizeof(uint32_t)];
-  };
-
-  #pragma endregion
-
-  #pragma region Fields
-  CPage     mPage;
-  size_t    mUsedMemorySize{};
-  bool      mWriteBackNeeded{};
-  uint8_t   mModifyCounter{};
+CTextEmitter MakeHistoryInfoEmitter(const CTimeSeriesStore* pStore);
 
-  #pragma endregion
+/* Persistent part of an event recorder (CEventRecorder of Sensor,
+ * Thermostat and HeaterCooler): the events are kept in a CTimeSeriesStore
+ * at the end of the file system area, so the history survives a reboot.
+ * @param TEvent Trivially copyable event with ToString(pBuf, bufLen, time).
+*/
+template<typename TEvent>
+class CEventHistory
+{
+  std::unique_ptr<CTimeSeriesStore> mStore;
 
-  #pragma region Construction
 public:
-  CSimpleFileSystem(const CSimpleFileSystem&) = delete;
-  CSimpleFileSystem& operator=(const CSimpleFileSystem&) = delete;
-  CSimpleFileSystem(CSimpleFileSystem&&) = delete;
-  CSimpleFileSystem& operator=(CSimpleFileSystem&&) = delete;
-
-
-  CSimpleFileSystem()
-  {
-    ReadPageOrFormat();
-  }
-  ~CSimpleFileSystem()
-  {
-    Sync();
-  }
-
-  #pragma endregion
-
-  #pragma region CFileEnumerator
-  class CFileEnumerator
-  {
-    #pragma region Fields
-    const CSimpleFileSystem& mFS;
-    char    mName[NameLength + 1];
-    uint8_t mBeginModifyCounter;
-    int     mIndex = -1;
-
-    #pragma endregion
-
-    #pragma region Construction
-  public:
-    CFileEnumerator(const CSimpleFileSystem& FS)
-      : mFS(FS)
-      , mBeginModifyCounter(FS.mModifyCounter)
-    {
-    }
-
-    #pragma endregion
-
-    #pragma region Next
-    bool Next();
-
-    #pragma endregion
-
-    #pragma region Current
-    const char* Current() const
-    {
-      return mName;
-    }
-
-    #pragma endregion
-
-  };
-
-  //END CFileEnumerator
-  #pragma endregion
-
-  #pragma region Properties
-  /* If checks whether the FS is empty, i.e. no files are noted
-* @return True if the FS is empty.
+  /* Creates the store, nothing if sectorCount is 0.
+   * @see CTimeSeriesStore::MakeInFileSystemArea
   */
-  bool empty() const
+  void Attach(int sectorCount)
   {
-    return mUsedMemorySize == 0;
+    if(sectorCount > 0)
+      mStore = CTimeSeriesStore::MakeInFileSystemArea(sizeof(TEvent), sectorCount);
   }
 
-  #pragma endregion
+  explicit operator bool() const { return mStore != nullptr; }
 
-  #pragma region Public Methods
-
-  #pragma region Files
-  /* Enumerates the files in the file system.
-   * @return The file enumerator.
+  /* @return false if not stored, i.e. no store or the clock is not set.
   */
-  CFileEnumerator Files() const
+  bool Append(const TEvent& event)
   {
-    return CFileEnumerator(*this);
+    return mStore && mStore->Append(time(nullptr), &event);
   }
 
-  #pragma endregion
-
-  #pragma region Sync
-  /* Synchronizes the file system with the EEPROM.
-   * This method is called automatically in the destructor.
-  */
-  void Sync();
-
-  #pragma endregion
-
-  #pragma region Exists
-  /* Checks if a file exists.
-   * @param pName The name of the file.
-   * @return True if the file exists.
+  /* Writes the events of the last 'period' seconds, one per line.
   */
-  bool Exists(const char* pName) const
+  void Emit(Stream& out, time_t period) const
   {
-    return FindEntry(pName) >= 0;
-  }
-
-  #pragma endregion
-
-  #pragma region FileSize
-  /* Gets the size of a file.
-   * @param pName The name of the file.
-   * @return The size of the file or -1 if the file does not exist.
-  */
-  int FileSize(const char* pName) const;
-
-  #pragma endregion
-
-  #pragma region ReadFile
-  /* Reads a file.
-   * @param pName The name of the file.
-   * @param pBuf The buffer to read the file into.
-   * @param Size The size of the buffer. Must be equal to the file size.
-   * @return The number of bytes read or -1 if the file does not exist or the buffer is too small.
-  */
-  int ReadFile(const char* pName, uint8_t* pBuf, int Size);
-
-  #pragma endregion
-
-  #pragma region WriteFile
-  /* Writes or creates a file.
-   * @param pName The name of the file. Must be 4 characters long.
-   * @param pBuf The buffer to write.
-   * @param Size The size of the buffer. Must be equal to the file size if the file already exists.
-   * @return The number of bytes written or -1 if the file system is full.
-  */
-  int WriteFile(const char* pName, const uint8_t* pBuf, int Size);
-
-  #pragma endregion
-
-  #pragma region Format
-  /* Formats the file system.
-  */
-  void Format();
-  #pragma endregion
-
-
-  #pragma region List
-  /* Lists the files in the file system.
-  */
-  void List();
-
-  #pragma endregion
-
-
-  //END Public Methods
-  #pragma endregion
-
-  #pragma region Private Methods
-private:
+    if(!mStore)
+      return;
 
-  /* Touches the file system.
-   * This method is called automatically when a file is modified.
-  */
-  void Touch();
-
-  /* Reads the file system page from the EEPROM.
-   * @return True if the page was read successfully.
-  */
-  bool ReadPage();
-
-  /* Writes the file system page to the EEPROM.
-   * @return True if the page was written successfully.
-  */
-  bool WritePage();
-
-  /* Reads the file system page from the EEPROM or formats the file system if the page is invalid.
-  */
-  void ReadPageOrFormat();
-
-  /* Finds an entry in the file system.
-   * @param pName The name of the file or nullptr to find an empty slot.
-   * @return The index of the entry or -1 if the entry was not found.
-  */
-  int FindEntry(const char* pName = nullptr) const;
-
-  /* Debug prints the file system table.
-  */
-  void DebugPrintTable();
-
-
-
-  //END Private Methods
-  #pragma endregion
-
-};
-
-//END CSimpleFileSystem
-#pragma endregion
-
-#pragma region SimpleFileSystem
-/* Allows the direct call of a method of the CSimpleFileSystem class.
-*/
-struct SimpleFileSystem
-{
-  static void Format()
-  {
-    auto FS = std::make_unique<CSimpleFileSystem>();
-    FS->Format();
-  }
-
-  static int ReadFile(const char* pName, uint8_t* pBuf, int Size)
-  {
-    auto FS = std::make_unique<CSimpleFileSystem>();
-    return FS->ReadFile(pName, pBuf, Size);
-  }
-
-  template<typename T>
-  static bool ReadFile(const char* pName, T& p)
-  {
-    return ReadFile(pName, reinterpret_cast<uint8_t*>(&p), sizeof(T)) == sizeof(T);
-  }
-
-  static int WriteFile(const char* pName, const uint8_t* pBuf, int Size)
-  {
-    auto FS = std::make_unique<CSimpleFileSystem>();
-    return FS->WriteFile(pName, pBuf, Size);
+    char Buf[64];
+    const time_t Now = time(nullptr);
+    mStore->Read(Now - period, Now + 1, [&](time_t time, const uint8_t* pData)
+      {
+        TEvent e;
+        memcpy(&e, pData, sizeof(e));
+        e.ToString(Buf, sizeof(Buf), time);
+        out << Buf << F("\n");
+        return true;
+      });
   }
 
-  template<typename T>
-  static bool WriteFile(const char* pName, const T& p)
+  CTextEmitter InfoEmitter() const
   {
-    return WriteFile(pName, reinterpret_cast<const uint8_t*>(&p), sizeof(T)) == sizeof(T);
+    return MakeHistoryInfoEmitter(mStore.get());
   }
-
 };
+
+//END CEventHistory
 #pragma endregion
 
 #pragma region CArgs
@@ -4338,6 +4785,17 @@ CController& AddDeviceMenu(CController&);
 CController& AddLoggingMenu(CController&);
 #pragma endregion
 
+#pragma region AddCryptoBenchmarkMenu
+/* Add a crypto benchmark menu item to the web site. "/crypto"
+* The page measures SRP, HKDF, ChaCha20-Poly1305, Ed25519, Curve25519
+* and SHA-512 on the device (time per operation, peak stack and heap).
+* @note Not part of AddStandardMenus; the device does not answer
+*       HomeKit requests while the benchmark is running.
+* @see AddMenuItem, crypto_benchmark_run
+*/
+CController& AddCryptoBenchmarkMenu(CController&);
+#pragma endregion
+
 #pragma region AddStandardMenus
 /* Adds standard menu items to the controller.
 * @note The following menu items are added:
@@ -4415,8 +4873,30 @@ CController& InstallActionUI(CController&);
 *   @param varName The name of the variable.
 *   @param functor The function to call when the server response is received.
 *   @note The functor is called with the server response as a parameter.
+*   @note ForVar calls made in the same script run are collected and
+*         fetched by one ForVars request.
 *   @example ForVar("DATE", function(text) { console.log(text); });
 *
+* - ForVars(varNames, functor)
+*   @param varNames Array with the names of the variables.
+*   @param functor The function to call with an object {name: text},
+*          unknown variables are null; on errors the object is null.
+*   @note One "/var?batch=A,B" request, @see CController::PerformWebServerVarBatchRequest
+*   @example ForVars(["DATE", "TIME"], values => console.log(values.DATE));
+*
+* - WatchVar(varName, intervalMS, functor)
+*   @param varName The name of the variable, optional with argument "NAME:Arg".
+*   @param intervalMS Polling interval, if the device cannot push.
+*   @param functor Called with the value text, first with the current value,
+*          then on each change.
+*   @note All watchers of a page share one "/events" connection,
+*         @see CController::PerformEventSubscribe
+*   @example WatchVar("TIME", 1000, text => SetDiv('time', text));
+*
+* - WatchLog(functor, pollFunction)
+*   @param functor Called with each new log line.
+*   @param pollFunction Called every second, if the device cannot push.
+*
 */
 CTextEmitter ActionUI_JavaScript();
 
@@ -19,6 +19,8 @@ namespace
 {
 #pragma endregion
 
+constexpr size_t MaxLinesPerRequest = 20;
+
 #pragma region Log_CCS
 CTextEmitter Log_CCS()
 {
@@ -74,17 +76,28 @@ function AddLogEntry(message)
   }
 }
 
-var LastID = 0;
+var NextSeq = 0;
 function Update()
 {
-  ForSetVar('LOG_MESSAGE', LastID, function(text)
+  ForSetVar('LOG_LINES', NextSeq + ',' + MaxLinesPerRequest, function(text)
     {
-      if(text.length > 0)
-      {
-        AddLogEntry(text);
-        LastID++;
+      var Count = 0;
+      text.split('\n').forEach(entry =>
+        {
+          var Tab = entry.indexOf('\t');
+          if(Tab > 0)
+          {
+            NextSeq = parseInt(entry.substring(0, Tab)) + 1;
+            /* \\, \n and \r are escaped, see ILogging::WriteLines */
+            AddLogEntry(entry.substring(Tab + 1).replace(/\\(.)/g, function(m, c)
+              {
+                return c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+              }));
+            ++Count;
+          }
+        });
+      if(Count == MaxLinesPerRequest)
         Update();
-      }
     });
 }
 
@@ -92,13 +105,8 @@ function Update()
 
 onload = function()
 {
-  Update();
-
-  setInterval
-  (
-    function() { Update(); },
-    1000
-  );
+  // pushed by the device, Update() polls if it cannot
+  WatchLog(AddLogEntry, Update);
 };
 
 
@@ -107,14 +115,14 @@ onload = function()
 #pragma endregion
 
 #pragma region Log_Html
-CTextEmitter Log_Html()
+const __FlashStringHelper* Log_Html()
 {
-  return MakeTextEmitter(F(R"(
+  return F(R"(
   <table id='logtab'>
   <tr><th>Lev.</th><th>UTC Date Time</th><th>Message</th></tr>
 
   </table>
-)"));
+)");
 }
 #pragma endregion
 
@@ -140,6 +148,32 @@ CController& AddLoggingMenu(CController& c)
         }
         return MakeTextEmitter(Result);
       })
+    .HideVar("LOG_MESSAGE")
+
+    #pragma endregion
+
+    #pragma region LOG_LINES
+    /* "N" or "N,K": up to K (max. MaxLinesPerRequest) lines with a sequence
+    * number from N on, one "SEQ\tLINE" per text line.
+    */
+    .SetVar("LOG_LINES", [&](auto p)
+      {
+        uint32_t Seq = 0;
+        size_t Count = MaxLinesPerRequest;
+        if(p.Args[0] != nullptr)
+        {
+          char* pEnd;
+          Seq = strtoul(static_value_cast<const char*>(*p.Args[0]), &pEnd, 10);
+          if(*pEnd == ',')
+            Count = std::min<size_t>(strtoul(pEnd + 1, nullptr, 10), MaxLinesPerRequest);
+        }
+        return [Seq, Count](Stream& out)
+          {
+            if(gbLogging)
+              gbLogging->WriteLines(out, Seq, Count);
+          };
+      })
+    .HideVar("LOG_LINES")
 
     #pragma endregion
 
@@ -159,9 +193,10 @@ CController& AddLoggingMenu(CController& c)
         .JavaScript = [](Stream& out)
           {
             out << ActionUI_JavaScript();
+            out << F("var MaxLinesPerRequest = ") << MaxLinesPerRequest << F(";\n");
             out << Log_JavaScript();
           },
-        .Body = Log_Html()
+        .BodyText = Log_Html()
       }
     )
     //END Menus
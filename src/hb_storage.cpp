@@ -0,0 +1,1292 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>hb_storage.cpp<< 19 Okt 2026  15:20:05 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include "hb_storage.h"
+#include "port.h"
+#ifndef HOMEKIT_FLASH_SIM
+#include <flash_hal.h>
+#endif
+
+namespace HBHomeKit
+{
+#pragma endregion
+
+#pragma region CSimpleFileSystem - Implementation
+#define _PRT(f, ...) //Serial.printf(f, ##__VA_ARGS__)
+
+namespace
+{
+constexpr uint32_t SimpleFileSystemMagic = 0x53464248; // "HBFS"
+
+/* Directory of the single page format of older versions,
+* followed by the file data.
+*/
+struct CLegacyEntry
+{
+  uint8_t  Name[4];
+  uint16_t StartOffset;
+  uint16_t Size;
+};
+
+struct CLegacyHeader
+{
+  uint32_t     Crc;
+  CLegacyEntry Entries[16];
+};
+
+}
+
+#pragma region CFileEnumerator::Next
+bool CSimpleFileSystem::CFileEnumerator::Next()
+{
+  if(mBeginModifyCounter != mFS.mModifyCounter)
+    return false;
+
+  while(++mIndex < MaxTableEntries)
+  {
+    const auto& E = mFS.mEntries[mIndex];
+
+    if(E.Name[0] != 0)
+    {
+      memcpy(mName, E.Name, sizeof(mName));
+      return true;
+    }
+  }
+  return false;
+}
+
+#pragma endregion
+
+#pragma region Properties
+bool CSimpleFileSystem::empty() const
+{
+  for(const auto& E : mEntries)
+  {
+    if(E.Name[0] != 0)
+      return false;
+  }
+  return true;
+}
+
+uint32_t CSimpleFileSystem::MaxEraseCount() const
+{
+  uint32_t Count = 0;
+  for(const auto& P : mPages)
+    Count = std::max(Count, P.EraseCount);
+  return Count;
+}
+
+#pragma endregion
+
+#pragma region Sync
+void CSimpleFileSystem::Sync()
+{
+  if(mWriteBackNeeded)
+  {
+    mWriteBackNeeded = false;
+
+    size_t Size = 0;
+    for(int i = 0; i < MaxTableEntries; ++i)
+    {
+      if(mPending[i].Dirty && CommitFile(i))
+        Size += mEntries[i].Size;
+    }
+    INFO("File system synced: %d bytes", Size);
+    //DebugPrintTable();
+  }
+}
+
+#pragma endregion
+
+#pragma region Loop
+void CSimpleFileSystem::Loop()
+{
+  if(mWriteBackNeeded && millis() - mTouchMS >= mWriteBackDelayMS)
+    Sync();
+}
+
+#pragma endregion
+
+#pragma region FileSize
+int CSimpleFileSystem::FileSize(const char* pName) const
+{
+  int index = FindEntry(pName);
+  if(index < 0)
+    return -1;
+  return mEntries[index].Size;
+}
+
+#pragma endregion
+
+#pragma region ReadFile
+int CSimpleFileSystem::ReadFile(const char* pName, uint8_t* pBuf, int Size)
+{
+  int index = FindEntry(pName);
+  if(index < 0)
+    return -1;
+
+  const auto& E = mEntries[index];
+
+  if(Size != E.Size)
+    return -1;
+
+  if(mPending[index].Dirty)
+    memcpy(pBuf, mPending[index].Data.get(), E.Size);
+  else if(!ReadStored(E, 0, pBuf, E.Size))
+    return -1;
+  return E.Size;
+}
+
+#pragma endregion
+
+#pragma region WriteFile
+int CSimpleFileSystem::WriteFile(const char* pName, const uint8_t* pBuf, int Size)
+{
+  if(pName == nullptr || pName[0] == 0 || strlen(pName) > MaxNameLength)
+  {
+    ERROR("Invalid file name");
+    return -1;
+  }
+  if(Size < 0 || RecordSize(Size) > EpromPageSize - sizeof(CPageHeader))
+  {
+    ERROR("File too large");
+    return -1;
+  }
+
+  bool NewFile = false;
+  int index = FindEntry(pName);
+  if(index < 0)
+  {
+    index = FindEntry(); // find empty slot
+    if(index < 0)
+    {
+      ERROR("No more entry for new files");
+      return -1;
+    }
+    NewFile = true;
+  }
+  else if(mEntries[index].Size == Size)
+  {
+    // unchanged content: nothing to write
+    bool Same = true;
+    if(mPending[index].Dirty)
+    {
+      Same = memcmp(mPending[index].Data.get(), pBuf, Size) == 0;
+    }
+    else
+    {
+      uint8_t Tmp[32];
+      for(int Pos = 0; Same && Pos < Size; Pos += sizeof(Tmp))
+      {
+        int n = std::min<int>(sizeof(Tmp), Size - Pos);
+        Same = ReadStored(mEntries[index], Pos, Tmp, n) && memcmp(Tmp, pBuf + Pos, n) == 0;
+      }
+    }
+    if(Same)
+      return Size;
+  }
+
+  if(!Fits(Size))
+  {
+    ERROR("Not enough memory for file");
+    return -1;
+  }
+
+  INFO("%s #%d \"%s\"  %d bytes"
+    , NewFile ? "CreateFile" : "WriteFile"
+    , index
+    , pName
+    , Size
+  );
+
+  if(!SetPending(index, 0, pBuf, Size))
+    return -1;
+
+  auto& E = mEntries[index];
+  if(NewFile)
+  {
+    strcpy(E.Name, pName);
+    E.Page = NoPage;
+  }
+  E.Size = Size;
+
+  Touch();
+  return Size;
+}
+
+#pragma endregion
+
+#pragma region AppendFile
+int CSimpleFileSystem::AppendFile(const char* pName, const uint8_t* pBuf, int Size)
+{
+  int index = FindEntry(pName);
+  if(index < 0)
+    return WriteFile(pName, pBuf, Size);
+
+  auto& E = mEntries[index];
+  size_t NewSize = E.Size + Size;
+
+  if(Size < 0 || RecordSize(NewSize) > EpromPageSize - sizeof(CPageHeader))
+  {
+    ERROR("File too large");
+    return -1;
+  }
+  if(Size == 0)
+    return E.Size;
+  if(!Fits(NewSize))
+  {
+    ERROR("Not enough memory for file");
+    return -1;
+  }
+
+  INFO("AppendFile #%d \"%s\"  %d bytes", index, pName, Size);
+
+  if(!SetPending(index, E.Size, pBuf, Size))
+    return -1;
+  E.Size = NewSize;
+
+  Touch();
+  return NewSize;
+}
+
+#pragma endregion
+
+#pragma region RemoveFile
+bool CSimpleFileSystem::RemoveFile(const char* pName)
+{
+  int index = FindEntry(pName);
+  if(index < 0)
+    return false;
+
+  INFO("RemoveFile #%d \"%s\"", index, pName);
+
+  auto& E = mEntries[index];
+  ReleaseRecord(E);
+  mPending[index] = {};
+  memset(&E, 0, sizeof(E));
+  ++mModifyCounter;
+  return true;
+}
+
+#pragma endregion
+
+#pragma region List
+/* Lists the files in the file system.
+*/
+void CSimpleFileSystem::List()
+{
+  auto Enum = Files();
+  Serial.println("Files:");
+  while(Enum.Next())
+  {
+    Serial.printf
+    (
+      "\t\"%-15s\"  #%d\n"
+      , Enum.Current()
+      , FileSize(Enum.Current())
+    );
+  }
+  Serial.println();
+}
+
+#pragma endregion
+
+#pragma region Touch
+void CSimpleFileSystem::Touch()
+{
+  ++mModifyCounter;
+  if(!mWriteBackNeeded)
+    mTouchMS = millis();
+  mWriteBackNeeded = true;
+}
+
+#pragma endregion
+
+#pragma region Mount
+void CSimpleFileSystem::Mount()
+{
+  uint32_t Sequences[MaxTableEntries]{};
+  bool AnyValid = false;
+
+  for(int p = 0; p < PageCount; ++p)
+  {
+    MountPage(p, Sequences);
+    AnyValid |= mPages[p].Valid;
+  }
+
+  if(!AnyValid && MigrateLegacyPage())
+    return;
+
+  for(const auto& E : mEntries)
+  {
+    if(E.Name[0] != 0)
+      mPages[E.Page].Live += RecordSize(E.StoredSize);
+  }
+
+  // continue in the newest page
+  for(int p = 0; p < PageCount; ++p)
+  {
+    if(mPages[p].Valid && mPages[p].Generation == mGeneration)
+      mActivePage = p;
+  }
+
+  _PRT("Mount OK, active page %d\n", mActivePage);
+}
+
+#pragma endregion
+
+#pragma region MountPage
+void CSimpleFileSystem::MountPage(int page, uint32_t* sequences)
+{
+  auto& P = mPages[page];
+  P = {};
+  P.Used = EpromPageSize;
+
+  CPageHeader H;
+  if(!homekit_storage_common_read(FirstPage + page, 0, (uint8_t*)&H, sizeof(H))
+    || H.Magic != SimpleFileSystemMagic
+    || H.Crc != crc32(&H, offsetof(CPageHeader, Crc)))
+  {
+    _PRT("MountPage %d: not formatted\n", page);
+    return;
+  }
+  P.Valid = true;
+  P.EraseCount = H.EraseCount;
+  P.Generation = H.Generation;
+  mGeneration = std::max(mGeneration, H.Generation);
+
+  size_t Offset = sizeof(CPageHeader);
+  while(Offset + sizeof(CRecordHeader) <= EpromPageSize)
+  {
+    CRecordHeader R;
+    if(!homekit_storage_common_read(FirstPage + page, Offset, (uint8_t*)&R, sizeof(R)))
+    {
+      Offset = EpromPageSize;
+      break;
+    }
+
+    // end of the records: erased
+    bool Erased = true;
+    for(size_t i = 0; Erased && i < sizeof(R); ++i)
+      Erased = ((const uint8_t*)&R)[i] == 0xff;
+    if(Erased)
+      break;
+
+    // a torn header: do not append behind it
+    size_t RecSize = RecordSize(R.Size);
+    if(R.Size == 0xffff || Offset + RecSize > EpromPageSize)
+    {
+      WARN("File system: invalid record in page %d at %d", page, Offset);
+      Offset = EpromPageSize;
+      break;
+    }
+
+    if(R.State == RecordState_Valid)
+    {
+      uint32_t Crc = HeaderCrc(R);
+      uint8_t Tmp[64];
+      for(size_t Pos = 0; Pos < R.Size; Pos += sizeof(Tmp))
+      {
+        size_t n = std::min<size_t>(sizeof(Tmp), R.Size - Pos);
+        if(!homekit_storage_common_read(FirstPage + page, Offset + sizeof(R) + Pos, Tmp, n))
+          break;
+        Crc = crc32(Tmp, n, Crc);
+      }
+
+      if(Crc != R.Crc || R.Name[0] == 0 || R.Name[MaxNameLength] != 0)
+      {
+        WARN("File system: invalid record in page %d at %d", page, Offset);
+      }
+      else
+      {
+        int index = FindEntry(R.Name);
+        if(index < 0)
+          index = FindEntry();
+
+        if(index < 0)
+        {
+          WARN("File system: no entry for \"%s\"", R.Name);
+        }
+        else
+        {
+          auto& E = mEntries[index];
+          const bool Newer = E.Name[0] == 0
+            || sequences[index] < R.Sequence
+            // a copy made by CompactPage: the newer page wins
+            || (sequences[index] == R.Sequence && mPages[E.Page].Generation < P.Generation);
+
+          // an interrupted commit or copy left two records: retire the older one,
+          // else it would come back once the newer one is removed
+          const uint8_t State = RecordState_Obsolete;
+          if(!Newer)
+          {
+            homekit_storage_common_write(FirstPage + page, Offset + offsetof(CRecordHeader, State), &State, 1);
+          }
+          else
+          {
+            if(E.Name[0] != 0)
+              homekit_storage_common_write(FirstPage + E.Page, E.Offset + offsetof(CRecordHeader, State), &State, 1);
+
+            memcpy(E.Name, R.Name, sizeof(E.Name));
+            E.Page = page;
+            E.Offset = Offset;
+            E.StoredSize = E.Size = R.Size;
+            sequences[index] = R.Sequence;
+          }
+        }
+
+        mSequence = std::max(mSequence, R.Sequence);
+      }
+    }
+
+    Offset += RecSize;
+  }
+
+  P.Used = Offset;
+  _PRT("MountPage %d: %d bytes used\n", page, P.Used);
+}
+
+#pragma endregion
+
+#pragma region MigrateLegacyPage
+bool CSimpleFileSystem::MigrateLegacyPage()
+{
+  CLegacyHeader H;
+  const size_t MaxMemorySize = EpromPageSize - sizeof(CLegacyHeader);
+
+  if(!homekit_storage_legacy_common_read(0, (uint8_t*)&H, sizeof(H))
+    || H.Crc != crc32((const uint8_t*)&H.Entries[0], sizeof(H.Entries)))
+  {
+    return false;
+  }
+
+  for(const auto& L : H.Entries)
+  {
+    if(L.StartOffset + L.Size > MaxMemorySize)
+      return false;
+  }
+
+  INFO("Migrating file system");
+
+  // the old page is only read, the files are written to the first page
+  mActivePage = 0;
+
+  for(const auto& L : H.Entries)
+  {
+    if(L.Name[0] == 0)
+      continue;
+
+    int index = FindEntry();
+    auto& E = mEntries[index];
+    auto& Pd = mPending[index];
+
+    Pd.Data.reset(new (std::nothrow) uint8_t[L.Size]);
+    if(!Pd.Data
+      || !homekit_storage_legacy_common_read(sizeof(H) + L.StartOffset, Pd.Data.get(), L.Size))
+    {
+      ERROR("File system migration failed");
+      Pd = {};
+      continue;
+    }
+    Pd.Dirty = true;
+
+    memcpy(E.Name, L.Name, sizeof(L.Name));
+    E.Page = NoPage;
+    E.Size = L.Size;
+  }
+
+  mWriteBackNeeded = true;
+  Sync();
+  return true;
+}
+
+#pragma endregion
+
+#pragma region FormatPage
+bool CSimpleFileSystem::FormatPage(int page)
+{
+  auto& P = mPages[page];
+
+  CPageHeader H;
+  H.Magic = SimpleFileSystemMagic;
+  H.EraseCount = P.Valid ? P.EraseCount + 1 : 1;
+  H.Generation = ++mGeneration;
+  H.Crc = crc32(&H, offsetof(CPageHeader, Crc));
+
+  P = {};
+  P.Used = EpromPageSize;
+
+  if(!homekit_storage_common_erase(FirstPage + page)
+    || !homekit_storage_common_write(FirstPage + page, 0, (const uint8_t*)&H, sizeof(H)))
+  {
+    return false;
+  }
+
+  P.Used = sizeof(CPageHeader);
+  P.EraseCount = H.EraseCount;
+  P.Generation = H.Generation;
+  P.Valid = true;
+  return true;
+}
+
+#pragma endregion
+
+#pragma region CompactPage
+bool CSimpleFileSystem::CompactPage(int page, int target)
+{
+  auto& P = mPages[page];
+  auto& T = mPages[target];
+
+  if(page != target)
+  {
+    // copy: each record is retired in 'page' after its copy is complete;
+    // the target must be newer than 'page' so that Mount prefers the copies
+    const bool Append = T.Valid && T.Generation > P.Generation && T.Used + P.Live <= EpromPageSize;
+    if(!Append && (!IsEmptyPage(target) || !FormatPage(target)))
+      return false;
+
+    _PRT("CompactPage %d -> %d: %d bytes\n", page, target, P.Live);
+
+    for(auto& E : mEntries)
+    {
+      if(E.Name[0] == 0 || E.Page != page)
+        continue;
+
+      const size_t RecSize = RecordSize(E.StoredSize);
+      uint32_t Tmp[16];
+      for(size_t Pos = 0; Pos < RecSize; Pos += sizeof(Tmp))
+      {
+        size_t n = std::min<size_t>(sizeof(Tmp), RecSize - Pos);
+        if(!homekit_storage_common_read(FirstPage + page, E.Offset + Pos, (uint8_t*)Tmp, n)
+          || !homekit_storage_common_write(FirstPage + target, T.Used + Pos, (const uint8_t*)Tmp, n))
+        {
+          return false;
+        }
+      }
+
+      ReleaseRecord(E);
+      E.Page = target;
+      E.Offset = T.Used;
+      T.Used += RecSize;
+      T.Live += RecSize;
+    }
+    return true;
+  }
+
+  // in place: only if there is no spare page
+  size_t Total = P.Live;
+  std::unique_ptr<uint8_t[]> Buf;
+  if(Total)
+  {
+    Buf.reset(new (std::nothrow) uint8_t[Total]);
+    if(!Buf)
+    {
+      ERROR("Not enough memory to compact the file system");
+      return false;
+    }
+  }
+
+  size_t Pos = 0;
+  for(const auto& E : mEntries)
+  {
+    if(E.Name[0] != 0 && E.Page == page)
+    {
+      size_t RecSize = RecordSize(E.StoredSize);
+      if(!homekit_storage_common_read(FirstPage + page, E.Offset, &Buf[Pos], RecSize))
+        return false;
+      Pos += RecSize;
+    }
+  }
+
+  _PRT("CompactPage %d: %d bytes\n", page, Total);
+
+  if(!FormatPage(page))
+    return false;
+  if(Total && !homekit_storage_common_write(FirstPage + page, sizeof(CPageHeader), Buf.get(), Total))
+    return false;
+
+  Pos = sizeof(CPageHeader);
+  for(auto& E : mEntries)
+  {
+    if(E.Name[0] != 0 && E.Page == page)
+    {
+      E.Offset = Pos;
+      Pos += RecordSize(E.StoredSize);
+    }
+  }
+  P.Used = Pos;
+  P.Live = Total;
+  return true;
+}
+
+#pragma endregion
+
+#pragma region AllocatePage
+int CSimpleFileSystem::AllocatePage(size_t recordSize)
+{
+  for(int Round = 0; Round < PageCount; ++Round)
+  {
+    int EmptyPages = 0;
+    for(int page = 0; page < PageCount; ++page)
+      EmptyPages += IsEmptyPage(page);
+
+    // the active page first; an empty page only if another one remains as spare
+    for(int n = 0; n < PageCount; ++n)
+    {
+      int page = (mActivePage + n) % PageCount;
+      const auto& P = mPages[page];
+      if(P.Valid
+        && P.Used + recordSize <= EpromPageSize
+        && (EmptyPages > 1 || !IsEmptyPage(page)))
+      {
+        mActivePage = page;
+        return page;
+      }
+    }
+
+    // start the next empty page
+    if(EmptyPages > 1)
+    {
+      for(int n = 0; n < PageCount; ++n)
+      {
+        int page = (mActivePage + n) % PageCount;
+        if(IsEmptyPage(page) && FormatPage(page))
+        {
+          mActivePage = page;
+          return page;
+        }
+      }
+      return -1;
+    }
+
+    // copy the oldest page into the spare page
+    int Spare = -1;
+    int Oldest = -1;
+    for(int page = 0; page < PageCount; ++page)
+    {
+      if(IsEmptyPage(page))
+        Spare = page;
+      else if(Oldest < 0 || mPages[page].Generation < mPages[Oldest].Generation)
+        Oldest = page;
+    }
+    if(Oldest < 0)
+      return -1;
+    if(Spare < 0)
+    {
+      // interrupted copy: finish it in a newer page, else compact in place
+      Spare = Oldest;
+      for(int page = 0; page < PageCount; ++page)
+      {
+        const auto& P = mPages[page];
+        if(P.Generation > mPages[Oldest].Generation && P.Used + mPages[Oldest].Live <= EpromPageSize)
+          Spare = page;
+      }
+      if(Spare == Oldest)
+        WARN("File system: no spare page, compacting in place");
+    }
+    if(!CompactPage(Oldest, Spare))
+      return -1;
+    mActivePage = Spare;
+  }
+  return -1;
+}
+
+#pragma endregion
+
+#pragma region CommitFile
+bool CSimpleFileSystem::CommitFile(int index)
+{
+  auto& E = mEntries[index];
+  auto& Pd = mPending[index];
+  const size_t RecSize = RecordSize(E.Size);
+
+  int page = AllocatePage(RecSize);
+  if(page < 0)
+  {
+    ERROR("File system full, \"%s\" not written", E.Name);
+    return false;
+  }
+
+  CRecordHeader H;
+  H.State = RecordState_Valid;
+  H._Reserved = 0xff;
+  H.Size = E.Size;
+  H.Sequence = ++mSequence;
+  memset(H.Name, 0, sizeof(H.Name));
+  strncpy(H.Name, E.Name, MaxNameLength);
+  H.Crc = crc32(Pd.Data.get(), E.Size, HeaderCrc(H));
+
+  auto& P = mPages[page];
+  const size_t Offset = P.Used;
+  P.Used += RecSize;
+
+  if(!homekit_storage_common_write(FirstPage + page, Offset, (const uint8_t*)&H, sizeof(H))
+    || (E.Size && !homekit_storage_common_write(FirstPage + page, Offset + sizeof(H), Pd.Data.get(), E.Size)))
+  {
+    ERROR("Failed to write file \"%s\"", E.Name);
+    return false;
+  }
+
+  ReleaseRecord(E);
+  E.Page = page;
+  E.Offset = Offset;
+  E.StoredSize = E.Size;
+  P.Live += RecSize;
+
+  Pd = {};
+  return true;
+}
+
+#pragma endregion
+
+#pragma region ReleaseRecord
+void CSimpleFileSystem::ReleaseRecord(CEntry& E)
+{
+  if(E.Page == NoPage)
+    return;
+
+  const uint8_t State = RecordState_Obsolete;
+  homekit_storage_common_write(FirstPage + E.Page, E.Offset + offsetof(CRecordHeader, State), &State, 1);
+  mPages[E.Page].Live -= RecordSize(E.StoredSize);
+  E.Page = NoPage;
+}
+
+#pragma endregion
+
+#pragma region Fits
+bool CSimpleFileSystem::Fits(size_t size) const
+{
+  const size_t Room = EpromPageSize - sizeof(CPageHeader);
+
+  size_t Total = RecordSize(size);
+  for(const auto& P : mPages)
+  {
+    if(P.Valid)
+      Total += P.Live;
+  }
+  return Total <= (PageCount - 1) * Room;
+}
+
+#pragma endregion
+
+#pragma region SetPending
+bool CSimpleFileSystem::SetPending(int index, size_t keep, const uint8_t* pBuf, size_t size)
+{
+  auto& Pd = mPending[index];
+  std::unique_ptr<uint8_t[]> Data(new (std::nothrow) uint8_t[keep + size]);
+  if(!Data)
+  {
+    ERROR("Not enough memory for file");
+    return false;
+  }
+
+  if(keep)
+  {
+    if(Pd.Dirty)
+      memcpy(Data.get(), Pd.Data.get(), keep);
+    else if(!ReadStored(mEntries[index], 0, Data.get(), keep))
+      return false;
+  }
+  memcpy(Data.get() + keep, pBuf, size);
+
+  Pd.Data = std::move(Data);
+  Pd.Dirty = true;
+  return true;
+}
+
+#pragma endregion
+
+#pragma region ReadStored
+bool CSimpleFileSystem::ReadStored(const CEntry& E, size_t offset, uint8_t* pBuf, size_t size) const
+{
+  if(E.Page == NoPage)
+    return false;
+  return homekit_storage_common_read(FirstPage + E.Page, E.Offset + sizeof(CRecordHeader) + offset, pBuf, size);
+}
+
+#pragma endregion
+
+#pragma region HeaderCrc
+uint32_t CSimpleFileSystem::HeaderCrc(const CRecordHeader& H)
+{
+  uint32_t Crc = crc32(&H.Size, sizeof(H.Size));
+  Crc = crc32(&H.Sequence, sizeof(H.Sequence), Crc);
+  return crc32(H.Name, sizeof(H.Name), Crc);
+}
+
+#pragma endregion
+
+#pragma region Format
+void CSimpleFileSystem::Format()
+{
+  INFO("Formatting file system");
+  memset(mEntries, 0, sizeof(mEntries));
+  for(auto& Pd : mPending)
+    Pd = {};
+  for(int page = 0; page < PageCount; ++page)
+    FormatPage(page);
+  mActivePage = 0;
+  mWriteBackNeeded = false;
+  ++mModifyCounter;
+}
+
+#pragma endregion
+
+#pragma region FindEntry
+int CSimpleFileSystem::FindEntry(const char* pName) const
+{
+  for(int i = 0; i < MaxTableEntries; ++i)
+  {
+    const auto& E = mEntries[i];
+    if(pName == nullptr ? E.Name[0] == 0 : E.Name[0] != 0 && strncmp(E.Name, pName, sizeof(E.Name)) == 0)
+      return i;
+  }
+  return -1;
+}
+
+#pragma endregion
+
+#pragma region DebugPrintTable
+void CSimpleFileSystem::DebugPrintTable()
+{
+  Serial.printf("(Debug) Table: active page %d\n", mActivePage);
+  for(int i = 0; i < MaxTableEntries; ++i)
+  {
+    const auto& E = mEntries[i];
+    if(E.Name[0] != 0)
+    {
+      Serial.printf
+      (
+        "\t%d: \"%-15s\"  page %d @%d #%d%s\n"
+        , i
+        , E.Name
+        , E.Page
+        , E.Offset
+        , E.Size
+        , mPending[i].Dirty ? " (pending)" : ""
+      );
+    }
+  }
+  for(int page = 0; page < PageCount; ++page)
+  {
+    const auto& P = mPages[page];
+    Serial.printf("\tpage %d: used %d, live %d, erases %d, generation %d%s\n", page, P.Used, P.Live, P.EraseCount, P.Generation, P.Valid ? "" : " (not formatted)");
+  }
+  Serial.println();
+}
+
+#pragma endregion
+
+#pragma region SimpleFileSystem
+namespace
+{
+CSimpleFileSystem* gSharedFileSystem{};
+}
+
+CSimpleFileSystem& SimpleFileSystem::Instance()
+{
+  if(!gSharedFileSystem)
+    gSharedFileSystem = new CSimpleFileSystem();
+  return *gSharedFileSystem;
+}
+
+void SimpleFileSystem::Loop()
+{
+  if(gSharedFileSystem)
+    gSharedFileSystem->Loop();
+}
+
+void SimpleFileSystem::Sync()
+{
+  if(gSharedFileSystem)
+    gSharedFileSystem->Sync();
+}
+
+#pragma endregion
+
+#undef _PRT
+//END CSimpleFileSystem - Implementation
+#pragma endregion
+
+
+#pragma region CTimeSeriesStore - Implementation
+namespace
+{
+constexpr uint32_t TimeSeriesMagic = 0x53544248; // "HBTS"
+
+CTimeSeriesStore* gFirstTimeSeriesStore{};
+}
+
+#pragma region Construction
+CTimeSeriesStore::CTimeSeriesStore(uint16_t recordSize, uint32_t address, uint16_t sectorCount)
+  : mAddress(address)
+  , mSectorCount(std::max<uint16_t>(2, sectorCount))
+  , mRecordSize(std::min<uint16_t>(recordSize, MaxRecordSize))
+  , mStride((sizeof(uint32_t) + mRecordSize + sizeof(uint16_t) + 3) & ~3)
+  , mSlotsPerSector((SectorSize - sizeof(CSectorHeader)) / mStride)
+  , mSectors(new CSectorInfo[mSectorCount]{})
+{
+  if(recordSize > MaxRecordSize)
+    ERROR("History: record size %u too large", recordSize);
+
+  mNext = gFirstTimeSeriesStore;
+  gFirstTimeSeriesStore = this;
+}
+
+CTimeSeriesStore::~CTimeSeriesStore()
+{
+  for(auto** pp = &gFirstTimeSeriesStore; *pp; pp = &(*pp)->mNext)
+  {
+    if(*pp == this)
+    {
+      *pp = mNext;
+      break;
+    }
+  }
+}
+
+std::unique_ptr<CTimeSeriesStore> CTimeSeriesStore::MakeInFileSystemArea(uint16_t recordSize, uint16_t sectorCount)
+{
+  // below the common pages of storage.c, stores in the order of creation
+  #ifdef HOMEKIT_STORAGE_COMMON_ADDR
+  static uint32_t sUsed = 0;
+  #else
+  static uint32_t sUsed = HOMEKIT_STORAGE_COMMON_PAGES * SectorSize;
+  #endif
+
+  const uint32_t Size = sectorCount * SectorSize;
+  if(sectorCount < 2 || FS_PHYS_SIZE < sUsed + Size)
+  {
+    WARN("History: the file system area is too small (%u bytes)", FS_PHYS_SIZE);
+    return nullptr;
+  }
+  const uint32_t Addr = FS_PHYS_ADDR + FS_PHYS_SIZE - sUsed - Size;
+  if(!homekit_storage_fs_area_free(Addr, Size))
+  {
+    ERROR("History: LittleFS covers the sectors at 0x%x, mount it without the last %u sectors",
+      Addr, (FS_PHYS_SIZE - (Addr - FS_PHYS_ADDR)) / SectorSize);
+    return nullptr;
+  }
+  sUsed += Size;
+  return std::unique_ptr<CTimeSeriesStore>(new CTimeSeriesStore(recordSize, Addr, sectorCount));
+}
+
+#pragma endregion
+
+#pragma region SetBufferRecords
+void CTimeSeriesStore::SetBufferRecords(uint16_t count)
+{
+  Flush();
+  mBuffer.reset();
+  mBufferRecords = std::max<uint16_t>(1, count);
+}
+
+#pragma endregion
+
+#pragma region Append
+bool CTimeSeriesStore::Append(time_t time, const void* pData)
+{
+  if(time < MinValidTime)
+    return false;
+
+  if(!mBuffer)
+  {
+    mBuffer.reset(new (std::nothrow) uint32_t[mBufferRecords * mStride / sizeof(uint32_t)]);
+    if(!mBuffer)
+      return false;
+  }
+
+  if(mBuffered >= mBufferRecords)
+  {
+    Flush();
+    if(mBuffered >= mBufferRecords)
+      return false;
+  }
+
+  uint32_t* pSlot = &mBuffer[mBuffered * mStride / sizeof(uint32_t)];
+  memset(pSlot, 0xff, mStride);
+  mLastTime = std::max(mLastTime, static_cast<uint32_t>(time));
+  pSlot[0] = mLastTime;
+  memcpy(pSlot + 1, pData, mRecordSize);
+  const uint16_t Crc = SlotCrc(pSlot);
+  memcpy(reinterpret_cast<uint8_t*>(pSlot + 1) + mRecordSize, &Crc, sizeof(Crc));
+
+  if(mBuffered++ == 0)
+    mFirstBufferedMS = millis();
+  if(mBuffered >= mBufferRecords)
+    Flush();
+  return true;
+}
+
+#pragma endregion
+
+#pragma region Read
+size_t CTimeSeriesStore::Read(time_t from, time_t to, const CReader& reader)
+{
+  if(!mMounted)
+    Mount();
+
+  size_t Count = 0;
+  auto Pass = [&](const uint32_t* pSlot) -> int // -1: stop
+    {
+      if(!IsValidSlot(pSlot) || static_cast<time_t>(pSlot[0]) < from)
+        return 0;
+      if(static_cast<time_t>(pSlot[0]) >= to)
+        return -1;
+      ++Count;
+      return reader(pSlot[0], reinterpret_cast<const uint8_t*>(pSlot + 1)) ? 1 : -1;
+    };
+
+  // the sectors are used as ring, the oldest follows the active one
+  for(int n = 1; mActive >= 0 && n <= mSectorCount; ++n)
+  {
+    const int Sector = (mActive + n) % mSectorCount;
+    const auto& S = mSectors[Sector];
+    if(S.Sequence == 0 || S.Count == 0)
+      continue;
+    if(static_cast<time_t>(S.FirstTime) >= to)
+      return Count;
+
+    const auto& Next = mSectors[NextSector(Sector)];
+    if(Sector != mActive && Next.Sequence == S.Sequence + 1 && Next.Count > 0
+      && static_cast<time_t>(Next.FirstTime) <= from)
+    {
+      continue;
+    }
+
+    // first record >= from
+    uint32_t Chunk[64];
+    int Lo = 0, Hi = S.Count;
+    while(Lo < Hi)
+    {
+      int Mid = (Lo + Hi) / 2;
+      if(ReadSlot(Sector, Mid, Chunk) && static_cast<time_t>(Chunk[0]) < from)
+        Lo = Mid + 1;
+      else
+        Hi = Mid;
+    }
+
+    for(int Slot = Lo; Slot < S.Count; )
+    {
+      const int n = std::min<int>(S.Count - Slot, sizeof(Chunk) / mStride);
+      if(!ReadSlot(Sector, Slot, Chunk, n))
+        break;
+      for(int i = 0; i < n; ++i)
+      {
+        if(Pass(Chunk + i * mStride / sizeof(uint32_t)) < 0)
+          return Count;
+      }
+      Slot += n;
+    }
+  }
+
+  for(int i = 0; i < mBuffered; ++i)
+  {
+    if(Pass(&mBuffer[i * mStride / sizeof(uint32_t)]) < 0)
+      break;
+  }
+  return Count;
+}
+
+#pragma endregion
+
+#pragma region Flush
+void CTimeSeriesStore::Flush()
+{
+  if(mBuffered == 0)
+    return;
+  if(!mMounted)
+    Mount();
+
+  uint16_t Done = 0;
+  while(Done < mBuffered)
+  {
+    if(mActive < 0 || mSectors[mActive].Count >= mSlotsPerSector)
+    {
+      // continue in the oldest sector
+      const int Next = mActive < 0 ? 0 : NextSector(mActive);
+      if(!FormatSector(Next, mActive < 0 ? 1 : mSectors[mActive].Sequence + 1))
+        break;
+      mActive = Next;
+    }
+
+    auto& S = mSectors[mActive];
+    const uint16_t n = std::min<uint16_t>(mBuffered - Done, mSlotsPerSector - S.Count);
+    const uint32_t* pSlots = &mBuffer[Done * mStride / sizeof(uint32_t)];
+    if(!spiflash_write(SlotAddress(mActive, S.Count), const_cast<uint32_t*>(pSlots), n * mStride))
+    {
+      ERROR("History: flash write failed");
+      break;
+    }
+    ++mPrograms;
+    if(S.Count == 0)
+      S.FirstTime = pSlots[0];
+    S.Count += n;
+    Done += n;
+  }
+
+  // keep what could not be written
+  mBuffered -= Done;
+  memmove(mBuffer.get(), &mBuffer[Done * mStride / sizeof(uint32_t)], mBuffered * mStride);
+}
+
+#pragma endregion
+
+#pragma region Loop
+void CTimeSeriesStore::Loop()
+{
+  if(!mMounted)
+    Mount();
+  else if(mBuffered && millis() - mFirstBufferedMS >= mFlushIntervalMS)
+    Flush();
+}
+
+void CTimeSeriesStore::LoopAll()
+{
+  for(auto* p = gFirstTimeSeriesStore; p; p = p->mNext)
+    p->Loop();
+}
+
+#pragma endregion
+
+#pragma region Stats
+CTimeSeriesStore::CStats CTimeSeriesStore::Stats() const
+{
+  CStats St{};
+  St.Buffered = mBuffered;
+  St.Sectors = mSectorCount;
+  St.Programs = mPrograms;
+  St.Erases = mErases;
+  for(int s = 0; s < mSectorCount; ++s)
+  {
+    const auto& S = mSectors[s];
+    if(S.Sequence)
+      St.Records += S.Count;
+    St.MaxEraseCount = std::max(St.MaxEraseCount, S.EraseCount);
+  }
+  return St;
+}
+
+#pragma endregion
+
+#pragma region Mount
+void CTimeSeriesStore::Mount()
+{
+  mMounted = true;
+  mActive = -1;
+
+  uint32_t Slot[(MaxRecordSize + 9) / sizeof(uint32_t)];
+  for(int s = 0; s < mSectorCount; ++s)
+  {
+    auto& S = mSectors[s];
+    CSectorHeader H;
+    S = {};
+    if(!spiflash_read(mAddress + s * SectorSize, reinterpret_cast<uint32_t*>(&H), sizeof(H))
+      || H.Magic != TimeSeriesMagic
+      || H.RecordSize != mRecordSize
+      || H.Crc != static_cast<uint16_t>(crc32(&H, offsetof(CSectorHeader, Crc))))
+    {
+      continue; // not formatted, an interrupted erase or another record size
+    }
+    S.Sequence = H.Sequence;
+    S.EraseCount = H.EraseCount;
+
+    // the records are a prefix of the slots: first erased slot
+    int Lo = 0, Hi = mSlotsPerSector;
+    while(Lo < Hi)
+    {
+      int Mid = (Lo + Hi) / 2;
+      if(ReadSlot(s, Mid, Slot) && IsErasedSlot(Slot))
+        Hi = Mid;
+      else
+        Lo = Mid + 1;
+    }
+    S.Count = Lo;
+
+    if(S.Count > 0)
+    {
+      if(ReadSlot(s, 0, Slot))
+        S.FirstTime = Slot[0];
+      if(ReadSlot(s, S.Count - 1, Slot) && IsValidSlot(Slot))
+        mLastTime = std::max(mLastTime, Slot[0]);
+    }
+    if(mActive < 0 || S.Sequence > mSectors[mActive].Sequence)
+      mActive = s;
+  }
+
+  auto St = Stats();
+  INFO("History: %u records in %u sectors, max. %u erases", St.Records, St.Sectors, St.MaxEraseCount);
+}
+
+#pragma endregion
+
+#pragma region FormatSector
+bool CTimeSeriesStore::FormatSector(int sector, uint32_t sequence)
+{
+  auto& S = mSectors[sector];
+  CSectorHeader H{};
+  H.Magic = TimeSeriesMagic;
+  H.Sequence = sequence;
+  H.EraseCount = S.EraseCount + 1;
+  H.RecordSize = mRecordSize;
+  H.Crc = static_cast<uint16_t>(crc32(&H, offsetof(CSectorHeader, Crc)));
+
+  ++mErases;
+  if(!spiflash_erase_sector(mAddress + sector * SectorSize)
+    || !spiflash_write(mAddress + sector * SectorSize, reinterpret_cast<uint32_t*>(&H), sizeof(H)))
+  {
+    ERROR("History: formatting sector %d failed", sector);
+    S.Sequence = 0;
+    return false;
+  }
+  ++mPrograms;
+  S = { sequence, H.EraseCount, 0, 0 };
+  return true;
+}
+
+#pragma endregion
+
+#pragma region Slots
+bool CTimeSeriesStore::ReadSlot(int sector, int slot, uint32_t* pBuf, int count) const
+{
+  return spiflash_read(SlotAddress(sector, slot), pBuf, count * mStride);
+}
+
+bool CTimeSeriesStore::IsErasedSlot(const uint32_t* pSlot) const
+{
+  for(size_t i = 0; i < mStride / sizeof(uint32_t); ++i)
+  {
+    if(pSlot[i] != 0xffffffff)
+      return false;
+  }
+  return true;
+}
+
+bool CTimeSeriesStore::IsValidSlot(const uint32_t* pSlot) const
+{
+  uint16_t Crc;
+  memcpy(&Crc, reinterpret_cast<const uint8_t*>(pSlot + 1) + mRecordSize, sizeof(Crc));
+  return !IsErasedSlot(pSlot) && Crc == SlotCrc(pSlot);
+}
+
+uint16_t CTimeSeriesStore::SlotCrc(const uint32_t* pSlot) const
+{
+  return static_cast<uint16_t>(crc32(pSlot, sizeof(uint32_t) + mRecordSize));
+}
+
+#pragma endregion
+
+//END CTimeSeriesStore - Implementation
+#pragma endregion
+
+
+
+#pragma region Epilog
+} // namespace HBHomeKit
+#pragma endregion
@@ -0,0 +1,658 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>hb_storage.h<< 19 Okt 2026  15:20:05 - (c) proDAD
+
+CSimpleFileSystem and CTimeSeriesStore, included by hb_homekit.h.
+Depends only on storage.c/port.h, so it also builds on a host with
+-DHOMEKIT_FLASH_SIM (see test/host).
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#pragma once
+
+#ifdef HOMEKIT_FLASH_SIM
+#include "host_shim.h"
+#else
+#include <Arduino.h>
+#endif
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include "homekit_debug.h"
+#include "storage.h"
+
+namespace HBHomeKit
+{
+#pragma endregion
+
+#pragma region CSimpleFileSystem
+/* Small file system for settings, stored in the common pages of storage.c.
+ * @note Use the shared instance SimpleFileSystem::Instance().
+ * The file system is organized as follows:
+ * - The PageCount pages of the common storage area are used, i.e. the last
+ *   sectors of the file system area (see HOMEKIT_STORAGE_COMMON_PAGES).
+ *   Not available if a LittleFS of the sketch covers them.
+ * - Every write appends a new version of the file (record with name, size,
+ *   sequence number and CRC) to a page. The old version is marked obsolete
+ *   by clearing bits, no erase is needed.
+ * - Files can be resized and appended, names have up to 15 characters.
+ * - Only the directory is kept in RAM, files are read directly from the flash.
+ * - One page is kept as spare: when the pages are full, the live files of
+ *   the oldest page are copied into the spare page, which gets a higher
+ *   generation. A record is retired in the old page after its copy is
+ *   complete, so a power loss at any time keeps every file (the copy in the
+ *   newer page wins on mount). The pages are used in rotation to spread the erases.
+ * - Changes are held in RAM until the write-back delay has elapsed (Loop),
+ *   i.e. several writes of a file are committed with one flash write.
+ * - The single page format of older versions (EEPROM+8K) is migrated on
+ *   mount; that sector belongs to the SDK and is never written.
+*/
+class CSimpleFileSystem
+{
+  #pragma region Types
+  enum
+  {
+    MaxTableEntries = 16,
+    MaxNameLength = 15,
+    EpromPageSize = 4096, // @see SPI_FLASH_SEC_SIZE
+
+    FirstPage = 0,
+    PageCount = HOMEKIT_STORAGE_COMMON_PAGES, // one is kept as spare
+
+    NoPage = 0xff,
+    DefaultWriteBackDelayMS = 1000
+  };
+
+  /* Flash layout of a page: CPageHeader, followed by the records.
+   * A record is a CRecordHeader followed by the file data, 4-byte aligned.
+  */
+  struct CPageHeader
+  {
+    uint32_t Magic;
+    uint32_t EraseCount;
+    uint32_t Generation;  // of the format, the newest page wins
+    uint32_t Crc;
+  };
+
+  struct CRecordHeader
+  {
+    uint8_t  State;     // RecordState_...
+    uint8_t  _Reserved;
+    uint16_t Size;
+    uint32_t Sequence;
+    uint32_t Crc;       // Size, Sequence, Name and data
+    char     Name[MaxNameLength + 1];
+  };
+
+  enum : uint8_t
+  {
+    RecordState_Free = 0xff,
+    RecordState_Valid = 0x7f,
+    RecordState_Obsolete = 0x00
+  };
+
+  struct CEntry
+  {
+    char     Name[MaxNameLength + 1]; // empty: unused
+    uint8_t  Page;          // of the stored version or NoPage
+    uint16_t Offset;        // of the record in Page
+    uint16_t StoredSize;    // of the stored version
+    uint16_t Size;          // current size
+  };
+
+  struct CPending
+  {
+    std::unique_ptr<uint8_t[]> Data;
+    bool     Dirty;
+  };
+
+  struct CPageInfo
+  {
+    uint16_t Used;          // end of the records, EpromPageSize if not appendable
+    uint16_t Live;          // bytes of the current records
+    uint32_t EraseCount;
+    uint32_t Generation;
+    bool     Valid;         // formatted
+  };
+
+  #pragma endregion
+
+  #pragma region Fields
+  CEntry    mEntries[MaxTableEntries]{};  // directory
+  CPending  mPending[MaxTableEntries]{};  // not yet written changes
+  CPageInfo mPages[PageCount]{};
+  uint32_t  mSequence{};
+  uint32_t  mGeneration{};
+  uint8_t   mActivePage{};
+  bool      mWriteBackNeeded{};
+  uint8_t   mModifyCounter{};
+  uint32_t  mTouchMS{};
+  uint32_t  mWriteBackDelayMS{ DefaultWriteBackDelayMS };
+
+  #pragma endregion
+
+  #pragma region Construction
+public:
+  CSimpleFileSystem(const CSimpleFileSystem&) = delete;
+  CSimpleFileSystem& operator=(const CSimpleFileSystem&) = delete;
+  CSimpleFileSystem(CSimpleFileSystem&&) = delete;
+  CSimpleFileSystem& operator=(CSimpleFileSystem&&) = delete;
+
+
+  CSimpleFileSystem()
+  {
+    Mount();
+  }
+  ~CSimpleFileSystem()
+  {
+    Sync();
+  }
+
+  #pragma endregion
+
+  #pragma region CFileEnumerator
+  class CFileEnumerator
+  {
+    #pragma region Fields
+    const CSimpleFileSystem& mFS;
+    char    mName[MaxNameLength + 1];
+    uint8_t mBeginModifyCounter;
+    int     mIndex = -1;
+
+    #pragma endregion
+
+    #pragma region Construction
+  public:
+    CFileEnumerator(const CSimpleFileSystem& FS)
+      : mFS(FS)
+      , mBeginModifyCounter(FS.mModifyCounter)
+    {
+    }
+
+    #pragma endregion
+
+    #pragma region Next
+    bool Next();
+
+    #pragma endregion
+
+    #pragma region Current
+    const char* Current() const
+    {
+      return mName;
+    }
+
+    #pragma endregion
+
+  };
+
+  //END CFileEnumerator
+  #pragma endregion
+
+  #pragma region Properties
+  /* If checks whether the FS is empty, i.e. no files are noted
+* @return True if the FS is empty.
+  */
+  bool empty() const;
+
+  /* Gets the number of erases of the most worn page.
+  */
+  uint32_t MaxEraseCount() const;
+
+  #pragma endregion
+
+  #pragma region Public Methods
+
+  #pragma region Files
+  /* Enumerates the files in the file system.
+   * @return The file enumerator.
+  */
+  CFileEnumerator Files() const
+  {
+    return CFileEnumerator(*this);
+  }
+
+  #pragma endregion
+
+  #pragma region Sync
+  /* Synchronizes the file system with the EEPROM.
+   * This method is called automatically in the destructor.
+  */
+  void Sync();
+
+  #pragma endregion
+
+  #pragma region Loop
+  /* Calls Sync() when the write-back delay since the first unsaved change has elapsed.
+  */
+  void Loop();
+
+  #pragma endregion
+
+  #pragma region SetWriteBackDelay
+  /* Sets the time in milliseconds that changes are held in RAM before they are written.
+   * @param ms 0: write on the next Loop() call
+  */
+  void SetWriteBackDelay(uint32_t ms)
+  {
+    mWriteBackDelayMS = ms;
+  }
+
+  #pragma endregion
+
+  #pragma region Exists
+  /* Checks if a file exists.
+   * @param pName The name of the file.
+   * @return True if the file exists.
+  */
+  bool Exists(const char* pName) const
+  {
+    return FindEntry(pName) >= 0;
+  }
+
+  #pragma endregion
+
+  #pragma region FileSize
+  /* Gets the size of a file.
+   * @param pName The name of the file.
+   * @return The size of the file or -1 if the file does not exist.
+  */
+  int FileSize(const char* pName) const;
+
+  #pragma endregion
+
+  #pragma region ReadFile
+  /* Reads a file.
+   * @param pName The name of the file.
+   * @param pBuf The buffer to read the file into.
+   * @param Size The size of the buffer. Must be equal to the file size.
+   * @return The number of bytes read or -1 if the file does not exist or the buffer is too small.
+  */
+  int ReadFile(const char* pName, uint8_t* pBuf, int Size);
+
+  #pragma endregion
+
+  #pragma region WriteFile
+  /* Writes or creates a file. An existing file gets the new size.
+   * @param pName The name of the file, 1 to 15 characters.
+   * @param pBuf The buffer to write.
+   * @param Size The size of the buffer.
+   * @return The number of bytes written or -1 if the file system is full.
+  */
+  int WriteFile(const char* pName, const uint8_t* pBuf, int Size);
+
+  #pragma endregion
+
+  #pragma region AppendFile
+  /* Appends data to a file, creates the file if it does not exist.
+   * @return The new size of the file or -1 if the file system is full.
+  */
+  int AppendFile(const char* pName, const uint8_t* pBuf, int Size);
+
+  #pragma endregion
+
+  #pragma region RemoveFile
+  /* Removes a file.
+   * @return False if the file does not exist.
+  */
+  bool RemoveFile(const char* pName);
+
+  #pragma endregion
+
+  #pragma region Format
+  /* Formats the file system, the pages are erased immediately.
+  */
+  void Format();
+  #pragma endregion
+
+
+  #pragma region List
+  /* Lists the files in the file system.
+  */
+  void List();
+
+  #pragma endregion
+
+
+  //END Public Methods
+  #pragma endregion
+
+  #pragma region Private Methods
+private:
+
+  /* Touches the file system.
+   * This method is called automatically when a file is modified.
+  */
+  void Touch();
+
+  /* Reads the directory from the pages, migrates the old format if needed.
+  */
+  void Mount();
+
+  /* Reads the records of a page into the directory.
+   * @param sequences Sequence numbers of the directory entries found so far.
+  */
+  void MountPage(int page, uint32_t* sequences);
+
+  /* Takes over the files of the single page format of older versions.
+   * @return False if there is no such page.
+  */
+  bool MigrateLegacyPage();
+
+  /* Erases a page and writes its header with a new generation.
+  */
+  bool FormatPage(int page);
+
+  /* Copies the current records of a page into a newer or empty target page.
+   * If page and target are the same, the records are rewritten after the erase.
+  */
+  bool CompactPage(int page, int target);
+
+  /* Finds a page with room for a record, compacts the oldest page if needed.
+   * @return The page or -1 if the file system is full.
+  */
+  int AllocatePage(size_t recordSize);
+
+  /* Checks if a page holds no current record.
+  */
+  bool IsEmptyPage(int page) const
+  {
+    return !mPages[page].Valid || mPages[page].Live == 0;
+  }
+
+  /* Writes the pending data of a file as new record.
+  */
+  bool CommitFile(int index);
+
+  /* Marks the stored version of a file as obsolete.
+  */
+  void ReleaseRecord(CEntry& E);
+
+  /* Checks roughly whether a file of this size fits, one page is kept as spare.
+  */
+  bool Fits(size_t size) const;
+
+  /* Sets the pending data of a file: the first 'keep' bytes of the current content followed by pBuf.
+   * @return False if out of memory.
+  */
+  bool SetPending(int index, size_t keep, const uint8_t* pBuf, size_t size);
+
+  /* Reads data of the stored version of a file.
+  */
+  bool ReadStored(const CEntry& E, size_t offset, uint8_t* pBuf, size_t size) const;
+
+  /* Finds an entry in the file system.
+   * @param pName The name of the file or nullptr to find an empty slot.
+   * @return The index of the entry or -1 if the entry was not found.
+  */
+  int FindEntry(const char* pName = nullptr) const;
+
+  /* Debug prints the file system table.
+  */
+  void DebugPrintTable();
+
+  static size_t RecordSize(size_t size)
+  {
+    return (sizeof(CRecordHeader) + size + 3) & ~3;
+  }
+
+  static uint32_t HeaderCrc(const CRecordHeader& H);
+
+
+
+  //END Private Methods
+  #pragma endregion
+
+};
+
+//END CSimpleFileSystem
+#pragma endregion
+
+#pragma region SimpleFileSystem
+/* Allows the direct call of a method of the shared CSimpleFileSystem instance.
+*/
+struct SimpleFileSystem
+{
+  /* The shared instance, created on the first call.
+  */
+  static CSimpleFileSystem& Instance();
+
+  /* Writes pending changes if the write-back delay has elapsed.
+   * @note Called by CController::Loop
+  */
+  static void Loop();
+
+  /* Writes pending changes now, e.g. before a reboot.
+  */
+  static void Sync();
+
+  static void Format()
+  {
+    Instance().Format();
+    Instance().Loop();
+  }
+
+  static int ReadFile(const char* pName, uint8_t* pBuf, int Size)
+  {
+    return Instance().ReadFile(pName, pBuf, Size);
+  }
+
+  template<typename T>
+  static bool ReadFile(const char* pName, T& p)
+  {
+    return ReadFile(pName, reinterpret_cast<uint8_t*>(&p), sizeof(T)) == sizeof(T);
+  }
+
+  static int WriteFile(const char* pName, const uint8_t* pBuf, int Size)
+  {
+    int Ret = Instance().WriteFile(pName, pBuf, Size);
+    Instance().Loop();
+    return Ret;
+  }
+
+  template<typename T>
+  static bool WriteFile(const char* pName, const T& p)
+  {
+    return WriteFile(pName, reinterpret_cast<const uint8_t*>(&p), sizeof(T)) == sizeof(T);
+  }
+
+  static int AppendFile(const char* pName, const uint8_t* pBuf, int Size)
+  {
+    int Ret = Instance().AppendFile(pName, pBuf, Size);
+    Instance().Loop();
+    return Ret;
+  }
+
+  static bool RemoveFile(const char* pName)
+  {
+    return Instance().RemoveFile(pName);
+  }
+
+};
+#pragma endregion
+
+#pragma region CTimeSeriesStore
+/* Persistent, append-only store of fixed-size records with a time stamp,
+ * e.g. the history of a CEventRecorder.
+ * The store is organized as follows:
+ * - A range of flash sectors is used as ring, each sector starts with a
+ *   header (sequence, erase count) followed by the records.
+ * - Appended records are held in a RAM write buffer and programmed after the
+ *   flush interval or when the buffer is full; a full sector is continued in
+ *   the oldest sector, which is the only erase.
+ * - The time stamps are ascending, so a time range is found by the first
+ *   record of each sector and a binary search within the sector.
+ * - Each record has a CRC, a record torn by a power loss is skipped.
+ * - Nothing is read from the flash before the first Loop (mount), so the
+ *   store does not delay the setup.
+ * @note Records are only accepted if the clock is set (see MinValidTime).
+*/
+class CTimeSeriesStore
+{
+public:
+  #pragma region Types
+  enum : uint32_t
+  {
+    SectorSize = 4096,
+    MaxRecordSize = 32,
+    DefaultBufferRecords = 16,
+    DefaultFlushIntervalMS = 5 * 60 * 1000,
+    MinValidTime = 1577836800, // 2020-01-01
+  };
+
+  /* Counters for the wear reporting.
+  */
+  struct CStats
+  {
+    uint32_t Records;         // stored in the flash
+    uint16_t Buffered;        // not yet written records
+    uint16_t Sectors;
+    uint32_t MaxEraseCount;   // highest erase count of a sector
+    uint32_t Programs;        // page programs since the start
+    uint32_t Erases;          // sector erases since the start
+  };
+
+  /* Called for each record, returns false to stop.
+  */
+  using CReader = std::function<bool(time_t time, const uint8_t* pData)>;
+
+  //END Types
+  #pragma endregion
+
+private:
+  #pragma region Private Types
+  struct CSectorHeader
+  {
+    uint32_t Magic;
+    uint32_t Sequence;
+    uint32_t EraseCount;
+    uint16_t RecordSize;
+    uint16_t Crc;         // of the bytes above
+  };
+
+  struct CSectorInfo
+  {
+    uint32_t Sequence;    // 0: not formatted
+    uint32_t EraseCount;
+    uint32_t FirstTime;   // of the first record
+    uint16_t Count;       // records
+  };
+
+  //END Private Types
+  #pragma endregion
+
+  #pragma region Fields
+  const uint32_t  mAddress;
+  const uint16_t  mSectorCount;
+  const uint16_t  mRecordSize;
+  const uint16_t  mStride;        // record in the flash: time, data, crc
+  const uint16_t  mSlotsPerSector;
+  std::unique_ptr<CSectorInfo[]> mSectors;
+  std::unique_ptr<uint32_t[]> mBuffer; // mBufferRecords * mStride bytes
+  uint16_t        mBufferRecords{ DefaultBufferRecords };
+  uint16_t        mBuffered{};
+  uint32_t        mFirstBufferedMS{};
+  uint32_t        mFlushIntervalMS{ DefaultFlushIntervalMS };
+  uint32_t        mLastTime{};
+  int             mActive{ -1 };  // sector with the newest records
+  bool            mMounted{};
+  uint32_t        mPrograms{};
+  uint32_t        mErases{};
+  CTimeSeriesStore* mNext{};        // see LoopAll
+
+  //END Fields
+  #pragma endregion
+
+public:
+  #pragma region Construction
+  /* @param recordSize Bytes of data per record (max. MaxRecordSize).
+   * @param address Flash address of the first sector (sector aligned).
+   * @param sectorCount At least 2 sectors.
+  */
+  CTimeSeriesStore(uint16_t recordSize, uint32_t address, uint16_t sectorCount);
+  ~CTimeSeriesStore();
+
+  CTimeSeriesStore(const CTimeSeriesStore&) = delete;
+  CTimeSeriesStore& operator=(const CTimeSeriesStore&) = delete;
+
+  /* Creates a store at the end of the file system area (_FS_start.._FS_end),
+   * below the common pages of storage.c and the stores created before.
+   * @note The sketch must not use LittleFS or SPIFFS in these sectors.
+   * @return nullptr if the file system area is too small or a LittleFS
+   *         covers the sectors (homekit_storage_fs_area_free).
+  */
+  static std::unique_ptr<CTimeSeriesStore> MakeInFileSystemArea(uint16_t recordSize, uint16_t sectorCount);
+
+  //END Construction
+  #pragma endregion
+
+  #pragma region Methods
+  /* Sets the interval after which buffered records are written.
+  */
+  void SetFlushInterval(uint32_t ms) { mFlushIntervalMS = ms; }
+
+  /* Sets the number of records of the RAM write buffer.
+  */
+  void SetBufferRecords(uint16_t count);
+
+  /* Appends a record to the write buffer.
+   * A time before the last record is raised to the last time.
+   * @return false if the time is invalid (clock not set).
+  */
+  bool Append(time_t time, const void* pData);
+
+  /* Reads the records with from <= time < to, oldest first,
+   * including the buffered records.
+   * @return The number of records passed to 'reader'.
+  */
+  size_t Read(time_t from, time_t to, const CReader& reader);
+
+  /* Writes the buffered records now.
+  */
+  void Flush();
+
+  /* Mounts the store and flushes after the flush interval.
+  */
+  void Loop();
+
+  CStats Stats() const;
+
+  /* Calls Loop of all stores.
+   * @note Called by CController::Loop
+  */
+  static void LoopAll();
+
+  //END Methods
+  #pragma endregion
+
+private:
+  #pragma region Private Methods
+  void Mount();
+  bool FormatSector(int sector, uint32_t sequence);
+  bool ReadSlot(int sector, int slot, uint32_t* pBuf, int count = 1) const;
+  bool IsErasedSlot(const uint32_t* pSlot) const;
+  bool IsValidSlot(const uint32_t* pSlot) const;
+  uint16_t SlotCrc(const uint32_t* pSlot) const;
+  uint32_t SlotAddress(int sector, int slot) const
+  {
+    return mAddress + sector * SectorSize + sizeof(CSectorHeader) + slot * mStride;
+  }
+  int NextSector(int sector) const { return (sector + 1) % mSectorCount; }
+
+  //END Private Methods
+  #pragma endregion
+
+};
+
+//END CTimeSeriesStore
+#pragma endregion
+
+
+
+#pragma region Epilog
+} // namespace HBHomeKit
+#pragma endregion
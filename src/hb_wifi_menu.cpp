@@ -206,18 +206,18 @@ struct CWifiLoginContext : IPasswordEnumerator
   {
     uint8_t Buf[std::max(MaxSSIDLength, MaxPasswordLength) + 1]; // +1 for null terminator
     char Name[4+1];
-    auto FS = std::make_unique<CSimpleFileSystem>();
+    auto& FS = SimpleFileSystem::Instance();
 
     for(size_t i = 0; i < mItems.size(); ++i)
     {
       memset(Buf, 0, sizeof(Buf));
       snprintf_P(Name, sizeof(Name), PSTR("SSI%d"), i);
-      if(FS->ReadFile(Name, Buf, MaxSSIDLength) > 0)
+      if(FS.ReadFile(Name, Buf, MaxSSIDLength) > 0)
         mItems[i].SSID = (const char*)Buf;
 
       memset(Buf, 0, sizeof(Buf));
       snprintf_P(Name, sizeof(Name), PSTR("PAS%d"), i);
-      if(FS->ReadFile(Name, Buf, MaxPasswordLength) > 0)
+      if(FS.ReadFile(Name, Buf, MaxPasswordLength) > 0)
         mItems[i].Password = (const char*)Buf;
 
       //Serial.printf("SSID: \"%.50s\"  Password: \"%.50s\"\n", mItems[i].SSID.c_str(), mItems[i].Password.c_str());
@@ -233,20 +233,23 @@ struct CWifiLoginContext : IPasswordEnumerator
   {
     uint8_t Buf[std::max(MaxSSIDLength, MaxPasswordLength) + 1]; // +1 for the null terminator
     char Name[4+1];
-    auto FS = std::make_unique<CSimpleFileSystem>();
+    auto& FS = SimpleFileSystem::Instance();
 
     for(size_t i = 0; i < mItems.size(); ++i)
     {
       memset(Buf, 0, sizeof(Buf));
       strncpy((char*)Buf, mItems[i].SSID.c_str(), MaxSSIDLength);
       snprintf_P(Name, sizeof(Name), PSTR("SSI%d"), i);
-      FS->WriteFile(Name, Buf, MaxSSIDLength);
+      FS.WriteFile(Name, Buf, MaxSSIDLength);
 
       memset(Buf, 0, sizeof(Buf));
       strncpy((char*)Buf, mItems[i].Password.c_str(), MaxPasswordLength);
       snprintf_P(Name, sizeof(Name), PSTR("PAS%d"), i);
-      FS->WriteFile(Name, Buf, MaxPasswordLength);
+      FS.WriteFile(Name, Buf, MaxPasswordLength);
     }
+
+    // the login is needed after a restart
+    FS.Sync();
   }
 
   #pragma endregion
@@ -320,6 +323,7 @@ CController& AddWiFiLoginMenu(CController& c, bool alwaysUsePeristentLogin)
         }
         return MakeTextEmitter(std::move(Pass));
       })
+    .HideVar("WLOGIN_PASSWORD")
 
     #pragma endregion
     #pragma region WIFI_LIST
@@ -329,6 +333,7 @@ CController& AddWiFiLoginMenu(CController& c, bool alwaysUsePeristentLogin)
       {
         return MakeTextEmitter(CreateHtmlWifiTable());
       })
+    .HideVar("WIFI_LIST")
 
     #pragma endregion
 
@@ -429,7 +434,7 @@ CController& AddWiFiLoginMenu(CController& c, bool alwaysUsePeristentLogin)
   background-color: #640;
 }
 )")),
-        .Body = MakeTextEmitter(F(R"(
+        .BodyText = F(R"(
 {FORM_BEGIN}
 
 {WIFI_LIST}
@@ -437,7 +442,7 @@ CController& AddWiFiLoginMenu(CController& c, bool alwaysUsePeristentLogin)
 {FORM_CMD:REFRESH}
 
 {FORM_END}
-)")),
+)"),
       }
     )
 
@@ -457,14 +462,14 @@ input[type="text"] {
   margin: 0.2em;
 }
 )")),
-        .Body = MakeTextEmitter(F(R"(
+        .BodyText = F(R"(
 {FORM_BEGIN}
 <p>Enter Password for {WLOGIN_SSID}</p>
 <input type="text" name="WLOGIN_PASSWORD" value="{WLOGIN_PASSWORD}"/>
 {FORM_CMD:LOGIN}
 
 {FORM_END}
-)")),
+)"),
       .Visible = []() -> bool { return false; } // hide this menu; not visible in the menu-bar
       }
     )
@@ -11,7 +11,11 @@ $DAT >>homekit_debug.h<< 30 Sep 2024  07:07:34 - (c) proDAD
 #pragma region Includes
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef HOMEKIT_FLASH_SIM
+#include "host_shim.h"
+#else
 #include "Arduino.h"
+#endif
 #include <string.h>
 #include <esp_xpgm.h>
 
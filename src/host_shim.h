@@ -0,0 +1,92 @@
+#pragma region Prolog
+#ifndef __HOST_SHIM_H__
+#define __HOST_SHIM_H__
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>host_shim.h<< 19 Okt 2026  15:12:40 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+
+/* Replaces Arduino.h, pgmspace.h and osapi.h in host builds (-DHOMEKIT_FLASH_SIM),
+* only the parts used by storage.c, crypto.c, wolfcrypt and hb_storage.cpp.
+* PROGMEM data is plain RAM on a host, the *_P functions map to the libc ones.
+* The functions declared here are implemented by the host test target
+* (test/host/host_support.c).
+*/
+#ifdef HOMEKIT_FLASH_SIM
+#pragma region Includes
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#pragma endregion
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma region pgmspace.h
+#define PROGMEM
+#define ICACHE_RODATA_ATTR
+#define PGM_P const char*
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strncpy_P strncpy
+#define printf_P printf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+#pragma endregion
+
+#pragma region Arduino.h / osapi.h
+static inline uint32_t millis(void)
+{
+  struct timespec T;
+  clock_gettime(CLOCK_MONOTONIC, &T);
+  return (uint32_t)(T.tv_sec * 1000 + T.tv_nsec / 1000000);
+}
+
+static inline uint32_t micros(void)
+{
+  struct timespec T;
+  clock_gettime(CLOCK_MONOTONIC, &T);
+  return (uint32_t)(T.tv_sec * 1000000 + T.tv_nsec / 1000);
+}
+
+uint32_t system_get_free_heap_size(void);
+int os_get_random(unsigned char* buf, size_t len);
+
+#pragma endregion
+
+#ifdef __cplusplus
+}
+
+#pragma region coredecls.h / Serial
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0xffffffff);
+
+struct CHostSerial
+{
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t println(const char* text = "");
+};
+extern CHostSerial Serial;
+
+#pragma endregion
+#endif
+
+#endif // HOMEKIT_FLASH_SIM
+
+#pragma region Epilog
+#endif // __HOST_SHIM_H__
+
+#pragma endregion
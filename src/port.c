@@ -37,6 +37,12 @@ void homekit_overclock_end()
   sdk_system_restoreclock();
 }
 
+size_t homekit_free_stack()
+{
+  // task stack is not tracked here
+  return 0;
+}
+
 static char mdns_instance_name[65] = { 0 };
 static char mdns_txt_rec[128] = { 0 };
 static int mdns_port = 80;
@@ -121,6 +127,19 @@ void homekit_overclock_end()
 {
   //ets_update_cpu_frequency(ticks_per_us);
 }
+
+#include <cont.h>
+extern cont_t* g_pcont;
+
+size_t homekit_free_stack()
+{
+  // HomeKit runs on the cont (loop) stack; elsewhere the value is unknown
+  char here;
+  uintptr_t bottom = (uintptr_t)&g_pcont->stack[0];
+  uintptr_t top = (uintptr_t)&g_pcont->stack[CONT_STACKSIZE / 4];
+  uintptr_t sp = (uintptr_t)&here;
+  return (sp > bottom && sp < top) ? sp - bottom : 0;
+}
 /*
 void homekit_mdns_init()
 {
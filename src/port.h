@@ -13,6 +13,9 @@ void homekit_system_restart();
 void homekit_overclock_start();
 void homekit_overclock_end();
 
+// Free stack below the caller (0 if unknown)
+size_t homekit_free_stack();
+
 #ifdef ESP_OPEN_RTOS
 #include <spiflash.h>
 #define ESP_OK 0
@@ -22,7 +25,14 @@ void homekit_overclock_end();
 //#include <esp_system.h>
 //#include <esp_spi_flash.h>
 
-#ifdef ARDUINO_ARCH_ESP8266
+#if defined(HOMEKIT_FLASH_SIM)
+// host build, see flash_sim.h
+#include "flash_sim.h"
+#define spiflash_read(addr, buffer, size) homekit_flash_sim_read((addr), (buffer), (size))
+#define spiflash_write(addr, data, size) homekit_flash_sim_write((addr), (data), (size))
+#define spiflash_erase_sector(addr) homekit_flash_sim_erase_sector(addr)
+
+#elif defined(ARDUINO_ARCH_ESP8266)
 #include "Arduino.h"
 #include <spi_flash.h>
 #include <ets_sys.h>
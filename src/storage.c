@@ -8,6 +8,7 @@ $DAT >>storage.c<< 13 Okt 2024  09:29:23 - (c) proDAD
 #pragma endregion
 #pragma region Includes
 #include <string.h>
+#include <stddef.h>
 #include <ctype.h>
 #include "constants.h"
 #include "pairing.h"
@@ -38,13 +39,26 @@ $DAT >>storage.c<< 13 Okt 2024  09:29:23 - (c) proDAD
 // We use the EEPROM address for this storage.c in Arduino environment
 // EEPROM = one SPI_FLASH_SEC_SIZE = 0x1000 = 4096B
 // SPI_FLASH_SEC_SIZE = 4096B
-// sizeof(pairing_data_t) = 80B
-// MAX_PAIRINGS = 16
-// PAIRINGS_OFFSET = 128(address)
-// so max use address of (128 + 80 * 16) = 1408 B
 
-// This storage use [0, 1408) of EEPROM, leave [1408, 4096) for user to use safely.
-// Leave the FS(file system) for user to use freely.
+// The accessory ID, the accessory key and the pairings are stored as an
+// append-only log (see "pairing log"). The log uses the EEPROM sector and
+// the unused sectors between the end of the file system and the EEPROM
+// (e.g. one sector with the 4M/2M and 4M/3M layouts); without such a
+// sector the log is rewritten in the EEPROM sector.
+// Older versions used a fixed layout in the EEPROM sector:
+// magic(0) accessory-ID(4) accessory-key(32) 16 pairings of 80B (128)
+// which is migrated by homekit_storage_init.
+
+// The common area (CSimpleFileSystem) uses the last HOMEKIT_STORAGE_COMMON_PAGES
+// sectors of the file system area, or the sectors at HOMEKIT_STORAGE_COMMON_ADDR
+// if the sketch defines it. The sectors above the EEPROM belong to the
+// SDK (RF calibration, WiFi config). Older versions used the sector at
+// EEPROM+8K, which is only read to migrate it (homekit_storage_legacy_common_read).
+// Before the first access the LittleFS superblock at the start of the file
+// system area is checked: if the sketch formatted a LittleFS that covers the
+// common pages, they are not used (error log) instead of destroying each
+// other. A sketch with LittleFS mounts it smaller (see README).
+// Leave the rest of the FS(file system) for user to use freely.
 
 /*
 
@@ -59,6 +73,12 @@ The following diagram illustrates flash layout used in Arduino environment:
 ^              ^       ^               ^     ^
 Sketch    OTA update   File system   EEPROM  WiFi config (SDK)
 
+With this library (e.g. 4MB (FS:2MB OTA:~1019KB)):
+
+File system: |  LittleFS of the sketch  | history stores | common pages |
+_FS_end .. EEPROM: free sectors, pairing log
+EEPROM: pairing log
+
 */
 
 #pragma endregion
@@ -66,17 +86,28 @@ Sketch    OTA update   File system   EEPROM  WiFi config (SDK)
 #pragma region Definitions
 #pragma GCC diagnostic ignored "-Wunused-value"
 
-// These two values are provided in tools/sdk/ld/eagle.flash.**.ld
+#ifdef HOMEKIT_FLASH_SIM
+#define HOMEKIT_EEPROM_PHYS_ADDR HOMEKIT_FLASH_SIM_EEPROM_ADDR
+#define HOMEKIT_FS_START_PHYS_ADDR FS_PHYS_ADDR
+#define HOMEKIT_FS_END_PHYS_ADDR HOMEKIT_FLASH_SIM_FS_END_ADDR
+#else
+// These values are provided in tools/sdk/ld/eagle.flash.**.ld
 extern uint32_t _EEPROM_start; //See EEPROM.cpp
 extern uint32_t _SPIFFS_start; //See spiffs_api.h
+extern uint32_t _FS_start;     //See flash_hal.h
+extern uint32_t _FS_end;       //See flash_hal.h
 
 #define HOMEKIT_EEPROM_PHYS_ADDR ((uint32_t) (&_EEPROM_start) - 0x40200000)
 #define HOMEKIT_SPIFFS_PHYS_ADDR ((uint32_t) (&_SPIFFS_start) - 0x40200000)
+#define HOMEKIT_FS_START_PHYS_ADDR ((uint32_t) (&_FS_start) - 0x40200000)
+#define HOMEKIT_FS_END_PHYS_ADDR ((uint32_t) (&_FS_end) - 0x40200000)
+#endif
 
 //#ifndef SPIFLASH_BASE_ADDR
 #define STORAGE_BASE_ADDR     HOMEKIT_EEPROM_PHYS_ADDR
 //#endif
 
+// Legacy layout, read by log_migrate_legacy only
 #define MAGIC_OFFSET           0
 #define ACCESSORY_ID_OFFSET    4
 #define ACCESSORY_KEY_OFFSET   32
@@ -87,11 +118,20 @@ extern uint32_t _SPIFFS_start; //See spiffs_api.h
 #define ACCESSORY_KEY_ADDR   (STORAGE_BASE_ADDR + ACCESSORY_KEY_OFFSET)
 #define PAIRINGS_ADDR        (STORAGE_BASE_ADDR + PAIRINGS_OFFSET)
 
-// This storage use [0, 1408) of EEPROM, leave [1408, 4096) for user to use safely.
-//#define COMMON_BEGIN_ADDR   (STORAGE_BASE_ADDR + 1408)
-#define COMMON_BEGIN_ADDR   (STORAGE_BASE_ADDR + SPI_FLASH_SEC_SIZE)
-#define COMMON_PAGE_COUNT   4
+#define COMMON_PAGE_COUNT   HOMEKIT_STORAGE_COMMON_PAGES
+#ifdef HOMEKIT_STORAGE_COMMON_ADDR
+#define COMMON_BEGIN_ADDR   (HOMEKIT_STORAGE_COMMON_ADDR)
+#else
+#define COMMON_BEGIN_ADDR   (HOMEKIT_FS_END_PHYS_ADDR - COMMON_PAGE_COUNT * SPI_FLASH_SEC_SIZE)
+#endif
+#define LFS_MAGIC_OFFSET        8
+#define LFS_BLOCK_SIZE_OFFSET   24
+#define LFS_BLOCK_COUNT_OFFSET  28
+#define LEGACY_COMMON_ADDR  (STORAGE_BASE_ADDR + 2 * SPI_FLASH_SEC_SIZE)
 
+// Pairing log: EEPROM sector and the free sectors below it
+#define LOG_MAX_SECTORS     4
+#define LOG_SECTOR_ADDR(i)  (STORAGE_BASE_ADDR - (i) * SPI_FLASH_SEC_SIZE)
 
 
 #define MAX_PAIRINGS 16
@@ -101,6 +141,38 @@ extern uint32_t _SPIFFS_start; //See spiffs_api.h
 #define STORAGE_DEBUG(message, ...) //printf("*** [Storage] %s: " message "\n", __func__, ##__VA_ARGS__)
 
 const char magic1[] = "HAP";
+const char log_magic[4] = { 'H', 'A', 'P', 'L' };
+
+#pragma endregion
+
+#pragma region flash access
+/*
+* All flash operations of this file pass through here and are counted.
+* @see homekit_storage_get_stats
+*/
+static homekit_storage_stats_t storage_stats;
+
+// common pages: -1 not checked yet (again after homekit_storage_init), 0 unavailable, 1 available
+static int common_state = -1;
+
+static bool storage_flash_read(uint32_t addr, void* buffer, size_t size)
+{
+  storage_stats.reads++;
+  return spiflash_read(addr, (byte*)buffer, size);
+}
+
+static bool storage_flash_write(uint32_t addr, const void* data, size_t size)
+{
+  storage_stats.writes++;
+  storage_stats.bytes_written += size;
+  return spiflash_write(addr, (const byte*)data, size);
+}
+
+static bool storage_flash_erase(uint32_t addr)
+{
+  storage_stats.erases++;
+  return spiflash_erase_sector(addr);
+}
 
 #pragma endregion
 
@@ -118,6 +190,498 @@ typedef struct
 
 #pragma endregion
 
+#pragma region pairing index
+/*
+* RAM copy of the stored pairings, loaded by homekit_storage_init.
+* All pairing reads are served from here, changes are appended to the log.
+* The controller public key is also kept uncompressed (verify_cache),
+* created by the first pair-verify of that controller, so that later
+* connections do not decompress it again.
+*/
+typedef struct
+{
+  uint32_t device_id_hash;
+  byte used;
+  byte permissions;
+  char device_id[DEVICE_ID_SIZE];
+  byte device_public_key[32];
+  ed25519_verify_cache* verify_cache;
+} pairing_index_entry_t;
+
+static pairing_index_entry_t pairing_index[MAX_PAIRINGS];
+
+static uint32_t device_id_hash(const char* device_id)
+{
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for(int i = 0; i < DEVICE_ID_SIZE && device_id[i]; i++)
+    hash = (hash ^ (byte)device_id[i]) * 16777619u;
+  return hash;
+}
+
+static void pairing_index_remove(int slot)
+{
+  crypto_ed25519_verify_cache_free(pairing_index[slot].verify_cache);
+  memset(&pairing_index[slot], 0, sizeof(pairing_index[slot]));
+}
+
+static void pairing_index_clear()
+{
+  for(int i = 0; i < MAX_PAIRINGS; i++)
+    pairing_index_remove(i);
+}
+
+static void pairing_index_set(int slot, const pairing_data_t* data)
+{
+  pairing_index_entry_t* entry = &pairing_index[slot];
+  pairing_index_remove(slot);
+
+  entry->used = true;
+  entry->permissions = data->permissions;
+  memcpy(entry->device_id, data->device_id, sizeof(entry->device_id));
+  memcpy(entry->device_public_key, data->device_public_key, sizeof(entry->device_public_key));
+  entry->device_id_hash = device_id_hash(entry->device_id);
+}
+
+static void pairing_index_get_data(int slot, pairing_data_t* data)
+{
+  const pairing_index_entry_t* entry = &pairing_index[slot];
+
+  memset(data, 0, sizeof(*data));
+  strncpy(data->magic, magic1, sizeof(data->magic));
+  data->permissions = entry->permissions;
+  memcpy(data->device_id, entry->device_id, sizeof(data->device_id));
+  memcpy(data->device_public_key, entry->device_public_key, sizeof(data->device_public_key));
+}
+
+static int pairing_index_find(const char* device_id)
+{
+  uint32_t hash = device_id_hash(device_id);
+  for(int i = 0; i < MAX_PAIRINGS; i++)
+  {
+    const pairing_index_entry_t* entry = &pairing_index[i];
+    if(entry->used
+      && entry->device_id_hash == hash
+      && !strncmp(entry->device_id, device_id, sizeof(entry->device_id)))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int pairing_index_get(int slot, pairing_t* pairing)
+{
+  const pairing_index_entry_t* entry = &pairing_index[slot];
+
+  crypto_ed25519_init(&pairing->device_key);
+  int r = crypto_ed25519_import_public_key(&pairing->device_key, entry->device_public_key, sizeof(entry->device_public_key));
+  if(r)
+  {
+    ERROR("Failed to import device public key (code %d)", r);
+    return -2;
+  }
+
+  pairing->id = slot;
+  memcpy(pairing->device_id, entry->device_id, DEVICE_ID_SIZE);
+  pairing->device_id[DEVICE_ID_SIZE] = 0;
+  pairing->permissions = entry->permissions;
+  return 0;
+}
+
+#pragma endregion
+
+#pragma region pairing log
+/*
+* Each log sector starts with a log_sector_header_t followed by records
+* (4 byte aligned) up to the erased space. Records are never modified;
+* a newer record of the same kind (accessory ID, accessory key, pairing
+* slot) replaces the older one.
+* When the active sector is full, the live data is written to the next
+* sector (garbage collection) and its header is written last, so an
+* interrupted collection leaves the previous sector active.
+* The valid sector with the highest sequence is the active one.
+*/
+typedef struct
+{
+  char     magic[4];
+  uint32_t sequence;
+  uint32_t crc;
+  uint32_t _reserved;
+} log_sector_header_t;
+
+typedef enum
+{
+  LOG_RECORD_ACCESSORY_ID = 1,
+  LOG_RECORD_ACCESSORY_KEY = 2,
+  LOG_RECORD_PAIRING = 3,         // slot: pairing index, data: pairing_data_t
+  LOG_RECORD_PAIRING_REMOVED = 4, // slot: pairing index, no data
+  LOG_RECORD_FREE = 0xff,         // erased flash
+} log_record_type_t;
+
+typedef struct
+{
+  byte     type;
+  byte     slot;
+  uint16_t size;      // of data
+  uint32_t sequence;
+  uint32_t crc;       // of type..sequence and data
+} log_record_header_t;
+
+typedef struct
+{
+  log_record_header_t header;
+  byte data[sizeof(pairing_data_t)];
+} log_record_t;
+
+#define LOG_RECORD_SIZE(data_size) (sizeof(log_record_header_t) + (((data_size) + 3) & ~3))
+
+static uint32_t log_sectors[LOG_MAX_SECTORS];
+static int      log_sector_count = 0;
+static int      log_active = -1;         // index in log_sectors
+static bool     log_legacy = false;      // active sector has the legacy layout
+static uint32_t log_sequence = 0;        // last used sequence
+static uint16_t log_end = 0;             // append offset in the active sector
+static uint16_t log_accessory_id_offset = 0;  // 0: none
+static uint16_t log_accessory_key_offset = 0;
+
+static uint32_t log_crc32(uint32_t crc, const void* data, size_t size)
+{
+  const byte* p = (const byte*)data;
+  while(size--)
+  {
+    crc ^= *p++;
+    for(int i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+  }
+  return crc;
+}
+
+static uint32_t log_record_crc(const log_record_t* record)
+{
+  uint32_t crc = log_crc32(0xffffffff, &record->header, offsetof(log_record_header_t, crc));
+  return ~log_crc32(crc, record->data, record->header.size);
+}
+
+static uint32_t log_header_crc(const log_sector_header_t* header)
+{
+  return ~log_crc32(0xffffffff, header, offsetof(log_sector_header_t, crc));
+}
+
+static void log_init_sectors()
+{
+  uint32_t free_size = 0;
+  if(HOMEKIT_FS_END_PHYS_ADDR < STORAGE_BASE_ADDR)
+    free_size = STORAGE_BASE_ADDR - HOMEKIT_FS_END_PHYS_ADDR;
+
+  log_sector_count = 1 + free_size / SPI_FLASH_SEC_SIZE;
+  if(log_sector_count > LOG_MAX_SECTORS)
+    log_sector_count = LOG_MAX_SECTORS;
+
+  for(int i = 0; i < log_sector_count; i++)
+    log_sectors[i] = LOG_SECTOR_ADDR(i);
+}
+
+/* @return 1: record read, 0: end of the log, -1: invalid record (e.g. an interrupted write)
+*/
+static int log_read_record(uint32_t sector, uint16_t offset, log_record_t* record)
+{
+  if(offset + sizeof(record->header) > SPI_FLASH_SEC_SIZE)
+    return 0;
+
+  if(!storage_flash_read(sector + offset, (byte*)&record->header, sizeof(record->header)))
+    return -1;
+
+  if(record->header.type == LOG_RECORD_FREE)
+  {
+    const byte* p = (const byte*)&record->header;
+    for(size_t i = 0; i < sizeof(record->header); i++)
+    {
+      if(p[i] != 0xff)
+        return -1;
+    }
+    return 0;
+  }
+
+  size_t size = record->header.size;
+  if(size > sizeof(record->data) || offset + LOG_RECORD_SIZE(size) > SPI_FLASH_SEC_SIZE)
+    return -1;
+
+  if(size && !storage_flash_read(sector + offset + sizeof(record->header), record->data, (size + 3) & ~3))
+    return -1;
+
+  return log_record_crc(record) == record->header.crc ? 1 : -1;
+}
+
+/* Writes a record at log_end of the active sector, without collecting.
+*/
+static bool log_write_record(byte type, byte slot, const void* data, uint16_t size)
+{
+  log_record_t record;
+  uint16_t record_size = LOG_RECORD_SIZE(size);
+
+  if(log_active < 0 || log_end + record_size > SPI_FLASH_SEC_SIZE)
+    return false;
+
+  memset(&record, 0, sizeof(record));
+  record.header.type = type;
+  record.header.slot = slot;
+  record.header.size = size;
+  record.header.sequence = log_sequence + 1;
+  if(size)
+    memcpy(record.data, data, size);
+  record.header.crc = log_record_crc(&record);
+
+  if(!storage_flash_write(log_sectors[log_active] + log_end, (byte*)&record, record_size))
+  {
+    // state of the flash is unknown, collect before the next write
+    log_end = SPI_FLASH_SEC_SIZE;
+    return false;
+  }
+
+  log_sequence++;
+  if(type == LOG_RECORD_ACCESSORY_ID)
+    log_accessory_id_offset = log_end;
+  else if(type == LOG_RECORD_ACCESSORY_KEY)
+    log_accessory_key_offset = log_end;
+  log_end += record_size;
+  return true;
+}
+
+/* Reads the current accessory ID or key of the active sector.
+* @return size of the data, 0 if not stored
+*/
+static size_t log_read_accessory(byte type, byte* data, size_t size)
+{
+  if(log_active < 0)
+    return 0;
+
+  if(log_legacy)
+  {
+    uint32_t addr = (type == LOG_RECORD_ACCESSORY_ID) ? ACCESSORY_ID_ADDR : ACCESSORY_KEY_ADDR;
+    if(!storage_flash_read(addr, data, size))
+      return 0;
+    for(size_t i = 0; i < size; i++)
+    {
+      if(data[i] != 0xff)
+        return size;
+    }
+    return 0;
+  }
+
+  uint16_t offset = (type == LOG_RECORD_ACCESSORY_ID) ? log_accessory_id_offset : log_accessory_key_offset;
+  log_record_t record;
+  if(!offset
+    || log_read_record(log_sectors[log_active], offset, &record) != 1
+    || record.header.type != type
+    || record.header.size > size)
+  {
+    return 0;
+  }
+
+  memcpy(data, record.data, record.header.size);
+  return record.header.size;
+}
+
+/* Writes the live data into an erased 'target' sector and its header last.
+*/
+static bool log_write_sector(int target,
+  const byte* accessory_id, size_t accessory_id_size,
+  const byte* accessory_key, size_t accessory_key_size)
+{
+  log_active = target;
+  log_legacy = false;
+  log_end = sizeof(log_sector_header_t);
+  log_accessory_id_offset = 0;
+  log_accessory_key_offset = 0;
+
+  if(accessory_id_size && !log_write_record(LOG_RECORD_ACCESSORY_ID, 0, accessory_id, accessory_id_size))
+    return false;
+  if(accessory_key_size && !log_write_record(LOG_RECORD_ACCESSORY_KEY, 0, accessory_key, accessory_key_size))
+    return false;
+
+  pairing_data_t data;
+  for(int i = 0; i < MAX_PAIRINGS; i++)
+  {
+    if(!pairing_index[i].used)
+      continue;
+    pairing_index_get_data(i, &data);
+    if(!log_write_record(LOG_RECORD_PAIRING, i, &data, sizeof(data)))
+      return false;
+  }
+
+  log_sector_header_t header;
+  memset(&header, 0xff, sizeof(header));
+  memcpy(header.magic, log_magic, sizeof(header.magic));
+  header.sequence = ++log_sequence;
+  header.crc = log_header_crc(&header);
+  return storage_flash_write(log_sectors[target], (byte*)&header, sizeof(header));
+}
+
+/* Garbage collection: writes the live data into the next sector,
+* the accessory ID and key from the active sector, the pairings from RAM.
+* On failure the previous sector stays active (unless it is the only one).
+*/
+static bool log_collect()
+{
+  byte accessory_id[ACCESSORY_ID_SIZE];
+  byte accessory_key[ACCESSORY_KEY_SIZE];
+  size_t accessory_id_size = log_read_accessory(LOG_RECORD_ACCESSORY_ID, accessory_id, sizeof(accessory_id));
+  size_t accessory_key_size = log_read_accessory(LOG_RECORD_ACCESSORY_KEY, accessory_key, sizeof(accessory_key));
+
+  int previous = log_active;
+  bool previous_legacy = log_legacy;
+  uint16_t previous_id_offset = log_accessory_id_offset;
+  uint16_t previous_key_offset = log_accessory_key_offset;
+
+  int target = (log_active < 0) ? 0 : (log_active + 1) % log_sector_count;
+  STORAGE_DEBUG("Collecting pairing log into sector %d", target);
+
+  if(!storage_flash_erase(log_sectors[target])
+    || !log_write_sector(target, accessory_id, accessory_id_size, accessory_key, accessory_key_size))
+  {
+    ERROR("Failed to write HomeKit storage sector %d", target);
+    if(previous != target)
+    {
+      log_active = previous;
+      log_legacy = previous_legacy;
+      log_accessory_id_offset = previous_id_offset;
+      log_accessory_key_offset = previous_key_offset;
+    }
+    log_end = SPI_FLASH_SEC_SIZE;
+    return false;
+  }
+
+  return true;
+}
+
+/* Appends a record, collects the log first if the active sector is full.
+*/
+static bool log_append(byte type, byte slot, const void* data, uint16_t size)
+{
+  if(log_active < 0 || log_end + LOG_RECORD_SIZE(size) > SPI_FLASH_SEC_SIZE)
+  {
+    if(!log_collect())
+      return false;
+  }
+  return log_write_record(type, slot, data, size);
+}
+
+/* Replays the active sector into the pairing index.
+*/
+static void log_load()
+{
+  log_record_t record;
+  uint16_t offset = sizeof(log_sector_header_t);
+
+  for(;;)
+  {
+    int r = log_read_record(log_sectors[log_active], offset, &record);
+    if(r == 0)
+      break;
+    if(r < 0)
+    {
+      WARN("HomeKit storage: invalid record at %u, collecting on next write", offset);
+      offset = SPI_FLASH_SEC_SIZE;
+      break;
+    }
+
+    if(record.header.sequence > log_sequence)
+      log_sequence = record.header.sequence;
+
+    byte slot = record.header.slot;
+    switch(record.header.type)
+    {
+      case LOG_RECORD_ACCESSORY_ID:
+        log_accessory_id_offset = offset;
+        break;
+      case LOG_RECORD_ACCESSORY_KEY:
+        log_accessory_key_offset = offset;
+        break;
+      case LOG_RECORD_PAIRING:
+        if(slot < MAX_PAIRINGS && record.header.size == sizeof(pairing_data_t))
+          pairing_index_set(slot, (const pairing_data_t*)record.data);
+        break;
+      case LOG_RECORD_PAIRING_REMOVED:
+        if(slot < MAX_PAIRINGS)
+          pairing_index_remove(slot);
+        break;
+    }
+
+    offset += LOG_RECORD_SIZE(record.header.size);
+  }
+
+  log_end = offset;
+}
+
+/* Selects the valid sector with the highest sequence.
+* @return false if there is none
+*/
+static bool log_find_active()
+{
+  log_sector_header_t header;
+
+  log_active = -1;
+  log_legacy = false;
+  log_sequence = 0;
+  log_end = 0;
+  log_accessory_id_offset = 0;
+  log_accessory_key_offset = 0;
+
+  for(int i = 0; i < log_sector_count; i++)
+  {
+    if(!storage_flash_read(log_sectors[i], (byte*)&header, sizeof(header)))
+    {
+      ERROR("Failed to read HomeKit storage header");
+      continue;
+    }
+    if(memcmp(header.magic, log_magic, sizeof(header.magic))
+      || header.crc != log_header_crc(&header))
+    {
+      continue;
+    }
+    if(log_active < 0 || header.sequence > log_sequence)
+    {
+      log_active = i;
+      log_sequence = header.sequence;
+    }
+  }
+
+  return log_active >= 0;
+}
+
+/* Converts the fixed layout of older versions into the log.
+* @return false if the EEPROM sector has no legacy data
+*/
+static bool log_migrate_legacy()
+{
+  char magic[sizeof(magic1)];
+  if(!storage_flash_read(MAGIC_ADDR, (byte*)magic, sizeof(magic))
+    || strncmp(magic, magic1, sizeof(magic1)))
+  {
+    return false;
+  }
+
+  INFO("Converting HomeKit storage at 0x%x", STORAGE_BASE_ADDR);
+
+  pairing_data_t data;
+  for(int i = 0; i < MAX_PAIRINGS; i++)
+  {
+    if(storage_flash_read(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data))
+      && !strncmp(data.magic, magic1, sizeof(data.magic)))
+    {
+      pairing_index_set(i, &data);
+    }
+  }
+
+  // legacy data is read by log_read_accessory
+  log_active = 0;
+  log_legacy = true;
+  return log_collect();
+}
+
+#pragma endregion
+
 
 #pragma region homekit_storage_init
 int homekit_storage_init()
@@ -139,33 +703,28 @@ int homekit_storage_init()
   STORAGE_DEBUG("_SPIFFS_start: 0x%x (%u)",
     HOMEKIT_SPIFFS_PHYS_ADDR, HOMEKIT_SPIFFS_PHYS_ADDR);
 
-  char magic[sizeof(magic1)];
-  memset(magic, 0, sizeof(magic));
+  pairing_index_clear();
+  log_init_sectors();
+  common_state = -1;
 
-  if(!spiflash_read(MAGIC_ADDR, (byte*)magic, sizeof(magic)))
+  if(log_find_active())
   {
-    ERROR("Failed to read HomeKit storage magic");
+    log_load();
   }
-
-  if(strncmp(magic, magic1, sizeof(magic1)))
+  else if(!log_migrate_legacy())
   {
     INFO("Formatting HomeKit storage at 0x%x", STORAGE_BASE_ADDR);
-    if(!spiflash_erase_sector(STORAGE_BASE_ADDR))
-    {
-      ERROR("Failed to erase HomeKit storage");
+    pairing_index_clear();
+    log_active = -1;
+    if(!log_collect())
       return -1;
-    }
-
-    strncpy(magic, magic1, sizeof(magic));
-    if(!spiflash_write(MAGIC_ADDR, (byte*)magic, sizeof(magic)))
-    {
-      ERROR("Failed to write HomeKit storage magic");
-      return -1;
-    }
 
     return 1;
   }
 
+  VERBOSE("HomeKit storage: %d sector(s), %u of %u bytes used",
+    log_sector_count, log_end, SPI_FLASH_SEC_SIZE);
+
   return 0;
 }
 
@@ -174,13 +733,21 @@ int homekit_storage_init()
 #pragma region homekit_storage_reset
 int homekit_storage_reset()
 {
-  byte blank[sizeof(magic1)];
+  byte blank[sizeof(log_magic)];
   memset(blank, 0, sizeof(blank));
 
-  if(!spiflash_write(MAGIC_ADDR, blank, sizeof(blank)))
+  pairing_index_clear();
+
+  // invalidates log headers and the legacy magic; no erase needed
+  if(!log_sector_count)
+    log_init_sectors();
+  for(int i = 0; i < log_sector_count; i++)
   {
-    ERROR("Failed to reset HomeKit storage");
-    return -1;
+    if(!storage_flash_write(log_sectors[i], blank, sizeof(blank)))
+    {
+      ERROR("Failed to reset HomeKit storage");
+      return -1;
+    }
   }
 
   return homekit_storage_init();
@@ -191,7 +758,7 @@ int homekit_storage_reset()
 #pragma region homekit_storage_save_accessory_id
 void homekit_storage_save_accessory_id(const char* accessory_id)
 {
-  if(!spiflash_write(ACCESSORY_ID_ADDR, (byte*)accessory_id, ACCESSORY_ID_SIZE))
+  if(!log_append(LOG_RECORD_ACCESSORY_ID, 0, accessory_id, ACCESSORY_ID_SIZE))
   {
     ERROR("Failed to write accessory ID to HomeKit storage");
   }
@@ -208,7 +775,7 @@ static char ishex(unsigned char c)
 
 int homekit_storage_load_accessory_id(char* data)
 {
-  if(!spiflash_read(ACCESSORY_ID_ADDR, (byte*)data, ACCESSORY_ID_SIZE))
+  if(log_read_accessory(LOG_RECORD_ACCESSORY_ID, (byte*)data, ACCESSORY_ID_SIZE) != ACCESSORY_ID_SIZE)
   {
     ERROR("Failed to read accessory ID from HomeKit storage");
     return -1;
@@ -245,7 +812,7 @@ void homekit_storage_save_accessory_key(const ed25519_key* key)
     return;
   }
 
-  if(!spiflash_write(ACCESSORY_KEY_ADDR, key_data, key_data_size))
+  if(!log_append(LOG_RECORD_ACCESSORY_KEY, 0, key_data, key_data_size))
   {
     ERROR("Failed to write accessory key to HomeKit storage");
     return;
@@ -258,7 +825,7 @@ void homekit_storage_save_accessory_key(const ed25519_key* key)
 int homekit_storage_load_accessory_key(ed25519_key* key)
 {
   byte key_data[ACCESSORY_KEY_SIZE];
-  if(!spiflash_read(ACCESSORY_KEY_ADDR, key_data, sizeof(key_data)))
+  if(log_read_accessory(LOG_RECORD_ACCESSORY_KEY, key_data, sizeof(key_data)) != sizeof(key_data))
   {
     ERROR("Failed to read accessory key from HomeKit storage");
     return -1;
@@ -277,96 +844,24 @@ int homekit_storage_load_accessory_key(ed25519_key* key)
 
 #pragma endregion
 
-#pragma region homekit_storage_can_add_pairing
-bool homekit_storage_can_add_pairing()
-{
-  pairing_data_t data;
-  for(int i = 0; i < MAX_PAIRINGS; i++)
-  {
-    spiflash_read(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data));
-    if(strncmp(data.magic, magic1, sizeof(magic1)))
-      return true;
-  }
-  return false;
-}
-
-#pragma endregion
-
-#pragma region static int compact_data
-static int compact_data()
+#pragma region static int find_empty_block
+static int find_empty_block()
 {
-  byte* data = malloc(SPI_FLASH_SECTOR_SIZE);
-  if(!spiflash_read(STORAGE_BASE_ADDR, data, SPI_FLASH_SECTOR_SIZE))
-  {
-    free(data);
-    ERROR("Failed to compact HomeKit storage: sector data read error");
-    return -1;
-  }
-
-  int next_pairing_idx = 0;
   for(int i = 0; i < MAX_PAIRINGS; i++)
   {
-    pairing_data_t* pairing_data = (pairing_data_t*)&data[PAIRINGS_OFFSET + sizeof(pairing_data_t) * i];
-    if(!strncmp(pairing_data->magic, magic1, sizeof(magic1)))
-    {
-      if(i != next_pairing_idx)
-      {
-        memcpy(&data[PAIRINGS_ADDR + sizeof(pairing_data_t) * next_pairing_idx],
-          pairing_data, sizeof(*pairing_data));
-      }
-      next_pairing_idx++;
-    }
-  }
-
-  if(next_pairing_idx == MAX_PAIRINGS)
-  {
-    // We are full, no compaction possible, do not waste flash erase cycle
-    free(data);
-    return 0;
-  }
-
-  if(homekit_storage_reset())
-  {
-    ERROR("Failed to compact HomeKit storage: error resetting flash");
-    free(data);
-    return -1;
-  }
-  if(!spiflash_write(STORAGE_BASE_ADDR, data, PAIRINGS_OFFSET + sizeof(pairing_data_t) * next_pairing_idx))
-  {
-    ERROR("Failed to compact HomeKit storage: error writing compacted data");
-    free(data);
-    return -1;
+    if(!pairing_index[i].used)
+      return i;
   }
 
-  free(data);
-
-  return 0;
+  return -1;
 }
 
 #pragma endregion
 
-#pragma region static int find_empty_block
-static int find_empty_block()
+#pragma region homekit_storage_can_add_pairing
+bool homekit_storage_can_add_pairing()
 {
-  byte data[sizeof(pairing_data_t)];
-
-  for(int i = 0; i < MAX_PAIRINGS; i++)
-  {
-    spiflash_read(PAIRINGS_ADDR + sizeof(data) * i, data, sizeof(data));
-
-    bool block_empty = true;
-    for(int j = 0; j < sizeof(data); j++)
-      if(data[j] != 0xff)
-      {
-        block_empty = false;
-        break;
-      }
-
-    if(block_empty)
-      return i;
-  }
-
-  return -1;
+  return find_empty_block() != -1;
 }
 
 #pragma endregion
@@ -375,12 +870,6 @@ static int find_empty_block()
 int homekit_storage_add_pairing(const char* device_id, const ed25519_key* device_key, byte permissions)
 {
   int next_block_idx = find_empty_block();
-  if(next_block_idx == -1)
-  {
-    compact_data();
-    next_block_idx = find_empty_block();
-  }
-
   if(next_block_idx == -1)
   {
     ERROR("Failed to write pairing info to HomeKit storage: max number of pairings");
@@ -392,7 +881,8 @@ int homekit_storage_add_pairing(const char* device_id, const ed25519_key* device
   memset(&data, 0, sizeof(data));
   strncpy(data.magic, magic1, sizeof(data.magic));
   data.permissions = permissions;
-  strncpy(data.device_id, device_id, sizeof(data.device_id));
+  // device_id has no terminating 0 if it fills the field
+  memcpy(data.device_id, device_id, strnlen(device_id, sizeof(data.device_id)));
   size_t device_public_key_size = sizeof(data.device_public_key);
   int r = crypto_ed25519_export_public_key(
     device_key, data.device_public_key, &device_public_key_size
@@ -403,12 +893,13 @@ int homekit_storage_add_pairing(const char* device_id, const ed25519_key* device
     return -1;
   }
 
-  if(!spiflash_write(PAIRINGS_ADDR + sizeof(data) * next_block_idx, (byte*)&data, sizeof(data)))
+  if(!log_append(LOG_RECORD_PAIRING, next_block_idx, &data, sizeof(data)))
   {
     ERROR("Failed to write pairing info to HomeKit storage");
     return -1;
   }
 
+  pairing_index_set(next_block_idx, &data);
   return 0;
 }
 
@@ -417,47 +908,22 @@ int homekit_storage_add_pairing(const char* device_id, const ed25519_key* device
 #pragma region homekit_storage_update_pairing
 int homekit_storage_update_pairing(const char* device_id, byte permissions)
 {
-  pairing_data_t data;
-  for(int i = 0; i < MAX_PAIRINGS; i++)
-  {
-    spiflash_read(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data));
-    if(strncmp(data.magic, magic1, sizeof(data.magic)))
-      continue;
-
-    if(!strncmp(data.device_id, device_id, sizeof(data.device_id)))
-    {
-      int next_block_idx = find_empty_block();
-      if(next_block_idx == -1)
-      {
-        compact_data();
-        next_block_idx = find_empty_block();
-      }
-
-      if(next_block_idx == -1)
-      {
-        ERROR("Failed to write pairing info to HomeKit storage: max number of pairings");
-        return -2;
-      }
-
-      data.permissions = permissions;
-
-      if(!spiflash_write(PAIRINGS_ADDR + sizeof(data) * next_block_idx, (byte*)&data, sizeof(data)))
-      {
-        ERROR("Failed to write pairing info to HomeKit storage");
-        return -1;
-      }
+  int i = pairing_index_find(device_id);
+  if(i == -1)
+    return -1;
 
-      memset(&data, 0, sizeof(data));
-      if(!spiflash_write(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data)))
-      {
-        ERROR("Failed to update pairing: error erasing old record from HomeKit storage");
-        return -2;
-      }
+  pairing_data_t data;
+  pairing_index_get_data(i, &data);
+  data.permissions = permissions;
 
-      return 0;
-    }
+  if(!log_append(LOG_RECORD_PAIRING, i, &data, sizeof(data)))
+  {
+    ERROR("Failed to write pairing info to HomeKit storage");
+    return -1;
   }
-  return -1;
+
+  pairing_index[i].permissions = permissions;
+  return 0;
 }
 
 #pragma endregion
@@ -465,25 +931,17 @@ int homekit_storage_update_pairing(const char* device_id, byte permissions)
 #pragma region homekit_storage_remove_pairing
 int homekit_storage_remove_pairing(const char* device_id)
 {
-  pairing_data_t data;
-  for(int i = 0; i < MAX_PAIRINGS; i++)
-  {
-    spiflash_read(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data));
-    if(strncmp(data.magic, magic1, sizeof(data.magic)))
-      continue;
-
-    if(!strncmp(data.device_id, device_id, sizeof(data.device_id)))
-    {
-      memset(&data, 0, sizeof(data));
-      if(!spiflash_write(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data)))
-      {
-        ERROR("Failed to remove pairing from HomeKit storage");
-        return -2;
-      }
+  int i = pairing_index_find(device_id);
+  if(i == -1)
+    return 0;
 
-      return 0;
-    }
+  if(!log_append(LOG_RECORD_PAIRING_REMOVED, i, NULL, 0))
+  {
+    ERROR("Failed to remove pairing from HomeKit storage");
+    return -2;
   }
+
+  pairing_index_remove(i);
   return 0;
 }
 
@@ -492,33 +950,31 @@ int homekit_storage_remove_pairing(const char* device_id)
 #pragma region homekit_storage_find_pairing
 int homekit_storage_find_pairing(const char* device_id, pairing_t* pairing)
 {
-  pairing_data_t data;
-  for(int i = 0; i < MAX_PAIRINGS; i++)
-  {
-    spiflash_read(PAIRINGS_ADDR + sizeof(data) * i, (byte*)&data, sizeof(data));
-    if(strncmp(data.magic, magic1, sizeof(data.magic)))
-      continue;
+  int i = pairing_index_find(device_id);
+  if(i == -1)
+    return -1;
 
-    if(!strncmp(data.device_id, device_id, sizeof(data.device_id)))
-    {
-      crypto_ed25519_init(&pairing->device_key);
-      int r = crypto_ed25519_import_public_key(&pairing->device_key, data.device_public_key, sizeof(data.device_public_key));
-      if(r)
-      {
-        ERROR("Failed to import device public key (code %d)", r);
-        return -2;
-      }
-
-      pairing->id = i;
-      strncpy(pairing->device_id, data.device_id, DEVICE_ID_SIZE);
-      pairing->device_id[DEVICE_ID_SIZE] = 0;
-      pairing->permissions = data.permissions;
+  return pairing_index_get(i, pairing);
+}
 
-      return 0;
-    }
+#pragma endregion
+
+#pragma region homekit_storage_pairing_verify_cache
+ed25519_verify_cache* homekit_storage_pairing_verify_cache(const pairing_t* pairing)
+{
+  if(pairing->id < 0 || pairing->id >= MAX_PAIRINGS)
+    return NULL;
+
+  pairing_index_entry_t* entry = &pairing_index[pairing->id];
+  if(!entry->used
+    || strncmp(entry->device_id, pairing->device_id, sizeof(entry->device_id)))
+  {
+    return NULL;
   }
 
-  return -1;
+  if(!entry->verify_cache)
+    entry->verify_cache = crypto_ed25519_verify_cache_new(&pairing->device_key);
+  return entry->verify_cache;
 }
 
 #pragma endregion
@@ -526,29 +982,12 @@ int homekit_storage_find_pairing(const char* device_id, pairing_t* pairing)
 #pragma region homekit_storage_next_pairing
 int homekit_storage_next_pairing(pairing_iterator_t* it, pairing_t* pairing)
 {
-  pairing_data_t data;
   while(it->idx < MAX_PAIRINGS)
   {
     int id = it->idx++;
 
-    spiflash_read(PAIRINGS_ADDR + sizeof(data) * id, (byte*)&data, sizeof(data));
-    if(!strncmp(data.magic, magic1, sizeof(data.magic)))
-    {
-      crypto_ed25519_init(&pairing->device_key);
-      int r = crypto_ed25519_import_public_key(&pairing->device_key, data.device_public_key, sizeof(data.device_public_key));
-      if(r)
-      {
-        ERROR("Failed to import device public key (code %d)", r);
-        continue;
-      }
-
-      pairing->id = id;
-      strncpy(pairing->device_id, data.device_id, DEVICE_ID_SIZE);
-      pairing->device_id[DEVICE_ID_SIZE] = 0;
-      pairing->permissions = data.permissions;
-
+    if(pairing_index[id].used && !pairing_index_get(id, pairing))
       return 0;
-    }
   }
 
   return -1;
@@ -557,35 +996,204 @@ int homekit_storage_next_pairing(pairing_iterator_t* it, pairing_t* pairing)
 #pragma endregion
 
 
+#pragma region homekit_storage_fs_area_free
+/*
+* A LittleFS formatted in the file system area starts with its superblock
+* in block 0 or 1 (metadata pair):
+* revision(4) tag(4) "littlefs"(8) tag(4) version(4) block_size(4) block_count(4)
+*/
+bool homekit_storage_fs_area_free(uint32_t addr, size_t size)
+{
+  for(uint32_t block = 0; block < 2; ++block)
+  {
+    uint32_t sb[8];
+    if(!storage_flash_read(HOMEKIT_FS_START_PHYS_ADDR + block * SPI_FLASH_SEC_SIZE, sb, sizeof(sb)))
+      return false;
+    if(memcmp((const uint8_t*)sb + LFS_MAGIC_OFFSET, "littlefs", 8) != 0)
+      continue;
+
+    uint64_t fs_end = HOMEKIT_FS_START_PHYS_ADDR
+      + (uint64_t)sb[LFS_BLOCK_SIZE_OFFSET / 4] * sb[LFS_BLOCK_COUNT_OFFSET / 4];
+    if(addr < fs_end && addr + size > HOMEKIT_FS_START_PHYS_ADDR)
+      return false;
+  }
+  return true;
+}
+
+#pragma endregion
+
+#pragma region common area
+/* @return false (once logged) if the common pages are not in the flash
+* layout or a LittleFS of the sketch covers them
+*/
+static bool common_available()
+{
+  if(common_state < 0)
+  {
+    common_state = 0;
+    #ifndef HOMEKIT_STORAGE_COMMON_ADDR
+    if(HOMEKIT_FS_END_PHYS_ADDR < HOMEKIT_FS_START_PHYS_ADDR + COMMON_PAGE_COUNT * SPI_FLASH_SEC_SIZE)
+    {
+      ERROR("No file system area for the common pages, choose a flash layout with FS");
+      return false;
+    }
+    #endif
+    if(!homekit_storage_fs_area_free(COMMON_BEGIN_ADDR, COMMON_PAGE_COUNT * SPI_FLASH_SEC_SIZE))
+    {
+      ERROR("LittleFS covers the common pages at 0x%x, mount it without the last %d sectors",
+        COMMON_BEGIN_ADDR, COMMON_PAGE_COUNT);
+      return false;
+    }
+    common_state = 1;
+  }
+  return common_state > 0;
+}
+
+static bool common_read(uint32_t addr, uint8_t* pBuf, size_t size)
+{
+  if(((addr | size | (uintptr_t)pBuf) & 3) == 0)
+  {
+    if(!storage_flash_read(addr, pBuf, size))
+    {
+      ERROR("spiflash_read failed at 0x%x", addr);
+      return false;
+    }
+    return true;
+  }
+
+  // The flash reads 4-byte aligned words: copy through an aligned buffer
+  uint32_t chunk[16];
+  while(size > 0)
+  {
+    uint32_t begin = addr & ~3;
+    size_t skip = addr - begin;
+    size_t n = sizeof(chunk) - skip;
+    if(n > size)
+      n = size;
+
+    if(!storage_flash_read(begin, chunk, (skip + n + 3) & ~3))
+    {
+      ERROR("spiflash_read failed at 0x%x", begin);
+      return false;
+    }
+    memcpy(pBuf, (uint8_t*)chunk + skip, n);
+    addr += n;
+    pBuf += n;
+    size -= n;
+  }
+  return true;
+}
+
+#pragma endregion
+
 #pragma region homekit_storage_common_read
 bool homekit_storage_common_read(uint8_t pageIndex, size_t offset, uint8_t* pBuf, size_t size)
 {
-  if(offset + size > SPI_FLASH_SEC_SIZE && pageIndex < COMMON_PAGE_COUNT)
+  if(offset + size > SPI_FLASH_SEC_SIZE || pageIndex >= COMMON_PAGE_COUNT)
   {
     ERROR("Invalid args: offset+size (%d) <= MAX AND pageIndex (%d) < MAX", offset+size, pageIndex);
     return false;
   }
+  if(!common_available())
+    return false;
 
-  if(!spiflash_read(COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE + offset, pBuf, size))
-  {
-    ERROR("spiflash_read failed page: %d", pageIndex);
+  return common_read(COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE + offset, pBuf, size);
+}
+#pragma endregion
+
+#pragma region homekit_storage_legacy_common_read
+bool homekit_storage_legacy_common_read(size_t offset, uint8_t* pBuf, size_t size)
+{
+  if(offset + size > SPI_FLASH_SEC_SIZE)
     return false;
-  }
+  return common_read(LEGACY_COMMON_ADDR + offset, pBuf, size);
+}
+#pragma endregion
 
-//printf("homekit_storage_common_read offset: %d, size: %d  <%02x %02x>\n", offset, size, pBuf[0], pBuf[1]);
+#pragma region common_program
+/*
+* NOR flash programs bits 1->0 without an erase, only 0->1 needs one.
+* Compares the new bytes with the flash in aligned chunks: if no bit
+* has to go from 0 to 1 (e.g. appending into an erased area), the data
+* is programmed in place. Bytes of a chunk outside [addr, addr+size)
+* are programmed with their current value and do not change.
+* @param program false: compare only, true: compare and program
+* @return COMMON_WRITE_*, -1 on read/write error
+*/
+#define COMMON_CHUNK_SIZE     64
 
-  return true;
+#define COMMON_WRITE_SAME     0 // flash holds the data already
+#define COMMON_WRITE_PROGRAM  1 // programmable without erase
+#define COMMON_WRITE_ERASE    2 // needs read, erase and rewrite of the page
+
+static int common_program(uint32_t addr, const uint8_t* pBuf, size_t size, bool program)
+{
+  uint32_t chunk[COMMON_CHUNK_SIZE / 4];
+  uint8_t* bytes = (uint8_t*)chunk;
+  uint32_t begin = addr & ~3;
+  uint32_t end = (addr + size + 3) & ~3;
+  int mode = COMMON_WRITE_SAME;
+
+  for(uint32_t pos = begin; pos < end; pos += COMMON_CHUNK_SIZE)
+  {
+    size_t n = (end - pos < COMMON_CHUNK_SIZE) ? end - pos : COMMON_CHUNK_SIZE;
+    bool changed = false;
+
+    if(!storage_flash_read(pos, chunk, n))
+      return -1;
+
+    for(size_t i = 0; i < n; i++)
+    {
+      if(pos + i < addr || pos + i >= addr + size)
+        continue;
+
+      uint8_t value = pBuf[pos + i - addr];
+      if(bytes[i] == value)
+        continue;
+      if((bytes[i] & value) != value)
+        return COMMON_WRITE_ERASE;
+
+      bytes[i] = value;
+      changed = true;
+      mode = COMMON_WRITE_PROGRAM;
+    }
+
+    if(program && changed && !storage_flash_write(pos, chunk, n))
+      return -1;
+  }
+
+  return mode;
 }
+
 #pragma endregion
 
 #pragma region homekit_storage_common_write
 bool homekit_storage_common_write(uint8_t pageIndex, size_t offset, const uint8_t* pBuf, size_t size)
 {
-  if(offset + size > SPI_FLASH_SEC_SIZE && pageIndex < COMMON_PAGE_COUNT)
+  if(offset + size > SPI_FLASH_SEC_SIZE || pageIndex >= COMMON_PAGE_COUNT)
   {
     ERROR("Invalid args: offset+size (%d) <= MAX AND pageIndex (%d) < MAX", offset + size, pageIndex);
     return false;
   }
+  if(!common_available())
+    return false;
+
+  const uint32_t PageAddr = COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE;
+
+  // without erase if possible
+  int Mode = common_program(PageAddr + offset, pBuf, size, false);
+  if(Mode == COMMON_WRITE_PROGRAM)
+    Mode = common_program(PageAddr + offset, pBuf, size, true);
+  if(Mode < 0)
+  {
+    ERROR("spiflash access failed page: %d", pageIndex);
+    return false;
+  }
+  if(Mode != COMMON_WRITE_ERASE)
+  {
+    storage_stats.erases_avoided++;
+    return true;
+  }
 
   uint8_t* Page = NULL;
 
@@ -602,7 +1210,7 @@ bool homekit_storage_common_write(uint8_t pageIndex, size_t offset, const uint8_
     }
 
     // read page
-    if(!spiflash_read(COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE, (byte*)Page, SPI_FLASH_SEC_SIZE))
+    if(!storage_flash_read(PageAddr, (byte*)Page, SPI_FLASH_SEC_SIZE))
     {
       CLEANUP();
       ERROR("spiflash_read failed page: %d", pageIndex);
@@ -613,7 +1221,7 @@ bool homekit_storage_common_write(uint8_t pageIndex, size_t offset, const uint8_
     memcpy(&Page[offset], pBuf, size);
   }
 
-  if(!spiflash_erase_sector(COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE))
+  if(!storage_flash_erase(PageAddr))
   {
     CLEANUP();
     ERROR("spiflash_erase_sector failed page: %d", pageIndex);
@@ -621,7 +1229,7 @@ bool homekit_storage_common_write(uint8_t pageIndex, size_t offset, const uint8_
   }
 
   pBuf = (size == SPI_FLASH_SEC_SIZE) ? pBuf : Page;
-  if(!spiflash_write(COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE + offset, pBuf, size))
+  if(!storage_flash_write(PageAddr, pBuf, SPI_FLASH_SEC_SIZE))
   {
     CLEANUP();
     ERROR("spiflash_write failed page: %d", pageIndex);
@@ -636,3 +1244,30 @@ bool homekit_storage_common_write(uint8_t pageIndex, size_t offset, const uint8_
 }
 #pragma endregion
 
+#pragma region homekit_storage_common_erase
+bool homekit_storage_common_erase(uint8_t pageIndex)
+{
+  if(pageIndex >= COMMON_PAGE_COUNT)
+  {
+    ERROR("Invalid args: pageIndex (%d) < MAX", pageIndex);
+    return false;
+  }
+  if(!common_available())
+    return false;
+
+  if(!storage_flash_erase(COMMON_BEGIN_ADDR + pageIndex * SPI_FLASH_SEC_SIZE))
+  {
+    ERROR("spiflash_erase_sector failed page: %d", pageIndex);
+    return false;
+  }
+  return true;
+}
+#pragma endregion
+
+#pragma region homekit_storage_get_stats
+void homekit_storage_get_stats(homekit_storage_stats_t* stats)
+{
+  *stats = storage_stats;
+}
+#pragma endregion
+
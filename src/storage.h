@@ -19,14 +19,54 @@ extern "C" {
 
 #pragma endregion
 
+/* Sectors of the common storage area: the last sectors of the file system
+* area (_FS_end), or at HOMEKIT_STORAGE_COMMON_ADDR (physical address) if
+* defined. They are not used if a LittleFS formatted by the sketch covers
+* them (homekit_storage_fs_area_free); SPIFFS is not detected.
+*/
+#ifndef HOMEKIT_STORAGE_COMMON_PAGES
+#define HOMEKIT_STORAGE_COMMON_PAGES 2
+#endif
+
 /* Read and write functions for the common storage area.
 * The common storage area is used out of homekit.
 * @note offset+size must be less than 4096
+* A write that only clears bits (or fills an erased area) is programmed
+* in place, otherwise the page is read, erased and rewritten.
 */
 bool homekit_storage_common_read(uint8_t pageIndex, size_t offset, uint8_t* pBuf, size_t size);
 bool homekit_storage_common_write(uint8_t pageIndex, size_t offset, const uint8_t* pBuf, size_t size);
+/* Erases a page of the common storage area (all bytes 0xff).
+*/
+bool homekit_storage_common_erase(uint8_t pageIndex);
+/* Reads the common page of older versions (EEPROM+8K, a sector of the SDK),
+* only to migrate it.
+*/
+bool homekit_storage_legacy_common_read(size_t offset, uint8_t* pBuf, size_t size);
+
+/* @return false if a LittleFS in the file system area (superblock at
+* _FS_start) covers [addr, addr+size).
+*/
+bool homekit_storage_fs_area_free(uint32_t addr, size_t size);
+
+/* Flash operation counters of this storage (pairing log and common area)
+* since boot.
+*/
+typedef struct
+{
+  uint32_t reads;
+  uint32_t writes;          // program operations
+  uint32_t bytes_written;
+  uint32_t erases;          // sector erases
+  uint32_t erases_avoided;  // common writes done without an erase
+} homekit_storage_stats_t;
+
+void homekit_storage_get_stats(homekit_storage_stats_t* stats);
 
 int homekit_storage_reset();
+/* Formats the storage if needed and loads the pairing records into RAM.
+* Pairing reads are served from RAM afterwards, changes write through.
+*/
 int homekit_storage_init();
 
 void homekit_storage_save_accessory_id(const char* accessory_id);
@@ -41,6 +81,13 @@ int homekit_storage_update_pairing(const char* device_id, byte permissions);
 int homekit_storage_remove_pairing(const char* device_id);
 int homekit_storage_find_pairing(const char* device_id, pairing_t* pairing);
 
+/* Uncompressed public key of a stored pairing for crypto_ed25519_verify_cached.
+* Created on the first call for a pairing and kept until it is removed.
+* @param pairing as returned by homekit_storage_find_pairing
+* @return NULL if out of memory or the pairing is no longer stored
+*/
+ed25519_verify_cache* homekit_storage_pairing_verify_cache(const pairing_t* pairing);
+
 typedef struct
 {
   int idx;
@@ -53,6 +100,7 @@ inline void homekit_storage_pairing_iterator_init(pairing_iterator_t* it)
 }
 inline void homekit_storage_pairing_iterator_done(pairing_iterator_t* iterator)
 {
+  (void)iterator;
 }
 
 int homekit_storage_next_pairing(pairing_iterator_t* it, pairing_t* pairing);
@@ -12,7 +12,11 @@
 #include "stdint.h"
 #include "stddef.h"
 #include "stdlib.h"
+#ifdef HOMEKIT_FLASH_SIM
+#include "host_shim.h"
+#else
 #include "osapi.h"
+#endif
 #include "homekit_debug.h"
 
 static inline int hwrand_generate_block(uint8_t* buf, size_t len) {
@@ -52,6 +56,10 @@ static inline int hwrand_generate_block(uint8_t* buf, size_t len) {
 #define HAVE_POLY1305
 #define HAVE_ED25519
 #define WOLFSSL_SHA512
+//see sha512.c
+//SHA-512 transform on 32-bit halves, constants read from flash (no 640 byte copy per block)
+//~13 KB more code than the default transform
+//#define ESP_SHA512_TRANSFORM_32BIT
 #define WOLFCRYPT_HAVE_SRP
 #define HAVE_HKDF
 
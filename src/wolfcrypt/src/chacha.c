@@ -85,6 +85,11 @@
 /* Number of rounds */
 #define ROUNDS  20
 
+/* Key stream blocks created per pass of wc_Chacha_encrypt_bytes */
+#ifndef CHACHA_KEYSTREAM_BLOCKS
+    #define CHACHA_KEYSTREAM_BLOCKS 4
+#endif
+
 #define U32C(v) (v##U)
 #define U32V(v) ((word32)(v) & U32C(0xFFFFFFFF))
 #define U8TO32_LITTLE(p) LITTLE32(((word32*)(p))[0])
@@ -964,33 +969,60 @@ static void chacha_encrypt_avx2(ChaCha* ctx, const byte* m, byte* c,
 #endif /* HAVE_INTEL_AVX2 */
 #endif /* USE_INTEL_CHACHA_SPEEDUP */
 
+/**
+  * Creates 'blocks' consecutive key stream blocks and advances the block
+  * counter accordingly.
+  */
+static void wc_Chacha_keystream(ChaCha* ctx, word32* output, word32 blocks)
+{
+    for (; blocks > 0; --blocks) {
+        wc_Chacha_wordtobyte(output, ctx->X);
+        ctx->X[CHACHA_IV_BYTES] = PLUSONE(ctx->X[CHACHA_IV_BYTES]);
+        output += CHACHA_CHUNK_WORDS;
+    }
+}
+
 /**
   * Encrypt a stream of bytes
+  * The key stream is created CHACHA_KEYSTREAM_BLOCKS blocks at a time and
+  * combined word by word if input and output are word aligned.
   */
 static void wc_Chacha_encrypt_bytes(ChaCha* ctx, const byte* m, byte* c,
                                     word32 bytes)
 {
-    byte*  output;
-    word32 temp[CHACHA_CHUNK_WORDS]; /* used to make sure aligned */
+    word32 stream[CHACHA_KEYSTREAM_BLOCKS * CHACHA_CHUNK_WORDS];
+    const byte* output = (const byte*)stream;
+    word32 blocks;
+    word32 len;
     word32 i;
-
-    output = (byte*)temp;
-
-    for (; bytes > 0;) {
-        wc_Chacha_wordtobyte(temp, ctx->X);
-        ctx->X[CHACHA_IV_BYTES] = PLUSONE(ctx->X[CHACHA_IV_BYTES]);
-        if (bytes <= CHACHA_CHUNK_BYTES) {
-            for (i = 0; i < bytes; ++i) {
-                c[i] = m[i] ^ output[i];
+    int    aligned = (((wolfssl_word)m | (wolfssl_word)c) &
+                      (sizeof(word32) - 1)) == 0;
+
+    while (bytes > 0) {
+        blocks = (bytes + CHACHA_CHUNK_BYTES - 1) / CHACHA_CHUNK_BYTES;
+        if (blocks > CHACHA_KEYSTREAM_BLOCKS)
+            blocks = CHACHA_KEYSTREAM_BLOCKS;
+        wc_Chacha_keystream(ctx, stream, blocks);
+
+        len = blocks * CHACHA_CHUNK_BYTES;
+        if (len > bytes)
+            len = bytes;
+
+        i = 0;
+        if (aligned) {
+            /* stream holds little endian bytes, XOR of words is the same */
+            for (; i + sizeof(word32) <= len; i += sizeof(word32)) {
+                *(word32*)(c + i) = *(const word32*)(m + i) ^
+                                    stream[i / sizeof(word32)];
             }
-            return;
         }
-        for (i = 0; i < CHACHA_CHUNK_BYTES; ++i) {
+        for (; i < len; ++i) {
             c[i] = m[i] ^ output[i];
         }
-        bytes -= CHACHA_CHUNK_BYTES;
-        c += CHACHA_CHUNK_BYTES;
-        m += CHACHA_CHUNK_BYTES;
+
+        bytes -= len;
+        c += len;
+        m += len;
     }
 }
 
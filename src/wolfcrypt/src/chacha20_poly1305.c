@@ -178,7 +178,7 @@ static int calculateAuthTag(
     Poly1305 poly1305Ctx;
     byte padding[CHACHA20_POLY1305_MAC_PADDING_ALIGNMENT - 1];
     word32 paddingLen;
-    byte little64[8];
+    byte little64[16];
 
     XMEMSET(padding, 0, sizeof(padding));
 
@@ -234,19 +234,11 @@ static int calculateAuthTag(
         }
     }
 
-    /* -- AAD length as a 64-bit little endian integer */
+    /* -- AAD length and ciphertext length as 64-bit little endian integers,
+          one block */
 
     word32ToLittle64(inAADLen, little64);
-
-    err = wc_Poly1305Update(&poly1305Ctx, little64, sizeof(little64));
-    if (err)
-    {
-        return err;
-    }
-
-    /* -- Ciphertext length as a 64-bit little endian integer */
-
-    word32ToLittle64(inCiphertextLen, little64);
+    word32ToLittle64(inCiphertextLen, little64 + 8);
 
     err = wc_Poly1305Update(&poly1305Ctx, little64, sizeof(little64));
     if (err)
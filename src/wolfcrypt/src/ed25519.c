@@ -288,6 +288,116 @@ int wc_ed25519_verify_msg(const byte* sig, word32 siglen, const byte* msg,
     return ret;
 }
 
+#ifndef FREESCALE_LTC_ECC
+/* for ESP8266:
+   Common part of wc_ed25519_verify_msg_point and wc_ed25519_verify_msg_table,
+   h = H(R,A,M) reduced mod l.
+*/
+static int ed25519_verify_hram(const byte* sig, word32 siglen, const byte* msg,
+                               word32 msglen, int* res, ed25519_key* key,
+                               byte* h)
+{
+    int    ret;
+    wc_Sha512 sha;
+
+    if (sig == NULL || msg == NULL || res == NULL || key == NULL)
+        return BAD_FUNC_ARG;
+
+    *res = 0;
+
+    if (siglen < ED25519_SIG_SIZE || (sig[ED25519_SIG_SIZE-1] & 224))
+        return BAD_FUNC_ARG;
+
+    ret  = wc_InitSha512(&sha);
+    if (ret != 0)
+        return ret;
+    ret = wc_Sha512Update(&sha, sig,    ED25519_SIG_SIZE/2);
+    if (ret != 0)
+        return ret;
+    ret = wc_Sha512Update(&sha, key->p, ED25519_PUB_KEY_SIZE);
+    if (ret != 0)
+        return ret;
+    ret = wc_Sha512Update(&sha, msg,    msglen);
+    if (ret != 0)
+        return ret;
+    ret = wc_Sha512Final(&sha,  h);
+    if (ret != 0)
+        return ret;
+
+    sc_reduce(h);
+    return 0;
+}
+
+static int ed25519_verify_check(const byte* sig, int* res, const ge_p2* R)
+{
+    byte   rcheck[ED25519_KEY_SIZE];
+
+    ge_tobytes(rcheck, R);
+    if (ConstantCompare(rcheck, sig, ED25519_SIG_SIZE/2) != 0)
+        return SIG_VERIFY_E;
+
+    *res = 1;
+    return 0;
+}
+
+/*
+   Same as wc_ed25519_verify_msg, but A is the public key of 'key' already
+   uncompressed and negated (ge_frombytes_negate_vartime).
+*/
+int wc_ed25519_verify_msg_point(const byte* sig, word32 siglen, const byte* msg,
+                                word32 msglen, int* res, ed25519_key* key,
+                                const ge_p3* A)
+{
+    byte   h[WC_SHA512_DIGEST_SIZE];
+    ge_p2  R;
+    int    ret;
+
+    if (A == NULL)
+        return BAD_FUNC_ARG;
+    ret = ed25519_verify_hram(sig, siglen, msg, msglen, res, key, h);
+    if (ret != 0)
+        return ret;
+
+#ifdef ESP_GE_DOUBLE_SCALARMULT_VARTIME_LOWMEM
+    ret = ge_double_scalarmult_vartime_lowmem(&R, h, A, sig + (ED25519_SIG_SIZE/2));
+#else
+    ret = ge_double_scalarmult_vartime(&R, h, A, sig + (ED25519_SIG_SIZE/2));
+#endif
+    if (ret != 0)
+        return ret;
+
+    return ed25519_verify_check(sig, res, &R);
+}
+
+#ifndef ED25519_SMALL
+/*
+   Same as wc_ed25519_verify_msg_point, but with the table
+   Ai = A,3A,...,15A (ge_double_scalarmult_precompute) instead of A.
+   Nothing of A is recomputed and the stack stays free of the table.
+*/
+int wc_ed25519_verify_msg_table(const byte* sig, word32 siglen, const byte* msg,
+                                word32 msglen, int* res, ed25519_key* key,
+                                const ge_cached* Ai)
+{
+    byte   h[WC_SHA512_DIGEST_SIZE];
+    ge_p2  R;
+    int    ret;
+
+    if (Ai == NULL)
+        return BAD_FUNC_ARG;
+    ret = ed25519_verify_hram(sig, siglen, msg, msglen, res, key, h);
+    if (ret != 0)
+        return ret;
+
+    ret = ge_double_scalarmult_vartime_table(&R, h, Ai, sig + (ED25519_SIG_SIZE/2));
+    if (ret != 0)
+        return ret;
+
+    return ed25519_verify_check(sig, res, &R);
+}
+#endif /* !ED25519_SMALL */
+#endif /* !FREESCALE_LTC_ECC */
+
 #endif /* HAVE_ED25519_VERIFY */
 
 
@@ -6639,16 +6639,23 @@ B is the Ed25519 base point (x,4/5) with x positive.
 int ge_double_scalarmult_vartime(ge_p2 *r, const unsigned char *a,
                                  const ge_p3 *A, const unsigned char *b)
 {
-  signed char aslide[256];
-  signed char bslide[256];
-  ge_cached Ai[8]; /* A,3A,5A,7A,9A,11A,13A,15A */
+  ge_cached Ai[GE_DOUBLE_SCALARMULT_TABLE_SIZE]; /* A,3A,5A,7A,9A,11A,13A,15A */
+
+  ge_double_scalarmult_precompute(Ai,A);
+  return ge_double_scalarmult_vartime_table(r,a,Ai,b);
+}
+
+
+/*
+Ai = A,3A,5A,7A,9A,11A,13A,15A
+The table depends on A only and may be kept for later calls of
+ge_double_scalarmult_vartime_table (for ESP8266).
+*/
+void ge_double_scalarmult_precompute(ge_cached *Ai, const ge_p3 *A)
+{
   ge_p1p1 t;
   ge_p3 u;
   ge_p3 A2;
-  int i;
-
-  slide(aslide,a);
-  slide(bslide,b);
 
   ge_p3_to_cached(&Ai[0],A);
   ge_p3_dbl(&t,A); ge_p1p1_to_p3(&A2,&t);
@@ -6659,6 +6666,24 @@ int ge_double_scalarmult_vartime(ge_p2 *r, const unsigned char *a,
   ge_add(&t,&A2,&Ai[4]); ge_p1p1_to_p3(&u,&t); ge_p3_to_cached(&Ai[5],&u);
   ge_add(&t,&A2,&Ai[5]); ge_p1p1_to_p3(&u,&t); ge_p3_to_cached(&Ai[6],&u);
   ge_add(&t,&A2,&Ai[6]); ge_p1p1_to_p3(&u,&t); ge_p3_to_cached(&Ai[7],&u);
+}
+
+
+/*
+r = a * A + b * B
+with Ai precomputed by ge_double_scalarmult_precompute(Ai, A).
+*/
+int ge_double_scalarmult_vartime_table(ge_p2 *r, const unsigned char *a,
+                                       const ge_cached *Ai, const unsigned char *b)
+{
+  signed char aslide[256];
+  signed char bslide[256];
+  ge_p1p1 t;
+  ge_p3 u;
+  int i;
+
+  slide(aslide,a);
+  slide(bslide,b);
 
   ge_p2_0(r);
 
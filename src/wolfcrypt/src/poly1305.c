@@ -1254,12 +1254,31 @@ static void poly1305_blocks(Poly1305* ctx, const unsigned char *m,
     h4 = ctx->h[4];
 
     while (bytes >= POLY1305_BLOCK_SIZE) {
-        /* h += m[i] */
-        h0 += (U8TO32(m+ 0)     ) & 0x3ffffff;
-        h1 += (U8TO32(m+ 3) >> 2) & 0x3ffffff;
-        h2 += (U8TO32(m+ 6) >> 4) & 0x3ffffff;
-        h3 += (U8TO32(m+ 9) >> 6) & 0x3ffffff;
-        h4 += (U8TO32(m+12) >> 8) | hibit;
+        word32 t0,t1,t2,t3;
+
+        /* load the block as four 32 bit words */
+    #ifndef BIG_ENDIAN_ORDER
+        if (((wolfssl_word)m & (sizeof(word32) - 1)) == 0) {
+            t0 = ((const word32*)m)[0];
+            t1 = ((const word32*)m)[1];
+            t2 = ((const word32*)m)[2];
+            t3 = ((const word32*)m)[3];
+        }
+        else
+    #endif
+        {
+            t0 = U8TO32(m+ 0);
+            t1 = U8TO32(m+ 4);
+            t2 = U8TO32(m+ 8);
+            t3 = U8TO32(m+12);
+        }
+
+        /* h += m[i], split into 26 bit limbs */
+        h0 += (  t0                    ) & 0x3ffffff;
+        h1 += ((t0 >> 26) | (t1 <<  6)) & 0x3ffffff;
+        h2 += ((t1 >> 20) | (t2 << 12)) & 0x3ffffff;
+        h3 += ((t2 >> 14) | (t3 << 18)) & 0x3ffffff;
+        h4 += ( t3 >>  8              ) | hibit;
 
         /* h *= r */
         d0 = ((word64)h0 * r0) + ((word64)h1 * s4) + ((word64)h2 * s3) +
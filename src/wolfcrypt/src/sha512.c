@@ -341,7 +341,11 @@ static int InitSha512(wc_Sha512* sha512)
     }
 
 #else
+  #ifdef ESP_SHA512_TRANSFORM_32BIT
+    #define Transform_Sha512(sha512) _Transform_Sha512_32(sha512)
+  #else
     #define Transform_Sha512(sha512) _Transform_Sha512(sha512)
+  #endif
 
     int wc_InitSha512_ex(wc_Sha512* sha512, void* heap, int devId)
     {
@@ -368,8 +372,14 @@ static int InitSha512(wc_Sha512* sha512)
 
 #endif /* Hardware Acceleration */
 
+#ifdef HOMEKIT_FLASH_SIM
+#include "host_shim.h"
+#else
 #include <pgmspace.h>
+#endif
 
+#if !defined(ESP_SHA512_TRANSFORM_32BIT) || defined(HAVE_INTEL_AVX1) || \
+                                                  defined(HAVE_INTEL_AVX2)
 static const PROGMEM word64 K512[80] = {
     W64LIT(0x428a2f98d728ae22), W64LIT(0x7137449123ef65cd),
     W64LIT(0xb5c0fbcfec4d3b2f), W64LIT(0xe9b5dba58189dbbc),
@@ -503,6 +513,179 @@ static int _Transform_Sha512(wc_Sha512* sha512)
 
     return 0;
 }
+#endif /* !ESP_SHA512_TRANSFORM_32BIT || AVX */
+
+
+#ifdef ESP_SHA512_TRANSFORM_32BIT
+/* for ESP8266:
+   The core has no 64-bit operations; every word64 is kept as two word32
+   halves (H = high, L = low), the rotations are written out per half, the
+   round constants are read from flash instead of being copied to the stack,
+   and the schedule of 16 words is computed ahead of the 16 unrolled rounds,
+   so no round tests j ? blk2 : blk0. Rounds 0..15 run ahead of the loop,
+   which has no branch; the round code exists once (Rounds16_Sha512_32).
+*/
+static const PROGMEM word32 K512_32[160] = {
+    0x428a2f98, 0xd728ae22, 0x71374491, 0x23ef65cd,
+    0xb5c0fbcf, 0xec4d3b2f, 0xe9b5dba5, 0x8189dbbc,
+    0x3956c25b, 0xf348b538, 0x59f111f1, 0xb605d019,
+    0x923f82a4, 0xaf194f9b, 0xab1c5ed5, 0xda6d8118,
+    0xd807aa98, 0xa3030242, 0x12835b01, 0x45706fbe,
+    0x243185be, 0x4ee4b28c, 0x550c7dc3, 0xd5ffb4e2,
+    0x72be5d74, 0xf27b896f, 0x80deb1fe, 0x3b1696b1,
+    0x9bdc06a7, 0x25c71235, 0xc19bf174, 0xcf692694,
+    0xe49b69c1, 0x9ef14ad2, 0xefbe4786, 0x384f25e3,
+    0x0fc19dc6, 0x8b8cd5b5, 0x240ca1cc, 0x77ac9c65,
+    0x2de92c6f, 0x592b0275, 0x4a7484aa, 0x6ea6e483,
+    0x5cb0a9dc, 0xbd41fbd4, 0x76f988da, 0x831153b5,
+    0x983e5152, 0xee66dfab, 0xa831c66d, 0x2db43210,
+    0xb00327c8, 0x98fb213f, 0xbf597fc7, 0xbeef0ee4,
+    0xc6e00bf3, 0x3da88fc2, 0xd5a79147, 0x930aa725,
+    0x06ca6351, 0xe003826f, 0x14292967, 0x0a0e6e70,
+    0x27b70a85, 0x46d22ffc, 0x2e1b2138, 0x5c26c926,
+    0x4d2c6dfc, 0x5ac42aed, 0x53380d13, 0x9d95b3df,
+    0x650a7354, 0x8baf63de, 0x766a0abb, 0x3c77b2a8,
+    0x81c2c92e, 0x47edaee6, 0x92722c85, 0x1482353b,
+    0xa2bfe8a1, 0x4cf10364, 0xa81a664b, 0xbc423001,
+    0xc24b8b70, 0xd0f89791, 0xc76c51a3, 0x0654be30,
+    0xd192e819, 0xd6ef5218, 0xd6990624, 0x5565a910,
+    0xf40e3585, 0x5771202a, 0x106aa070, 0x32bbd1b8,
+    0x19a4c116, 0xb8d2d0c8, 0x1e376c08, 0x5141ab53,
+    0x2748774c, 0xdf8eeb99, 0x34b0bcb5, 0xe19b48a8,
+    0x391c0cb3, 0xc5c95a63, 0x4ed8aa4a, 0xe3418acb,
+    0x5b9cca4f, 0x7763e373, 0x682e6ff3, 0xd6b2b8a3,
+    0x748f82ee, 0x5defb2fc, 0x78a5636f, 0x43172f60,
+    0x84c87814, 0xa1f0ab72, 0x8cc70208, 0x1a6439ec,
+    0x90befffa, 0x23631e28, 0xa4506ceb, 0xde82bde9,
+    0xbef9a3f7, 0xb2c67915, 0xc67178f2, 0xe372532b,
+    0xca273ece, 0xea26619c, 0xd186b8c7, 0x21c0c207,
+    0xeada7dd6, 0xcde0eb1e, 0xf57d4f7f, 0xee6ed178,
+    0x06f067aa, 0x72176fba, 0x0a637dc5, 0xa2c898a6,
+    0x113f9804, 0xbef90dae, 0x1b710b35, 0x131c471b,
+    0x28db77f5, 0x23047d84, 0x32caab7b, 0x40c72493,
+    0x3c9ebe0a, 0x15c9bebc, 0x431d67c4, 0x9c100d4c,
+    0x4cc5d4be, 0xcb3e42b6, 0x597f299c, 0xfc657e2a,
+    0x5fcb6fab, 0x3ad6faec, 0x6c44198c, 0x4a475817
+};
+
+/* (h,l) += (bh,bl) */
+#define ADD32x2(h,l,bh,bl) do { \
+        word32 _l = (l) + (bl); \
+        (h) += (bh) + (_l < (bl)); \
+        (l) = _l; \
+    } while (0)
+
+/* word i of the state, rotated by round r; even index high, odd index low */
+#define TH(i,r) T[(((i) - (r)) & 7) * 2]
+#define TL(i,r) T[(((i) - (r)) & 7) * 2 + 1]
+#define WH(i)   W[((i) & 15) * 2]
+#define WL(i)   W[((i) & 15) * 2 + 1]
+
+/* Sigma0: rotr 28, 34, 39 */
+#define S0H(h,l) (((h) >> 28 | (l) << 4) ^ ((l) >> 2 | (h) << 30) ^ ((l) >> 7 | (h) << 25))
+#define S0L(h,l) (((l) >> 28 | (h) << 4) ^ ((h) >> 2 | (l) << 30) ^ ((h) >> 7 | (l) << 25))
+/* Sigma1: rotr 14, 18, 41 */
+#define S1H(h,l) (((h) >> 14 | (l) << 18) ^ ((h) >> 18 | (l) << 14) ^ ((l) >> 9 | (h) << 23))
+#define S1L(h,l) (((l) >> 14 | (h) << 18) ^ ((l) >> 18 | (h) << 14) ^ ((h) >> 9 | (l) << 23))
+/* sigma0: rotr 1, 8, shr 7 */
+#define s0H(h,l) (((h) >> 1 | (l) << 31) ^ ((h) >> 8 | (l) << 24) ^ ((h) >> 7))
+#define s0L(h,l) (((l) >> 1 | (h) << 31) ^ ((l) >> 8 | (h) << 24) ^ ((l) >> 7 | (h) << 25))
+/* sigma1: rotr 19, 61, shr 6 */
+#define s1H(h,l) (((h) >> 19 | (l) << 13) ^ ((l) >> 29 | (h) << 3) ^ ((h) >> 6))
+#define s1L(h,l) (((l) >> 19 | (h) << 13) ^ ((h) >> 29 | (l) << 3) ^ ((l) >> 6 | (h) << 26))
+
+#define Ch32(x,y,z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define Maj32(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+/* message schedule for rounds 16..79 */
+#define BLK2_32(i) do { \
+        word32 _h = WH((i)-2), _l = WL((i)-2); \
+        word32 _xh = s1H(_h,_l), _xl = s1L(_h,_l); \
+        ADD32x2(WH(i), WL(i), _xh, _xl); \
+        ADD32x2(WH(i), WL(i), WH((i)-7), WL((i)-7)); \
+        _h = WH((i)-15); _l = WL((i)-15); \
+        _xh = s0H(_h,_l); _xl = s0L(_h,_l); \
+        ADD32x2(WH(i), WL(i), _xh, _xl); \
+    } while (0)
+
+/* round i of the current 16, K points to the constants of round j+i */
+#define R32(i) do { \
+        word32 _eh = TH(4,i), _el = TL(4,i); \
+        word32 _ah = TH(0,i), _al = TL(0,i); \
+        word32 _th = TH(7,i), _tl = TL(7,i); \
+        word32 _xh, _xl; \
+        _xh = S1H(_eh,_el); _xl = S1L(_eh,_el); \
+        ADD32x2(_th, _tl, _xh, _xl); \
+        _xh = Ch32(_eh, TH(5,i), TH(6,i)); _xl = Ch32(_el, TL(5,i), TL(6,i)); \
+        ADD32x2(_th, _tl, _xh, _xl); \
+        _xh = pgm_read_dword(&K[(i) * 2]); _xl = pgm_read_dword(&K[(i) * 2 + 1]); \
+        ADD32x2(_th, _tl, _xh, _xl); \
+        ADD32x2(_th, _tl, WH(i), WL(i)); \
+        ADD32x2(TH(3,i), TL(3,i), _th, _tl); \
+        _xh = S0H(_ah,_al); _xl = S0L(_ah,_al); \
+        ADD32x2(_th, _tl, _xh, _xl); \
+        _xh = Maj32(_ah, TH(1,i), TH(2,i)); _xl = Maj32(_al, TL(1,i), TL(2,i)); \
+        ADD32x2(_th, _tl, _xh, _xl); \
+        TH(7,i) = _th; TL(7,i) = _tl; \
+    } while (0)
+
+#define R32_16() \
+    R32( 0); R32( 1); R32( 2); R32( 3); \
+    R32( 4); R32( 5); R32( 6); R32( 7); \
+    R32( 8); R32( 9); R32(10); R32(11); \
+    R32(12); R32(13); R32(14); R32(15)
+
+/* one statement */
+#define BLK2_32_16() do { \
+        BLK2_32( 0); BLK2_32( 1); BLK2_32( 2); BLK2_32( 3); \
+        BLK2_32( 4); BLK2_32( 5); BLK2_32( 6); BLK2_32( 7); \
+        BLK2_32( 8); BLK2_32( 9); BLK2_32(10); BLK2_32(11); \
+        BLK2_32(12); BLK2_32(13); BLK2_32(14); BLK2_32(15); \
+    } while (0)
+
+/* 16 rounds; one copy of the round code for all 80 rounds */
+static void Rounds16_Sha512_32(word32* T, const word32* W, const word32* K)
+{
+    R32_16();
+}
+
+static int _Transform_Sha512_32(wc_Sha512* sha512)
+{
+    const word32* K = K512_32;
+    word32 T[16];
+    word32 W[32];
+    int i;
+    int j;
+
+    for (i = 0; i < 8; i++) {
+        T[i * 2]     = (word32)(sha512->digest[i] >> 32);
+        T[i * 2 + 1] = (word32)sha512->digest[i];
+    }
+    for (i = 0; i < 16; i++) {
+        W[i * 2]     = (word32)(sha512->buffer[i] >> 32);
+        W[i * 2 + 1] = (word32)sha512->buffer[i];
+    }
+
+    /* rounds 0..15 use the block */
+    Rounds16_Sha512_32(T, W, K);
+    /* rounds 16..79: the next 16 schedule words, then 16 rounds */
+    for (j = 16; j < 80; j += 16) {
+        K += 32;
+        BLK2_32_16();
+        Rounds16_Sha512_32(T, W, K);
+    }
+
+    for (i = 0; i < 8; i++) {
+        sha512->digest[i] += ((word64)T[i * 2] << 32) | T[i * 2 + 1];
+    }
+
+    /* Wipe variables */
+    ForceZero(W, sizeof(W));
+    ForceZero(T, sizeof(T));
+
+    return 0;
+}
+#endif /* ESP_SHA512_TRANSFORM_32BIT */
 
 
 static INLINE void AddLength(wc_Sha512* sha512, word32 len)
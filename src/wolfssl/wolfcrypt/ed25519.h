@@ -87,6 +87,20 @@ int wc_ed25519_sign_msg(const byte* in, word32 inlen, byte* out,
 WOLFSSL_API
 int wc_ed25519_verify_msg(const byte* sig, word32 siglen, const byte* msg,
                           word32 msglen, int* stat, ed25519_key* key);
+#ifndef FREESCALE_LTC_ECC
+/* for ESP8266: verify with the public key already uncompressed and negated
+   by ge_frombytes_negate_vartime, optionally with its precomputed table */
+WOLFSSL_API
+int wc_ed25519_verify_msg_point(const byte* sig, word32 siglen, const byte* msg,
+                          word32 msglen, int* stat, ed25519_key* key,
+                          const ge_p3* A);
+#ifndef ED25519_SMALL
+WOLFSSL_API
+int wc_ed25519_verify_msg_table(const byte* sig, word32 siglen, const byte* msg,
+                          word32 msglen, int* stat, ed25519_key* key,
+                          const ge_cached* Ai);
+#endif
+#endif
 WOLFSSL_API
 int wc_ed25519_init(ed25519_key* key);
 WOLFSSL_API
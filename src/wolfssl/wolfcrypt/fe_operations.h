@@ -139,7 +139,9 @@ static const byte f25519_zero[F25519_SIZE]   = {0};
 static const byte f25519_one[F25519_SIZE]    = {1};
 static const byte fprime_zero[F25519_SIZE]   = {0};
 static const byte fprime_one[F25519_SIZE]    = {1};
+#endif
 
+#if defined(CURVE25519_SMALL) || defined(ED25519_SMALL) || defined(ESP_GE_DOUBLE_SCALARMULT_VARTIME_LOWMEM)
 WOLFSSL_LOCAL void fe_load(byte *x, word32 c);
 WOLFSSL_LOCAL void fe_normalize(byte *x);
 WOLFSSL_LOCAL void fe_inv__distinct(byte *r, const byte *x);
@@ -107,6 +107,12 @@ typedef struct {
   ge T2d;
 } ge_cached;
 
+// for ESP8266: double scalar mult with a caller-owned table A,3A,...,15A
+#define GE_DOUBLE_SCALARMULT_TABLE_SIZE 8
+WOLFSSL_LOCAL void ge_double_scalarmult_precompute(ge_cached *,const ge_p3 *);
+WOLFSSL_LOCAL int  ge_double_scalarmult_vartime_table(ge_p2 *,const unsigned char *,
+                                         const ge_cached *,const unsigned char *);
+
 #endif /* !ED25519_SMALL */
 
 #endif /* HAVE_ED25519 */
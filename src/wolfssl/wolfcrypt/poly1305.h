@@ -45,8 +45,11 @@
 #define WC_HAS_GCC_4_4_64BIT
 #endif
 
+/* ESP_POLY1305_32BIT: the 32-bit implementation (as on the ESP8266) on a
+ * 64-bit host, see test/host */
 #ifdef USE_INTEL_SPEEDUP
-#elif (defined(WC_HAS_SIZEOF_INT128_64BIT) || defined(WC_HAS_MSVC_64BIT) ||  \
+#elif !defined(ESP_POLY1305_32BIT) && \
+      (defined(WC_HAS_SIZEOF_INT128_64BIT) || defined(WC_HAS_MSVC_64BIT) ||  \
        defined(WC_HAS_GCC_4_4_64BIT))
 #define POLY130564
 #else
@@ -0,0 +1,138 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>bench_verify_cache.c<< 19 Okt 2026  17:21:36 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include <stdlib.h>
+#include "port.h"
+#include "storage.h"
+#include "host_shim.h"
+#include "host_test.h"
+
+#pragma endregion
+
+/* Ed25519 verify of a stored pairing, as in pair-verify, with and without
+* the verify cache of storage.c (homekit_storage_pairing_verify_cache).
+* Without the cache the public key is decompressed on every verify and the
+* engine depends on the free heap/stack at that moment (transient heap
+* table, stack table or low-mem). The cache keeps the uncompressed point and,
+* for up to CRYPTO_ED25519_MAX_CACHED_TABLES pairings, the precomputed table
+* built on the first verify while the heap allows it.
+*/
+
+#pragma region Definitions
+#define MIN_TIME_US 200000
+#define N_PAIRINGS 4
+
+static char gbIds[N_PAIRINGS][DEVICE_ID_SIZE + 1];
+static ed25519_key gbKeys[N_PAIRINGS];
+static byte gbMessage[100];
+static byte gbSignatures[N_PAIRINGS][64];
+
+static void setup_pairings()
+{
+  homekit_flash_sim_reset();
+  homekit_storage_init();
+  for(size_t i = 0; i < sizeof(gbMessage); ++i)
+    gbMessage[i] = (byte)rand();
+
+  for(int i = 0; i < N_PAIRINGS; ++i)
+  {
+    ed25519_key Public;
+    byte Buf[32];
+    size_t Size = sizeof(Buf);
+    crypto_ed25519_generate(&gbKeys[i]);
+    crypto_ed25519_export_public_key(&gbKeys[i], Buf, &Size);
+    crypto_ed25519_init(&Public);
+    crypto_ed25519_import_public_key(&Public, Buf, Size);
+    snprintf(gbIds[i], sizeof(gbIds[i]), "%08X-0000-4000-8000-%012d", i * 7919, i);
+    homekit_storage_add_pairing(gbIds[i], &Public, 1);
+
+    Size = sizeof(gbSignatures[i]);
+    crypto_ed25519_sign(&gbKeys[i], gbMessage, sizeof(gbMessage), gbSignatures[i], &Size);
+  }
+}
+
+#pragma endregion
+
+#pragma region Benchmark
+typedef int (*verify_fn)(const pairing_t* p, const byte* sig, size_t message_size);
+
+static int verify_uncached(const pairing_t* p, const byte* sig, size_t message_size)
+{
+  return crypto_ed25519_verify(&p->device_key, gbMessage, message_size, sig, 64);
+}
+
+static int verify_cached(const pairing_t* p, const byte* sig, size_t message_size)
+{
+  return crypto_ed25519_verify_cached(homekit_storage_pairing_verify_cache(p), gbMessage, message_size, sig, 64);
+}
+
+/* @return us per verify, repeated for at least MIN_TIME_US
+*/
+static uint32_t time_verify(verify_fn fn, const pairing_t* p, const byte* sig)
+{
+  uint32_t Runs = 0, Elapsed;
+  uint32_t Start = micros();
+  do
+  {
+    CHECK_EQ(fn(p, sig, sizeof(gbMessage)), 0);
+    ++Runs;
+    Elapsed = micros() - Start;
+  } while(Elapsed < MIN_TIME_US);
+  return Elapsed / Runs;
+}
+
+static void bench_pairing(int index, uint32_t freeHeap, size_t freeStack, const char* what)
+{
+  pairing_t P;
+  CHECK_EQ(homekit_storage_find_pairing(gbIds[index], &P), 0);
+  const byte* Sig = gbSignatures[index];
+
+  host_free_heap = freeHeap;
+  host_free_stack = freeStack;
+
+  uint32_t Uncached = time_verify(verify_uncached, &P, Sig);
+  uint32_t Start = micros();
+  CHECK_EQ(verify_cached(&P, Sig, sizeof(gbMessage)), 0);
+  uint32_t First = micros() - Start;
+  uint32_t Cached = time_verify(verify_cached, &P, Sig);
+
+  printf("%-40s %9u %9u %9u\n", what, Uncached, First, Cached);
+
+  // a wrong signature or message is still rejected
+  byte Bad[64];
+  memcpy(Bad, Sig, sizeof(Bad));
+  Bad[index * 7 % 64] ^= 0x10;
+  CHECK(verify_cached(&P, Bad, sizeof(gbMessage)) != 0);
+  CHECK(verify_cached(&P, Sig, sizeof(gbMessage) - 1) != 0);
+
+  host_free_heap = 40000;
+  host_free_stack = 8000;
+}
+
+#pragma endregion
+
+int main()
+{
+  srand(1);
+  host_log_enabled = false;
+  setup_pairings();
+
+  printf("Ed25519 verify of a stored pairing, us/op\n");
+  printf("%-40s %9s %9s %9s\n", "pairing, free heap/stack", "uncached", "1st cache", "cached");
+
+  bench_pairing(0, 40000, 8000, "#0 40 KB / 8 KB (table cached)");
+  bench_pairing(1, 40000, 8000, "#1 40 KB / 8 KB (table cached)");
+  bench_pairing(2, 40000, 8000, "#2 40 KB / 8 KB (table limit)");
+  bench_pairing(3, 3000, 8000, "#3 3 KB / 8 KB (point only)");
+  bench_pairing(0, 3000, 2000, "#0 3 KB / 2 KB (table cached)");
+  bench_pairing(3, 3000, 2000, "#3 3 KB / 2 KB (point only)");
+
+  return HOST_TEST_RESULT();
+}
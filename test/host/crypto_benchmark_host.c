@@ -0,0 +1,38 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>crypto_benchmark_host.c<< 19 Okt 2026  17:08:14 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <stdlib.h>
+#include "crypto_benchmark.h"
+#include "host_test.h"
+
+#pragma endregion
+
+/* Host run of crypto_benchmark.c, the counterpart of the /crypto menu
+* (hb_crypto_menu.cpp). Prints one line per case; fails if a case returns
+* an error. Cycles and peak stack/heap are not known on a host and not printed.
+*/
+int main()
+{
+  srand(1);
+  printf("%s\n", crypto_benchmark_config());
+  printf("%-36s %10s %8s %10s %6s\n", "case", "us/op", "ops", "bytes", "result");
+
+  host_log_enabled = false;
+  crypto_benchmark_result_t R;
+  for(int i = 0; crypto_benchmark_run(i, &R); ++i)
+  {
+    printf("%-36s %10u %8u %10u %6d\n", R.name, R.us_per_op, R.ops, R.bytes, R.result);
+    CHECK_EQ(R.result, 0);
+  }
+  crypto_benchmark_done();
+  host_log_enabled = true;
+
+  printf("%d cases\n", crypto_benchmark_count());
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>host_support.cpp<< 19 Okt 2026  15:31:12 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <stdarg.h>
+#include "host_shim.h"
+#include "homekit_debug.h"
+#include "port.h"
+#include "watchdog.h"
+#include "host_test.h"
+
+#pragma endregion
+
+/* Host versions of the functions declared in host_shim.h and of the
+* port.c/watchdog.c functions used by storage.c, crypto.c and hb_storage.cpp.
+*/
+
+#pragma region Environment
+int host_test_failures = 0;
+uint32_t host_free_heap = 40000;
+size_t host_free_stack = 8000;
+bool host_log_enabled = true;
+
+#pragma endregion
+
+#pragma region Log Functions
+static void host_log(const char* level, const char* format, va_list args)
+{
+  if(!host_log_enabled)
+    return;
+  printf("%s\t", level);
+  vprintf(format, args);
+  printf("\n");
+}
+
+#define HOST_LOG_FUNCTION(name, level) \
+  void name(PGM_P format, ...) { va_list Args; va_start(Args, format); host_log(level, format, Args); va_end(Args); }
+
+HOST_LOG_FUNCTION(VerbosePrintf_P, "Verbose:")
+HOST_LOG_FUNCTION(InfoPrintf_P, "Info:")
+HOST_LOG_FUNCTION(WarnPrintf_P, "Warn:")
+HOST_LOG_FUNCTION(ErrorPrintf_P, "Error:")
+
+#undef HOST_LOG_FUNCTION
+
+#pragma endregion
+
+#pragma region SDK / port.c / watchdog.c
+/* rand() based: the tests are deterministic, see srand.
+*/
+int os_get_random(unsigned char* buf, size_t len)
+{
+  for(size_t i = 0; i < len; ++i)
+    buf[i] = static_cast<unsigned char>(rand());
+  return 0;
+}
+
+uint32_t system_get_free_heap_size()
+{
+  return host_free_heap;
+}
+
+uint32_t homekit_random()
+{
+  uint32_t Value;
+  os_get_random(reinterpret_cast<unsigned char*>(&Value), sizeof(Value));
+  return Value;
+}
+
+void homekit_random_fill(uint8_t* data, size_t size)
+{
+  os_get_random(data, size);
+}
+
+size_t homekit_free_stack()
+{
+  return host_free_stack;
+}
+
+void watchdog_disable_all() {}
+void watchdog_enable_all() {}
+void watchdog_check_begin() {}
+void watchdog_check_end(const char*) {}
+
+#pragma endregion
+
+#pragma region coredecls.h / Serial
+/* As the ESP8266 core (MSB first, no final xor), so flash images match.
+*/
+uint32_t crc32(const void* data, size_t length, uint32_t crc)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while(length--)
+  {
+    uint8_t c = *p++;
+    for(uint32_t i = 0x80; i > 0; i >>= 1)
+    {
+      bool Bit = (crc & 0x80000000) != 0;
+      if(c & i)
+        Bit = !Bit;
+      crc <<= 1;
+      if(Bit)
+        crc ^= 0x04c11db7;
+    }
+  }
+  return crc;
+}
+
+CHostSerial Serial;
+
+size_t CHostSerial::printf(const char* format, ...)
+{
+  va_list Args;
+  va_start(Args, format);
+  int n = vprintf(format, Args);
+  va_end(Args);
+  return n < 0 ? 0 : static_cast<size_t>(n);
+}
+
+size_t CHostSerial::println(const char* text)
+{
+  return static_cast<size_t>(::printf("%s\n", text));
+}
+
+#pragma endregion
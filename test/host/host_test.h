@@ -0,0 +1,58 @@
+#pragma region Prolog
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>host_test.h<< 19 Okt 2026  15:31:12 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma endregion
+
+#pragma region Checks
+/* A failed check is reported and counted, the test goes on.
+* main returns HOST_TEST_RESULT(), i.e. 0 if all checks passed.
+*/
+extern int host_test_failures;
+
+#define CHECK(cond) \
+  do { if(!(cond)) { ++host_test_failures; printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while(0)
+
+#define CHECK_EQ(a, b) \
+  do { long long _a = (long long)(a), _b = (long long)(b); \
+    if(_a != _b) { ++host_test_failures; printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while(0)
+
+#define HOST_TEST_RESULT() (printf("%s: %d failed checks\n", __FILE__, host_test_failures), host_test_failures != 0)
+
+#pragma endregion
+
+#pragma region Environment
+/* Values reported by system_get_free_heap_size and homekit_free_stack.
+*/
+extern uint32_t host_free_heap;
+extern size_t host_free_stack;
+
+/* false: VERBOSE/INFO/WARN/ERROR print nothing, e.g. in power fail loops.
+*/
+extern bool host_log_enabled;
+
+#pragma endregion
+
+#pragma region Epilog
+#ifdef __cplusplus
+}
+#endif
+#endif // __HOST_TEST_H__
+
+#pragma endregion
@@ -0,0 +1,22 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>sha512_default.c<< 19 Okt 2026  18:05:12 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+
+/* sha512.c with the default transform and renamed entry points
+* (default_Sha512...), linked into test_sha512_32bit next to the 32-bit
+* transform to compare digests and times in one run.
+*/
+#undef ESP_SHA512_TRANSFORM_32BIT
+#define wc_InitSha512     default_InitSha512
+#define wc_InitSha512_ex  default_InitSha512_ex
+#define wc_Sha512Update   default_Sha512Update
+#define wc_Sha512Final    default_Sha512Final
+#define wc_Sha512Free     default_Sha512Free
+#define wc_Sha512GetHash  default_Sha512GetHash
+#define wc_Sha512Copy     default_Sha512Copy
+#include "wolfcrypt/src/sha512.c"
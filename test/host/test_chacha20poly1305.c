@@ -0,0 +1,185 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>test_chacha20poly1305.c<< 19 Okt 2026  18:42:05 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include "user_settings.h"
+#include <wolfssl/wolfcrypt/poly1305.h>
+#include "crypto.h"
+#include "host_shim.h"
+#include "host_test.h"
+
+#pragma endregion
+
+/* ChaCha20-Poly1305 AEAD of crypto.c (HAP frames), RFC 8439 test vectors.
+* Built once with the implementation of the host (test_chacha20poly1305,
+* POLY130564 on 64-bit) and once with ESP_POLY1305_32BIT
+* (test_chacha20poly1305_32bit), the POLY130532 code of the ESP8266.
+*/
+
+#pragma region Definitions
+static void from_hex(byte* out, const char* hex)
+{
+  for(; hex[0] && hex[1]; hex += 2)
+  {
+    unsigned v;
+    sscanf(hex, "%2x", &v);
+    *out++ = (byte)v;
+  }
+}
+
+static void check_bytes(const byte* got, const char* expected, const char* what)
+{
+  byte Want[256];
+  size_t Size = strlen(expected) / 2;
+  from_hex(Want, expected);
+  if(memcmp(got, Want, Size) != 0)
+  {
+    CHECK(!"bytes differ");
+    printf("  %s\n", what);
+  }
+}
+
+// RFC 8439 2.8.2
+static const char* const Key =
+  "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f";
+static const char* const Nonce = "070000004041424344454647";
+static const char* const Aad = "50515253c0c1c2c3c4c5c6c7";
+static const char* const Plaintext =
+  "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+  "for the future, sunscreen would be it.";
+static const char* const Ciphertext =
+  "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+  "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+  "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+  "3ff4def08e4b7a9de576d26586cec64b6116";
+static const char* const Tag = "1ae10b594f09e26a7e902ecbd0600691";
+
+#pragma endregion
+
+#pragma region Poly1305
+// RFC 8439 2.5.2
+static void test_poly1305()
+{
+  byte K[32], Out[16];
+  from_hex(K, "85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b");
+  const char* Msg = "Cryptographic Forum Research Group";
+
+  Poly1305 P;
+  CHECK_EQ(wc_Poly1305SetKey(&P, K, sizeof(K)), 0);
+  CHECK_EQ(wc_Poly1305Update(&P, (const byte*)Msg, (word32)strlen(Msg)), 0);
+  CHECK_EQ(wc_Poly1305Final(&P, Out), 0);
+  check_bytes(Out, "a8061dc1305136c6c22b8baf0c0127a9", "Poly1305 tag");
+}
+
+#pragma endregion
+
+#pragma region AEAD
+static void test_aead()
+{
+  byte K[32], N[12], A[12], Buf[256], Out[256];
+  from_hex(K, Key);
+  from_hex(N, Nonce);
+  from_hex(A, Aad);
+  const size_t Size = strlen(Plaintext);
+
+  // encrypt: ciphertext and tag behind it
+  size_t OutSize = sizeof(Out);
+  CHECK_EQ(crypto_chacha20poly1305_encrypt(K, N, A, sizeof(A), (const byte*)Plaintext, Size, Out, &OutSize), 0);
+  CHECK_EQ(OutSize, Size + 16);
+  check_bytes(Out, Ciphertext, "ciphertext");
+  check_bytes(Out + Size, Tag, "tag");
+
+  // in place, data at every alignment
+  for(int Align = 0; Align < 4; ++Align)
+  {
+    byte* Data = Buf + Align;
+    memcpy(Data, Plaintext, Size);
+    CHECK_EQ(crypto_chacha20poly1305_encrypt_inplace(K, N, A, sizeof(A), Data, Size, Data + Size), 0);
+    CHECK(memcmp(Data, Out, Size + 16) == 0);
+
+    CHECK_EQ(crypto_chacha20poly1305_decrypt_inplace(K, N, A, sizeof(A), Data, Size, Data + Size), 0);
+    CHECK(memcmp(Data, Plaintext, Size) == 0);
+  }
+
+  // decrypt
+  byte Plain[256];
+  size_t PlainSize = sizeof(Plain);
+  CHECK_EQ(crypto_chacha20poly1305_decrypt(K, N, A, sizeof(A), Out, Size + 16, Plain, &PlainSize), 0);
+  CHECK_EQ(PlainSize, Size);
+  CHECK(memcmp(Plain, Plaintext, Size) == 0);
+
+  // a changed ciphertext, tag or AAD is rejected
+  memcpy(Buf, Out, Size + 16);
+  Buf[17] ^= 0x01;
+  CHECK(crypto_chacha20poly1305_decrypt_inplace(K, N, A, sizeof(A), Buf, Size, Buf + Size) != 0);
+  memcpy(Buf, Out, Size + 16);
+  Buf[Size + 15] ^= 0x80;
+  CHECK(crypto_chacha20poly1305_decrypt_inplace(K, N, A, sizeof(A), Buf, Size, Buf + Size) != 0);
+  memcpy(Buf, Out, Size + 16);
+  A[0] ^= 0x01;
+  CHECK(crypto_chacha20poly1305_decrypt_inplace(K, N, A, sizeof(A), Buf, Size, Buf + Size) != 0);
+}
+
+#pragma endregion
+
+#pragma region Frame sizes
+/* HAP frames of 1..1024 bytes (2 byte length as AAD), in place and into a
+* second buffer, decrypted in place.
+*/
+static void test_frame_sizes()
+{
+  static byte Frame[2 + 1024 + 16 + 3], Ref[1024 + 16];
+  byte K[32], N[12];
+  from_hex(K, Key);
+  memset(N, 0, sizeof(N));
+
+  int Mismatches = 0;
+  for(size_t Size = 1; Size <= 1024; ++Size)
+  {
+    N[4] = (byte)Size;
+    N[5] = (byte)(Size >> 8);
+    byte* F = Frame + Size % 4;
+    F[0] = (byte)Size;
+    F[1] = (byte)(Size >> 8);
+    byte* Data = F + 2;
+    for(size_t i = 0; i < Size; ++i)
+      Data[i] = (byte)(i * 31 + Size);
+
+    size_t RefSize = sizeof(Ref);
+    crypto_chacha20poly1305_encrypt(K, N, F, 2, Data, Size, Ref, &RefSize);
+    crypto_chacha20poly1305_encrypt_inplace(K, N, F, 2, Data, Size, Data + Size);
+    if(memcmp(Data, Ref, Size + 16) != 0)
+      ++Mismatches;
+
+    if(crypto_chacha20poly1305_decrypt_inplace(K, N, F, 2, Data, Size, Data + Size) != 0)
+      ++Mismatches;
+    for(size_t i = 0; i < Size; ++i)
+      if(Data[i] != (byte)(i * 31 + Size))
+      {
+        ++Mismatches;
+        break;
+      }
+  }
+  CHECK_EQ(Mismatches, 0);
+}
+
+#pragma endregion
+
+int main()
+{
+  #if defined(POLY130532)
+  printf("POLY130532\n");
+  #elif defined(POLY130564)
+  printf("POLY130564\n");
+  #endif
+  test_poly1305();
+  test_aead();
+  test_frame_sizes();
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,156 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>test_flash_sim.c<< 19 Okt 2026  15:40:27 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include "port.h"
+#include "constants.h"
+#include "storage.h"
+#include "host_test.h"
+
+#pragma endregion
+
+#define SEC SPI_FLASH_SEC_SIZE
+
+#pragma region NOR semantics
+static void test_nor()
+{
+  homekit_flash_sim_reset();
+  uint8_t* Flash = homekit_flash_sim_data();
+  CHECK_EQ(Flash[0], 0xff);
+  CHECK_EQ(Flash[HOMEKIT_FLASH_SIM_SECTORS * SEC - 1], 0xff);
+
+  // a write only clears bits
+  uint8_t A[4] = { 0xf0, 0x0f, 0x55, 0x00 };
+  uint8_t B[4] = { 0x3c, 0xff, 0xff, 0xff };
+  CHECK(homekit_flash_sim_write(SEC + 8, A, sizeof(A)));
+  CHECK(homekit_flash_sim_write(SEC + 8, B, sizeof(B)));
+  uint8_t R[4];
+  CHECK(homekit_flash_sim_read(SEC + 8, R, sizeof(R)));
+  CHECK_EQ(R[0], 0x30);
+  CHECK_EQ(R[1], 0x0f);
+  CHECK_EQ(R[2], 0x55);
+  CHECK_EQ(R[3], 0x00);
+
+  // an erase sets the whole sector (any address in it) to 0xff
+  CHECK(homekit_flash_sim_erase_sector(SEC + 100));
+  CHECK(homekit_flash_sim_read(SEC + 8, R, sizeof(R)));
+  CHECK_EQ(R[0], 0xff);
+  CHECK_EQ(R[3], 0xff);
+
+  // out of range
+  CHECK(!homekit_flash_sim_read(HOMEKIT_FLASH_SIM_SECTORS * SEC - 2, R, sizeof(R)));
+  CHECK(!homekit_flash_sim_write(HOMEKIT_FLASH_SIM_SECTORS * SEC, A, 1));
+  CHECK(!homekit_flash_sim_erase_sector(HOMEKIT_FLASH_SIM_SECTORS * SEC));
+}
+
+#pragma endregion
+
+#pragma region Counters
+static void test_counters()
+{
+  homekit_flash_sim_reset();
+  uint8_t D[16];
+  memset(D, 0, sizeof(D));
+  homekit_flash_sim_write(2 * SEC, D, sizeof(D));
+  homekit_flash_sim_write(2 * SEC + 16, D, 8);
+  homekit_flash_sim_erase_sector(2 * SEC);
+  homekit_flash_sim_erase_sector(3 * SEC);
+
+  const homekit_flash_sim_sector_t* S = homekit_flash_sim_sector(2);
+  CHECK_EQ(S->writes, 2);
+  CHECK_EQ(S->bytes_written, 24);
+  CHECK_EQ(S->erases, 1);
+  CHECK_EQ(homekit_flash_sim_sector(3)->erases, 1);
+  CHECK_EQ(homekit_flash_sim_sector(0)->writes, 0);
+  CHECK(homekit_flash_sim_sector(-1) == NULL);
+  CHECK(homekit_flash_sim_sector(HOMEKIT_FLASH_SIM_SECTORS) == NULL);
+
+  homekit_flash_sim_reset();
+  CHECK_EQ(homekit_flash_sim_sector(2)->writes, 0);
+}
+
+#pragma endregion
+
+#pragma region Power fail
+static void test_power_fail()
+{
+  homekit_flash_sim_reset();
+  uint8_t D[8];
+  memset(D, 0, sizeof(D));
+
+  // the write reaching the budget is cut after its first bytes
+  homekit_flash_sim_power_fail_after(3);
+  homekit_flash_sim_write(0, D, sizeof(D));
+  CHECK(homekit_flash_sim_power_failed());
+  uint8_t R[8];
+  homekit_flash_sim_read(0, R, sizeof(R));
+  CHECK_EQ(R[2], 0x00);
+  CHECK_EQ(R[3], 0xff);
+
+  // later operations are ignored
+  homekit_flash_sim_write(SEC, D, sizeof(D));
+  homekit_flash_sim_erase_sector(0);
+  homekit_flash_sim_read(SEC, R, sizeof(R));
+  CHECK_EQ(R[0], 0xff);
+  homekit_flash_sim_read(0, R, sizeof(R));
+  CHECK_EQ(R[0], 0x00);
+
+  homekit_flash_sim_power_on();
+  CHECK(!homekit_flash_sim_power_failed());
+  homekit_flash_sim_write(SEC, D, sizeof(D));
+  homekit_flash_sim_read(SEC, R, sizeof(R));
+  CHECK_EQ(R[7], 0x00);
+
+  // a cut erase leaves the sector partly erased
+  memset(homekit_flash_sim_data() + 4 * SEC, 0, SEC);
+  homekit_flash_sim_power_fail_after(1);
+  homekit_flash_sim_erase_sector(4 * SEC);
+  CHECK(homekit_flash_sim_power_failed());
+  CHECK_EQ(homekit_flash_sim_data()[4 * SEC], 0xff);
+  CHECK_EQ(homekit_flash_sim_data()[5 * SEC - 1], 0x00);
+  homekit_flash_sim_power_on();
+}
+
+#pragma endregion
+
+#pragma region Storage on the simulator
+/* storage.c builds against port.h/flash_sim.h and keeps its data on a "reboot".
+*/
+static void test_storage()
+{
+  homekit_flash_sim_reset();
+  CHECK_EQ(homekit_storage_init(), 1); // formatted
+  homekit_storage_save_accessory_id("12:34:56:78:9A:BC");
+
+  CHECK_EQ(homekit_storage_init(), 0);
+  char Id[ACCESSORY_ID_SIZE + 1];
+  memset(Id, 0, sizeof(Id));
+  CHECK_EQ(homekit_storage_load_accessory_id(Id), 0);
+  CHECK(strcmp(Id, "12:34:56:78:9A:BC") == 0);
+
+  // the file system below the common pages is not touched
+  for(int s = 0; s < HOMEKIT_FLASH_SIM_SECTORS; ++s)
+  {
+    const homekit_flash_sim_sector_t* S = homekit_flash_sim_sector(s);
+    uint32_t Addr = (uint32_t)s * SEC;
+    if(Addr < HOMEKIT_FLASH_SIM_FS_END_ADDR - HOMEKIT_STORAGE_COMMON_PAGES * SEC)
+      CHECK_EQ(S->writes + S->erases, 0);
+  }
+}
+
+#pragma endregion
+
+int main()
+{
+  test_nor();
+  test_counters();
+  test_power_fail();
+  test_storage();
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,360 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>test_pairing_log.c<< 19 Okt 2026  16:02:48 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include <stdlib.h>
+#include "port.h"
+#include "storage.h"
+#include "host_test.h"
+
+#pragma endregion
+
+/* Pairing log of storage.c (append-only records, two sectors) on the
+* flash simulator: erases per 1000 pairing operations, compared with the
+* fixed layout of older versions, and recovery after a power fail at
+* every byte.
+*/
+
+#pragma region Definitions
+#define SEC SPI_FLASH_SEC_SIZE
+#define N_IDS 16
+#define ACCESSORY_ID "12:34:56:78:9A:BC"
+
+static ed25519_key gbKeys[N_IDS];
+static char gbIds[N_IDS][DEVICE_ID_SIZE + 1];
+
+static void make_ids()
+{
+  for(int i = 0; i < N_IDS; ++i)
+  {
+    ed25519_key Key;
+    byte Public[32];
+    size_t Size = sizeof(Public);
+    crypto_ed25519_generate(&Key);
+    crypto_ed25519_export_public_key(&Key, Public, &Size);
+    crypto_ed25519_init(&gbKeys[i]);
+    crypto_ed25519_import_public_key(&gbKeys[i], Public, Size);
+    snprintf(gbIds[i], sizeof(gbIds[i]), "%08X-0000-4000-8000-%012d", i * 7919, i);
+  }
+}
+
+/* Permissions of each id, -1 if not paired.
+*/
+static void load_state(int* perms)
+{
+  for(int i = 0; i < N_IDS; ++i)
+  {
+    pairing_t P;
+    perms[i] = homekit_storage_find_pairing(gbIds[i], &P) ? -1 : (int)P.permissions;
+  }
+}
+
+static uint32_t total_erases()
+{
+  uint32_t n = 0;
+  for(int s = 0; s < HOMEKIT_FLASH_SIM_SECTORS; ++s)
+    n += homekit_flash_sim_sector(s)->erases;
+  return n;
+}
+
+#pragma endregion
+
+#pragma region Former layout
+/* Model of the fixed layout of older versions (homekit_storage_*_pairing
+* before the log): 16 slots of 80 bytes behind the accessory key in the
+* EEPROM sector. An add or update programs the next erased slot (the old
+* one of an update is cleared); only without an erased slot the live
+* slots are compacted: the sector is read, erased and written again.
+*/
+#define LEGACY_SLOTS 16
+#define LEGACY_SLOT_SIZE 80
+#define LEGACY_SLOT_ADDR(i) (HOMEKIT_FLASH_SIM_EEPROM_ADDR + 128 + (i) * LEGACY_SLOT_SIZE)
+
+/* @return slot of the pairing id, not 'skip'
+*/
+static int legacy_find(int id, int skip)
+{
+  for(int i = 0; i < LEGACY_SLOTS; ++i)
+  {
+    byte R[LEGACY_SLOT_SIZE];
+    homekit_flash_sim_read(LEGACY_SLOT_ADDR(i), R, sizeof(R));
+    if(i != skip && memcmp(R, "HAP", 4) == 0 && R[5] == id)
+      return i;
+  }
+  return -1;
+}
+
+static int legacy_find_empty()
+{
+  for(int i = 0; i < LEGACY_SLOTS; ++i)
+  {
+    byte R[LEGACY_SLOT_SIZE];
+    homekit_flash_sim_read(LEGACY_SLOT_ADDR(i), R, sizeof(R));
+    bool Empty = true;
+    for(int j = 0; Empty && j < LEGACY_SLOT_SIZE; ++j)
+      Empty = R[j] == 0xff;
+    if(Empty)
+      return i;
+  }
+  return -1;
+}
+
+static void legacy_compact()
+{
+  static byte Sector[SEC];
+  homekit_flash_sim_read(HOMEKIT_FLASH_SIM_EEPROM_ADDR, Sector, SEC);
+  int Next = 0;
+  for(int i = 0; i < LEGACY_SLOTS; ++i)
+  {
+    byte* R = Sector + 128 + i * LEGACY_SLOT_SIZE;
+    if(memcmp(R, "HAP", 4) == 0)
+      memmove(Sector + 128 + Next++ * LEGACY_SLOT_SIZE, R, LEGACY_SLOT_SIZE);
+  }
+  // full, nothing to gain
+  if(Next == LEGACY_SLOTS)
+    return;
+  homekit_flash_sim_erase_sector(HOMEKIT_FLASH_SIM_EEPROM_ADDR);
+  homekit_flash_sim_write(HOMEKIT_FLASH_SIM_EEPROM_ADDR, Sector, 128 + Next * LEGACY_SLOT_SIZE);
+}
+
+/* @return slot written, -1 if all slots hold pairings
+*/
+static int legacy_write(int id, int perms)
+{
+  int i = legacy_find_empty();
+  if(i < 0)
+  {
+    legacy_compact();
+    i = legacy_find_empty();
+    if(i < 0)
+      return -1;
+  }
+  byte R[LEGACY_SLOT_SIZE];
+  memset(R, 0, sizeof(R));
+  memcpy(R, "HAP", 4);
+  R[4] = (byte)perms;
+  R[5] = (byte)id;
+  homekit_flash_sim_write(LEGACY_SLOT_ADDR(i), R, sizeof(R));
+  return i;
+}
+
+static void legacy_clear(int slot)
+{
+  byte R[LEGACY_SLOT_SIZE];
+  memset(R, 0, sizeof(R));
+  homekit_flash_sim_write(LEGACY_SLOT_ADDR(slot), R, sizeof(R));
+}
+
+#pragma endregion
+
+#pragma region Erases per 1000 operations
+typedef enum { OpAdd, OpRemove, OpUpdate } op_kind_t;
+
+typedef struct
+{
+  op_kind_t Kind;
+  int       Id;
+  int       Perms;  // after the operation
+} op_t;
+
+#define N_OPS 1000
+static op_t gbOps[N_OPS];
+
+/* Random adds, removes and updates of N_IDS pairings.
+*/
+static void make_ops()
+{
+  int Perms[N_IDS];
+  for(int i = 0; i < N_IDS; ++i)
+    Perms[i] = -1;
+
+  srand(2);
+  for(int op = 0; op < N_OPS; ++op)
+  {
+    int i = rand() % N_IDS;
+    int Kind = rand() % 3;
+    op_t* O = &gbOps[op];
+    O->Id = i;
+    if(Perms[i] < 0)
+    {
+      O->Kind = OpAdd;
+      Perms[i] = 1;
+    }
+    else if(Kind == 0)
+    {
+      O->Kind = OpRemove;
+      Perms[i] = -1;
+    }
+    else
+    {
+      O->Kind = OpUpdate;
+      Perms[i] ^= 1;
+    }
+    O->Perms = Perms[i];
+  }
+}
+
+/* @return erases of the operations with the former layout
+*/
+static uint32_t legacy_erases()
+{
+  homekit_flash_sim_reset();
+  homekit_flash_sim_erase_sector(HOMEKIT_FLASH_SIM_EEPROM_ADDR);
+  homekit_flash_sim_write(HOMEKIT_FLASH_SIM_EEPROM_ADDR, "HAP", 4);
+  homekit_flash_sim_write(HOMEKIT_FLASH_SIM_EEPROM_ADDR + 4, ACCESSORY_ID, ACCESSORY_ID_SIZE);
+  uint32_t Erases0 = total_erases();
+
+  for(int op = 0; op < N_OPS; ++op)
+  {
+    const op_t* O = &gbOps[op];
+    if(O->Kind == OpAdd)
+      legacy_write(O->Id, O->Perms);
+    else if(O->Kind == OpRemove)
+      legacy_clear(legacy_find(O->Id, -1));
+    else
+    {
+      // new record first, then the old one is cleared
+      int New = legacy_write(O->Id, O->Perms);
+      if(New >= 0)
+        legacy_clear(legacy_find(O->Id, New));
+    }
+  }
+  return total_erases() - Erases0;
+}
+
+static void test_erases()
+{
+  make_ops();
+  const uint32_t Legacy = legacy_erases();
+
+  homekit_flash_sim_reset();
+  homekit_storage_init();
+  homekit_storage_save_accessory_id(ACCESSORY_ID);
+  uint32_t Erases0 = total_erases();
+
+  int Perms[N_IDS];
+  int Changes = 0;
+  for(int i = 0; i < N_IDS; ++i)
+    Perms[i] = -1;
+
+  for(int op = 0; op < N_OPS; ++op)
+  {
+    const op_t* O = &gbOps[op];
+    if(O->Kind == OpAdd)
+      CHECK_EQ(homekit_storage_add_pairing(gbIds[O->Id], &gbKeys[O->Id], 1), 0);
+    else if(O->Kind == OpRemove)
+      CHECK_EQ(homekit_storage_remove_pairing(gbIds[O->Id]), 0);
+    else
+      CHECK_EQ(homekit_storage_update_pairing(gbIds[O->Id], O->Perms), 0);
+    Changes += O->Kind != OpAdd;
+    Perms[O->Id] = O->Perms;
+  }
+
+  uint32_t Erases = total_erases() - Erases0;
+  printf("%d pairing operations (%d updates and removes): %u erases, former layout %u\n",
+    N_OPS, Changes, Erases, Legacy);
+  for(int s = 0; s < HOMEKIT_FLASH_SIM_SECTORS; ++s)
+  {
+    const homekit_flash_sim_sector_t* S = homekit_flash_sim_sector(s);
+    if(S->erases || S->writes)
+      printf("  sector %2d: %u erases, %u writes, %u bytes\n", s, S->erases, S->writes, S->bytes_written);
+  }
+  CHECK(Erases < 100);
+  CHECK(Erases * 3 <= Legacy);
+
+  // the log is spread over the free sector and the EEPROM sector
+  const homekit_flash_sim_sector_t* Free = homekit_flash_sim_sector(HOMEKIT_FLASH_SIM_FS_END_ADDR / SEC);
+  const homekit_flash_sim_sector_t* Eeprom = homekit_flash_sim_sector(HOMEKIT_FLASH_SIM_EEPROM_ADDR / SEC);
+  CHECK(Free->erases > 0 && Eeprom->erases > 0);
+  CHECK(abs((int)Free->erases - (int)Eeprom->erases) <= 1);
+
+  // same state after a reboot
+  homekit_storage_init();
+  int Got[N_IDS];
+  load_state(Got);
+  for(int i = 0; i < N_IDS; ++i)
+    CHECK_EQ(Got[i], Perms[i]);
+
+  char Id[ACCESSORY_ID_SIZE + 1] = { 0 };
+  CHECK_EQ(homekit_storage_load_accessory_id(Id), 0);
+  CHECK(strcmp(Id, ACCESSORY_ID) == 0);
+}
+
+#pragma endregion
+
+#pragma region Power fail
+/* Cuts the power after every byte of a sequence of updates of one pairing,
+* long enough to collect the log once. After the "reboot" the accessory id
+* and all other pairings must be unchanged.
+*/
+static void test_power_fail()
+{
+  static uint8_t Snapshot[HOMEKIT_FLASH_SIM_SECTORS * SEC];
+  const int Changed = 3;
+
+  host_log_enabled = false;
+  homekit_flash_sim_reset();
+  homekit_storage_init();
+  homekit_storage_save_accessory_id(ACCESSORY_ID);
+  for(int i = 0; i < 8; ++i)
+    homekit_storage_add_pairing(gbIds[i], &gbKeys[i], 1);
+  memcpy(Snapshot, homekit_flash_sim_data(), sizeof(Snapshot));
+
+  int Before[N_IDS];
+  load_state(Before);
+
+  int Cuts = 0;
+  for(long Budget = 0; ; ++Budget)
+  {
+    memcpy(homekit_flash_sim_data(), Snapshot, sizeof(Snapshot));
+    homekit_storage_init();
+
+    homekit_flash_sim_power_fail_after(Budget);
+    for(int k = 0; k < 60; ++k)
+      homekit_storage_update_pairing(gbIds[Changed], k & 1);
+    bool Cut = homekit_flash_sim_power_failed();
+    homekit_flash_sim_power_on();
+    if(!Cut)
+      break;
+    ++Cuts;
+
+    homekit_storage_init();
+    int Got[N_IDS];
+    load_state(Got);
+    for(int i = 0; i < N_IDS; ++i)
+    {
+      if(i == Changed)
+        CHECK(Got[i] == 0 || Got[i] == 1);
+      else if(Got[i] != Before[i])
+      {
+        CHECK_EQ(Got[i], Before[i]);
+        printf("  power fail after %ld bytes\n", Budget);
+      }
+    }
+
+    char Id[ACCESSORY_ID_SIZE + 1] = { 0 };
+    CHECK_EQ(homekit_storage_load_accessory_id(Id), 0);
+    CHECK(strcmp(Id, ACCESSORY_ID) == 0);
+  }
+  host_log_enabled = true;
+
+  printf("power fail: %d cut points checked\n", Cuts);
+  CHECK(Cuts > 60);
+}
+
+#pragma endregion
+
+int main()
+{
+  srand(1);
+  make_ids();
+  test_erases();
+  test_power_fail();
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,188 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>test_sha512.c<< 19 Okt 2026  16:51:30 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include "user_settings.h"
+#include <wolfssl/wolfcrypt/sha512.h>
+#include <wolfssl/wolfcrypt/hash.h>
+#include "host_shim.h"
+#include "host_test.h"
+
+#pragma endregion
+
+/* SHA-512 known-answer tests (FIPS 180-4 examples), built once with the
+* default transform (test_sha512) and once with ESP_SHA512_TRANSFORM_32BIT
+* (test_sha512_32bit). The 32-bit build also links the default transform
+* (sha512_default.c) and compares both, digests and time.
+*/
+
+#pragma region Definitions
+static const char* const Msg896 =
+  "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+  "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+
+static void check_digest(const byte* digest, const char* expected, const char* what)
+{
+  char Hex[2 * WC_SHA512_DIGEST_SIZE + 1];
+  for(int i = 0; i < WC_SHA512_DIGEST_SIZE; ++i)
+    snprintf(Hex + 2 * i, 3, "%02x", digest[i]);
+  if(strcmp(Hex, expected) != 0)
+  {
+    CHECK(!"SHA-512 digest");
+    printf("  %s: %s\n", what, Hex);
+  }
+}
+
+#pragma endregion
+
+#pragma region Known answers
+static void test_known_answers()
+{
+  byte Out[WC_SHA512_DIGEST_SIZE];
+
+  CHECK_EQ(wc_Sha512Hash((const byte*)"abc", 3, Out), 0);
+  check_digest(Out,
+    "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+    "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f", "abc");
+
+  CHECK_EQ(wc_Sha512Hash((const byte*)"", 0, Out), 0);
+  check_digest(Out,
+    "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+    "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e", "empty");
+
+  CHECK_EQ(wc_Sha512Hash((const byte*)Msg896, (word32)strlen(Msg896), Out), 0);
+  check_digest(Out,
+    "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+    "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909", "896 bit");
+
+  // one million 'a'
+  wc_Sha512 Sha;
+  byte A[1000];
+  memset(A, 'a', sizeof(A));
+  CHECK_EQ(wc_InitSha512(&Sha), 0);
+  for(int i = 0; i < 1000; ++i)
+    wc_Sha512Update(&Sha, A, sizeof(A));
+  CHECK_EQ(wc_Sha512Final(&Sha, Out), 0);
+  check_digest(Out,
+    "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+    "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b", "million a");
+}
+
+#pragma endregion
+
+#pragma region Split updates
+/* The 896 bit message fed in two parts at every split point.
+*/
+static void test_split_updates()
+{
+  const word32 Size = (word32)strlen(Msg896);
+  byte Ref[WC_SHA512_DIGEST_SIZE], Out[WC_SHA512_DIGEST_SIZE];
+  wc_Sha512Hash((const byte*)Msg896, Size, Ref);
+
+  for(word32 Split = 0; Split <= Size; ++Split)
+  {
+    wc_Sha512 Sha;
+    wc_InitSha512(&Sha);
+    wc_Sha512Update(&Sha, (const byte*)Msg896, Split);
+    wc_Sha512Update(&Sha, (const byte*)Msg896 + Split, Size - Split);
+    wc_Sha512Final(&Sha, Out);
+    CHECK(memcmp(Out, Ref, sizeof(Ref)) == 0);
+  }
+}
+
+#pragma endregion
+
+#pragma region Default transform
+#ifdef ESP_SHA512_TRANSFORM_32BIT
+int default_InitSha512(wc_Sha512* sha);
+int default_Sha512Update(wc_Sha512* sha, const byte* data, word32 len);
+int default_Sha512Final(wc_Sha512* sha, byte* hash);
+
+static void default_Sha512Hash(const byte* data, word32 len, byte* hash)
+{
+  wc_Sha512 Sha;
+  default_InitSha512(&Sha);
+  default_Sha512Update(&Sha, data, len);
+  default_Sha512Final(&Sha, hash);
+}
+
+/* Random messages of 0..1024 bytes, hashed by both transforms.
+*/
+static void test_compare_default()
+{
+  byte Buf[1024], Ref[WC_SHA512_DIGEST_SIZE], Out[WC_SHA512_DIGEST_SIZE];
+  for(size_t i = 0; i < sizeof(Buf); ++i)
+    Buf[i] = (byte)(i * 131 + (i >> 3));
+
+  int Mismatches = 0;
+  for(word32 Len = 0; Len <= sizeof(Buf); ++Len)
+  {
+    default_Sha512Hash(Buf, Len, Ref);
+    wc_Sha512Hash(Buf, Len, Out);
+    if(memcmp(Ref, Out, sizeof(Ref)) != 0)
+      ++Mismatches;
+  }
+  CHECK_EQ(Mismatches, 0);
+}
+#endif
+
+#pragma endregion
+
+#pragma region Timing
+typedef void (*hash_fn)(const byte* data, word32 len, byte* hash);
+
+static void hash_32(const byte* data, word32 len, byte* hash)
+{
+  wc_Sha512Hash(data, len, hash);
+}
+
+/* @return us per 1 KB hash, best of 5 runs
+*/
+static double time_hash(hash_fn fn)
+{
+  byte Buf[1024], Out[WC_SHA512_DIGEST_SIZE];
+  memset(Buf, 0x5a, sizeof(Buf));
+  const int Runs = 2000;
+  uint32_t Best = UINT32_MAX;
+  for(int r = 0; r < 5; ++r)
+  {
+    uint32_t Start = micros();
+    for(int i = 0; i < Runs; ++i)
+      fn(Buf, sizeof(Buf), Out);
+    uint32_t Elapsed = micros() - Start;
+    if(Elapsed < Best)
+      Best = Elapsed;
+  }
+  return (double)Best / Runs;
+}
+
+static void print_timing()
+{
+  #ifdef ESP_SHA512_TRANSFORM_32BIT
+  printf("SHA-512 of 1 KB: %.2f us default, %.2f us 32-bit\n", time_hash(default_Sha512Hash), time_hash(hash_32));
+  #else
+  printf("SHA-512 of 1 KB: %.2f us\n", time_hash(hash_32));
+  #endif
+}
+
+#pragma endregion
+
+int main()
+{
+  #ifdef ESP_SHA512_TRANSFORM_32BIT
+  printf("ESP_SHA512_TRANSFORM_32BIT\n");
+  #endif
+  test_known_answers();
+  test_split_updates();
+  #ifdef ESP_SHA512_TRANSFORM_32BIT
+  test_compare_default();
+  #endif
+  print_timing();
+  return HOST_TEST_RESULT();
+}
@@ -0,0 +1,358 @@
+#pragma region Prolog
+/*******************************************************************
+$CRT 19 Okt 2026 : hb
+
+$AUT Holger Burkarth
+$DAT >>test_simple_fs.cpp<< 19 Okt 2026  16:24:09 - (c) proDAD
+*******************************************************************/
+#pragma endregion
+#pragma region Includes
+#include <string.h>
+#include <memory>
+#include "hb_storage.h"
+#include "port.h"
+#include "host_test.h"
+
+using namespace HBHomeKit;
+
+#pragma endregion
+
+/* CSimpleFileSystem on the flash simulator: files, migration of the
+* single page format, wear of the common pages and a LittleFS of the sketch.
+*/
+
+#pragma region Definitions
+#define SEC SPI_FLASH_SEC_SIZE
+
+static const int FirstCommonSector = HOMEKIT_FLASH_SIM_FS_END_ADDR / SEC - HOMEKIT_STORAGE_COMMON_PAGES;
+static const int LegacySector = HOMEKIT_FLASH_SIM_EEPROM_ADDR / SEC + 2;
+
+static bool is_common_sector(int s)
+{
+  return s >= FirstCommonSector && s < FirstCommonSector + HOMEKIT_STORAGE_COMMON_PAGES;
+}
+
+/* Only the common pages may have been written or erased.
+*/
+static void check_only_common_pages_used()
+{
+  for(int s = 0; s < HOMEKIT_FLASH_SIM_SECTORS; ++s)
+  {
+    const homekit_flash_sim_sector_t* S = homekit_flash_sim_sector(s);
+    if(!is_common_sector(s) && (S->writes || S->erases))
+    {
+      CHECK(!"sector out of the common pages used");
+      printf("  sector %d: %u erases, %u writes\n", s, S->erases, S->writes);
+    }
+  }
+}
+
+static void fill(uint8_t* buf, size_t size, uint8_t seed)
+{
+  for(size_t i = 0; i < size; ++i)
+    buf[i] = static_cast<uint8_t>(seed + i * 7);
+}
+
+static bool has_content(CSimpleFileSystem& fs, const char* name, size_t size, uint8_t seed)
+{
+  std::unique_ptr<uint8_t[]> Want(new uint8_t[size]), Got(new uint8_t[size]);
+  fill(Want.get(), size, seed);
+  return fs.FileSize(name) == (int)size
+    && fs.ReadFile(name, Got.get(), (int)size) == (int)size
+    && memcmp(Want.get(), Got.get(), size) == 0;
+}
+
+#pragma endregion
+
+#pragma region Files
+static void test_files()
+{
+  homekit_flash_sim_reset();
+  uint8_t Buf[600];
+
+  {
+    CSimpleFileSystem FS;
+    CHECK(FS.empty());
+
+    fill(Buf, 40, 1);
+    CHECK_EQ(FS.WriteFile("PositionMarker1", Buf, 40), 40);
+    fill(Buf, 8, 2);
+    CHECK_EQ(FS.WriteFile("WIFI", Buf, 8), 8);
+    CHECK(has_content(FS, "PositionMarker1", 40, 1));
+
+    // resize
+    fill(Buf, 500, 3);
+    CHECK_EQ(FS.WriteFile("WIFI", Buf, 500), 500);
+    CHECK(has_content(FS, "WIFI", 500, 3));
+    fill(Buf, 4, 4);
+    CHECK_EQ(FS.WriteFile("WIFI", Buf, 4), 4);
+    CHECK(has_content(FS, "WIFI", 4, 4));
+
+    // append
+    uint8_t Log[30];
+    fill(Log, sizeof(Log), 5);
+    CHECK_EQ(FS.AppendFile("Log", Log, 10), 10);
+    CHECK_EQ(FS.AppendFile("Log", Log + 10, 20), 30);
+    FS.Sync();
+    CHECK(has_content(FS, "Log", 30, 5));
+
+    // too long names are rejected
+    CHECK_EQ(FS.WriteFile("NameWithMoreThan15", Buf, 4), -1);
+
+    CHECK(FS.RemoveFile("PositionMarker1"));
+    CHECK(!FS.RemoveFile("PositionMarker1"));
+    CHECK(!FS.Exists("PositionMarker1"));
+  }
+
+  // "reboot": the destructor has written the changes
+  {
+    CSimpleFileSystem FS;
+    CHECK(!FS.Exists("PositionMarker1"));
+    CHECK(has_content(FS, "WIFI", 4, 4));
+    CHECK(has_content(FS, "Log", 30, 5));
+
+    int Count = 0;
+    for(auto E = FS.Files(); E.Next(); )
+      ++Count;
+    CHECK_EQ(Count, 2);
+
+    FS.Format();
+    CHECK(FS.empty());
+  }
+
+  check_only_common_pages_used();
+}
+
+#pragma endregion
+
+#pragma region Legacy migration
+/* The single page format of older versions at EEPROM+8K (a sector of the SDK):
+* crc32 of the entries, 16 entries (name[4], offset, size), file data.
+*/
+struct CLegacyEntry
+{
+  uint8_t  Name[4];
+  uint16_t StartOffset;
+  uint16_t Size;
+};
+
+struct CLegacyHeader
+{
+  uint32_t     Crc;
+  CLegacyEntry Entries[16];
+};
+
+static void test_legacy_migration()
+{
+  homekit_flash_sim_reset();
+
+  uint8_t Page[SEC];
+  memset(Page, 0xff, sizeof(Page));
+  CLegacyHeader H{};
+  memcpy(H.Entries[0].Name, "POS1", 4);
+  H.Entries[0].StartOffset = 0;
+  H.Entries[0].Size = 12;
+  memcpy(H.Entries[1].Name, "USER", 4);
+  H.Entries[1].StartOffset = 12;
+  H.Entries[1].Size = 100;
+  H.Crc = crc32(&H.Entries[0], sizeof(H.Entries));
+  memcpy(Page, &H, sizeof(H));
+  fill(Page + sizeof(H), 12, 10);
+  fill(Page + sizeof(H) + 12, 100, 11);
+  memcpy(homekit_flash_sim_data() + LegacySector * SEC, Page, SEC);
+
+  for(int Boot = 0; Boot < 2; ++Boot)
+  {
+    CSimpleFileSystem FS;
+    CHECK(has_content(FS, "POS1", 12, 10));
+    CHECK(has_content(FS, "USER", 100, 11));
+  }
+
+  // the legacy page is only read
+  CHECK(memcmp(homekit_flash_sim_data() + LegacySector * SEC, Page, SEC) == 0);
+  check_only_common_pages_used();
+}
+
+#pragma endregion
+
+#pragma region Endurance
+/* Commits of one file (as a position marker) with a few other files,
+* erases of the common pages per 1000 commits.
+*/
+static void test_endurance()
+{
+  homekit_flash_sim_reset();
+  const int Commits = 10000;
+  uint8_t Buf[64];
+
+  host_log_enabled = false;
+  {
+    CSimpleFileSystem FS;
+    fill(Buf, sizeof(Buf), 20);
+    FS.WriteFile("Settings", Buf, sizeof(Buf));
+    FS.WriteFile("WIFI", Buf, 32);
+    for(int i = 0; i < Commits; ++i)
+    {
+      fill(Buf, 16, static_cast<uint8_t>(i));
+      FS.WriteFile("PositionMarker", Buf, 16);
+      FS.Sync();
+    }
+    printf("%d commits of 16 bytes: max. %u erases per page\n", Commits, FS.MaxEraseCount());
+  }
+  host_log_enabled = true;
+
+  uint32_t Erases = 0, MinErases = UINT32_MAX, MaxErases = 0;
+  for(int p = 0; p < HOMEKIT_STORAGE_COMMON_PAGES; ++p)
+  {
+    const homekit_flash_sim_sector_t* S = homekit_flash_sim_sector(FirstCommonSector + p);
+    printf("  page %d: %u erases, %u writes, %u bytes\n", p, S->erases, S->writes, S->bytes_written);
+    Erases += S->erases;
+    MinErases = std::min(MinErases, S->erases);
+    MaxErases = std::max(MaxErases, S->erases);
+  }
+  printf("  %.1f erases per 1000 commits\n", Erases * 1000.0 / Commits);
+
+  // about one erase per 90 commits (44 byte records), the single page format erased per commit
+  CHECK(Erases * 20 < (uint32_t)Commits);
+  CHECK(MaxErases - MinErases <= 1);
+
+  CSimpleFileSystem FS;
+  CHECK(has_content(FS, "PositionMarker", 16, static_cast<uint8_t>(Commits - 1)));
+  CHECK(has_content(FS, "Settings", 64, 20));
+  check_only_common_pages_used();
+}
+
+#pragma endregion
+
+#pragma region Power fail
+/* Cuts the power after every byte of 100 commits of one file, which
+* compact a page at least once. After the "reboot" the other files are
+* unchanged and the committed file holds one of its versions.
+*/
+static void test_power_fail()
+{
+  static uint8_t Snapshot[HOMEKIT_FLASH_SIM_SECTORS * SEC];
+  const int Commits = 100;
+  uint8_t Buf[64];
+
+  host_log_enabled = false;
+  homekit_flash_sim_reset();
+  {
+    CSimpleFileSystem FS;
+    fill(Buf, sizeof(Buf), 20);
+    FS.WriteFile("Settings", Buf, sizeof(Buf));
+    fill(Buf, 32, 21);
+    FS.WriteFile("WIFI", Buf, 32);
+    fill(Buf, 16, 0);
+    FS.WriteFile("PositionMarker", Buf, 16);
+  }
+  memcpy(Snapshot, homekit_flash_sim_data(), sizeof(Snapshot));
+
+  int Cuts = 0;
+  uint32_t Erases = 0;
+  for(long Budget = 0; ; ++Budget)
+  {
+    memcpy(homekit_flash_sim_data(), Snapshot, sizeof(Snapshot));
+    uint32_t Erases0 = homekit_flash_sim_sector(FirstCommonSector)->erases
+      + homekit_flash_sim_sector(FirstCommonSector + 1)->erases;
+    {
+      CSimpleFileSystem FS;
+      homekit_flash_sim_power_fail_after(Budget);
+      for(int k = 1; k <= Commits && !homekit_flash_sim_power_failed(); ++k)
+      {
+        fill(Buf, 16, static_cast<uint8_t>(k));
+        FS.WriteFile("PositionMarker", Buf, 16);
+        FS.Sync();
+      }
+    }
+    bool Cut = homekit_flash_sim_power_failed();
+    homekit_flash_sim_power_on();
+    if(!Cut)
+    {
+      Erases = homekit_flash_sim_sector(FirstCommonSector)->erases
+        + homekit_flash_sim_sector(FirstCommonSector + 1)->erases - Erases0;
+      break;
+    }
+    ++Cuts;
+
+    CSimpleFileSystem FS;
+    bool Ok = has_content(FS, "Settings", 64, 20) && has_content(FS, "WIFI", 32, 21);
+    Ok = Ok && FS.ReadFile("PositionMarker", Buf, 16) == 16;
+    Ok = Ok && Buf[0] <= Commits && has_content(FS, "PositionMarker", 16, Buf[0]);
+    if(!Ok)
+    {
+      CHECK(!"file lost after a power fail");
+      printf("  power fail after %ld bytes\n", Budget);
+    }
+  }
+  host_log_enabled = true;
+
+  printf("power fail: %d cut points checked, %u erases in %d commits\n", Cuts, Erases, Commits);
+  CHECK(Cuts > Commits);
+  CHECK(Erases > 0);
+}
+
+#pragma endregion
+
+#pragma region LittleFS
+/* A LittleFS of the sketch over the whole file system area keeps the
+* common pages unused; one mounted without the last sectors does not.
+*/
+static void write_littlefs_superblock(uint32_t blockCount)
+{
+  uint8_t SB[32];
+  const uint32_t BlockSize = SEC;
+  memset(SB, 0xff, sizeof(SB));
+  memcpy(SB + 8, "littlefs", 8);
+  memcpy(SB + 24, &BlockSize, 4);
+  memcpy(SB + 28, &blockCount, 4);
+  memcpy(homekit_flash_sim_data() + FS_PHYS_ADDR, SB, sizeof(SB));
+}
+
+static void test_littlefs()
+{
+  const uint32_t Blocks = FS_PHYS_SIZE / SEC;
+  uint8_t Buf[8];
+  fill(Buf, sizeof(Buf), 30);
+
+  host_log_enabled = false;
+  homekit_flash_sim_reset();
+  write_littlefs_superblock(Blocks);
+  homekit_storage_init();
+  {
+    CSimpleFileSystem FS;
+    FS.WriteFile("WIFI", Buf, sizeof(Buf));
+    FS.Sync();
+  }
+  host_log_enabled = true;
+  CHECK(!homekit_storage_fs_area_free(FirstCommonSector * SEC, SEC));
+  for(int p = 0; p < HOMEKIT_STORAGE_COMMON_PAGES; ++p)
+  {
+    const homekit_flash_sim_sector_t* S = homekit_flash_sim_sector(FirstCommonSector + p);
+    CHECK(S->erases == 0 && S->writes == 0);
+  }
+
+  homekit_flash_sim_reset();
+  write_littlefs_superblock(Blocks - HOMEKIT_STORAGE_COMMON_PAGES);
+  homekit_storage_init();
+  CHECK(homekit_storage_fs_area_free(FirstCommonSector * SEC, HOMEKIT_STORAGE_COMMON_PAGES * SEC));
+  {
+    CSimpleFileSystem FS;
+    FS.WriteFile("WIFI", Buf, sizeof(Buf));
+    FS.Sync();
+  }
+  CSimpleFileSystem FS;
+  CHECK(has_content(FS, "WIFI", sizeof(Buf), 30));
+}
+
+#pragma endregion
+
+int main()
+{
+  test_files();
+  test_legacy_migration();
+  test_endurance();
+  test_power_fail();
+  test_littlefs();
+  return HOST_TEST_RESULT();
+}